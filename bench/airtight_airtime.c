@@ -0,0 +1,188 @@
+/**
+ * @file
+ * AirTight: airtime per packet of the fixed and compact encodings.
+ *
+ * Compares the 26 byte fixed frames with the compact encoding for a range of
+ * used data lengths, alone and aggregated, using a model of 802.15.4 at
+ * 250 kbit/s with unslotted CSMA-CA and acknowledgements, and of the XBee API
+ * serial link. Encode and decode costs are also measured.
+ *
+ * Usage: airtight_airtime [serial baud rate]
+ */
+#include <string.h>
+
+#include "airtight_mac.h"
+#include "airtight_bench.h"
+
+/**
+ * Time to send one byte at 250 kbit/s in microseconds.
+ */
+#define AIRTIME_BYTE_US 32
+
+/**
+ * Preamble, start of frame delimiter and length.
+ */
+#define AIRTIME_PHY_OVERHEAD 6
+
+/**
+ * Frame control, sequence number, PAN ID, 16 bit addresses and FCS.
+ */
+#define AIRTIME_MAC_OVERHEAD 11
+
+/**
+ * Acknowledgement frame including its PHY header.
+ */
+#define AIRTIME_ACK_BYTES 11
+
+/**
+ * Mean initial CSMA-CA backoff of (2^3 - 1) / 2 unit periods, plus CCA.
+ */
+#define AIRTIME_BACKOFF_US (1120 + 128)
+
+/**
+ * Receive to transmit turnaround before the acknowledgement.
+ */
+#define AIRTIME_TURNAROUND_US 192
+
+/**
+ * Short and long interframe spacing, long after frames over 18 bytes.
+ */
+#define AIRTIME_SIFS_US 192
+#define AIRTIME_LIFS_US 640
+#define AIRTIME_SIFS_MAX_MPDU 18
+
+/**
+ * API start delimiter, length, checksum and the 16 bit transmit header.
+ */
+#define AIRTIME_SERIAL_OVERHEAD 9
+
+/**
+ * Default serial baud rate.
+ */
+#define AIRTIME_BAUD 115200
+
+/**
+ * Iterations when timing encode and decode.
+ */
+#define AIRTIME_ITERATIONS 20000
+
+/**
+ * Radio channel occupancy of one acknowledged frame with a payload.
+ */
+static at_u32_t Airtime_RadioUS(at_u16_t payload)
+{
+    const at_u16_t mpdu = payload + AIRTIME_MAC_OVERHEAD;
+    const at_u32_t ifs = mpdu > AIRTIME_SIFS_MAX_MPDU ? AIRTIME_LIFS_US : AIRTIME_SIFS_US;
+
+    return AIRTIME_BACKOFF_US + (AIRTIME_PHY_OVERHEAD + mpdu) * AIRTIME_BYTE_US +
+           AIRTIME_TURNAROUND_US + AIRTIME_ACK_BYTES * AIRTIME_BYTE_US + ifs;
+}
+
+/**
+ * Serial transfer of one frame to the radio, 10 bits per byte.
+ */
+static at_u32_t Airtime_SerialUS(at_u16_t payload, at_u32_t baud)
+{
+    return (at_u32_t)(((at_u64_t)(payload + AIRTIME_SERIAL_OVERHEAD) * 10 * 1000000) / baud);
+}
+
+static void Airtime_MakePacket(Airtight_Packet *packet, at_u8_t data_length)
+{
+    Airtight_InitialisePacket(packet);
+    packet->data.fields.destination = 2;
+    packet->data.fields.hop_destination = 1;
+    packet->data.fields.sequence_number = 7;
+    packet->data.fields.c_value = 1;
+    packet->meta.data_length = data_length;
+
+    for (at_u8_t i = 0; i < data_length; i++)
+    {
+        packet->data.fields.data[i] = i;
+    }
+}
+
+/**
+ * Print the airtime of a frame carrying count packets of a payload each.
+ */
+static void Airtime_Row(const char *encoding, at_u8_t data_length, at_u8_t count, at_u16_t payload, at_u32_t baud, at_u32_t fixed_us)
+{
+    const at_u32_t radio_us = Airtime_RadioUS(payload);
+    const at_u32_t serial_us = Airtime_SerialUS(payload, baud);
+
+    printf("%-18s data=%-3u x%-2u bytes=%-4u radio/pkt=%-6lu serial/pkt=%-6lu saving=%5.1f%%\n",
+           encoding, data_length, count, payload,
+           (unsigned long)(radio_us / count), (unsigned long)(serial_us / count),
+           100.0 * (1.0 - (double)(radio_us / count) / (double)fixed_us));
+}
+
+/**
+ * Time encoding and decoding a compact packet.
+ */
+static void Airtime_CodecCost(at_u8_t data_length)
+{
+    Airtight_Packet packet;
+    Airtight_Packet decoded;
+    at_u8_t raw[AIRTIGHT_CODEC_MAX_SIZE];
+    char encode_name[40];
+    char decode_name[40];
+    Bench_Samples encode;
+    Bench_Samples decode;
+
+    Airtime_MakePacket(&packet, data_length);
+
+    snprintf(encode_name, sizeof(encode_name), "encode data=%u", data_length);
+    Bench_SamplesInit(&encode, encode_name, AIRTIME_ITERATIONS);
+    snprintf(decode_name, sizeof(decode_name), "decode data=%u", data_length);
+    Bench_SamplesInit(&decode, decode_name, AIRTIME_ITERATIONS);
+
+    for (size_t i = 0; i < AIRTIME_ITERATIONS; i++)
+    {
+        at_u64_t start = Bench_Cycles();
+        const at_u16_t length = Airtight_Codec_Encode(&packet, raw, sizeof(raw));
+        Bench_SamplesAdd(&encode, Bench_Cycles() - start);
+
+        start = Bench_Cycles();
+        Airtight_Codec_Decode(raw, length, 0, &decoded);
+        Bench_SamplesAdd(&decode, Bench_Cycles() - start);
+    }
+
+    Bench_Report(&encode, "cycles");
+    Bench_Report(&decode, "cycles");
+    Bench_SamplesFree(&encode);
+    Bench_SamplesFree(&decode);
+}
+
+int main(int argc, char **argv)
+{
+    const at_u32_t baud = argc > 1 ? strtoul(argv[1], NULL, 10) : AIRTIME_BAUD;
+    static const at_u8_t data_lengths[] = {0, 3, 8, AIRTIGHT_DATA};
+    const at_u32_t fixed_us = Airtime_RadioUS(AIRTIGHT_PACKET_SIZE);
+
+    printf("Airtime: 802.15.4 250 kbit/s with ack, serial %lu baud, times in us\n", (unsigned long)baud);
+
+    for (size_t i = 0; i < sizeof(data_lengths); i++)
+    {
+        const at_u8_t data_length = data_lengths[i];
+        Airtight_Packet packet;
+        Airtime_MakePacket(&packet, data_length);
+
+        Airtime_Row("fixed", data_length, 1, AIRTIGHT_PACKET_SIZE, baud, fixed_us);
+        Airtime_Row("compact", data_length, 1, Airtight_Codec_Size(&packet), baud, fixed_us);
+
+        // Fill an aggregate as the MAC would with packets for one hop.
+        Airtight_Aggregate aggregate;
+        Airtight_Aggregate_Init(&aggregate);
+        while (!Airtight_Aggregate_Full(&aggregate))
+        {
+            Airtight_Aggregate_Add(&aggregate, &packet);
+        }
+        Airtime_Row(AT_CONF_COMPACT_ENCODING == 1 ? "compact aggregate" : "fixed aggregate", data_length, aggregate.count, Airtight_Aggregate_Length(&aggregate), baud, fixed_us);
+    }
+
+    for (size_t i = 0; i < sizeof(data_lengths); i++)
+    {
+        Airtime_CodecCost(data_lengths[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file
+ * AirTight: shared helpers for benchmarks.
+ */
+#ifndef __AIRTIGHT_BENCH_H
+#define __AIRTIGHT_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "airtight_types.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Read a cycle counter, or a nanosecond clock where none is available.
+ */
+static inline at_u64_t Bench_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    at_u64_t cycles;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(cycles));
+    return cycles;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (at_u64_t)now.tv_sec * 1000000000u + (at_u64_t)now.tv_nsec;
+#endif
+}
+
+/**
+ * Samples of a measured quantity.
+ */
+typedef struct
+{
+    const char *name;
+    at_u64_t *values;
+    size_t count;
+    size_t capacity;
+} Bench_Samples;
+
+static inline void Bench_SamplesInit(Bench_Samples *samples, const char *name, size_t capacity)
+{
+    samples->name = name;
+    samples->values = malloc(capacity * sizeof(at_u64_t));
+    samples->count = 0;
+    samples->capacity = capacity;
+}
+
+static inline void Bench_SamplesAdd(Bench_Samples *samples, at_u64_t value)
+{
+    if (samples->count < samples->capacity)
+    {
+        samples->values[samples->count++] = value;
+    }
+}
+
+static inline int Bench_Compare(const void *a, const void *b)
+{
+    const at_u64_t x = *(const at_u64_t *)a;
+    const at_u64_t y = *(const at_u64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Get a percentile of the samples, sorting them in place.
+ */
+static inline at_u64_t Bench_Percentile(Bench_Samples *samples, double percentile)
+{
+    if (samples->count == 0)
+    {
+        return 0;
+    }
+
+    qsort(samples->values, samples->count, sizeof(at_u64_t), Bench_Compare);
+
+    size_t index = (size_t)(percentile / 100.0 * (double)(samples->count - 1) + 0.5);
+    return samples->values[index];
+}
+
+/**
+ * Print median, high percentiles and maximum of the samples.
+ */
+static inline void Bench_Report(Bench_Samples *samples, const char *unit)
+{
+    printf("%-40s n=%-7zu p50=%-8llu p99=%-8llu p99.9=%-8llu max=%-8llu %s\n",
+           samples->name,
+           samples->count,
+           (unsigned long long)Bench_Percentile(samples, 50.0),
+           (unsigned long long)Bench_Percentile(samples, 99.0),
+           (unsigned long long)Bench_Percentile(samples, 99.9),
+           (unsigned long long)Bench_Percentile(samples, 100.0),
+           unit);
+}
+
+static inline void Bench_SamplesFree(Bench_Samples *samples)
+{
+    free(samples->values);
+    samples->values = NULL;
+}
+
+#endif
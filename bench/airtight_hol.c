@@ -0,0 +1,161 @@
+/**
+ * @file
+ * AirTight: head-of-line blocking simulation with one degraded link.
+ *
+ * Node 0 sends HIGH packets to two next hops through the MAC's real slot
+ * path. Acks from one hop succeed only occasionally, those from the other
+ * always do. Reports the queueing latency of the healthy hop's packets and
+ * the frames spent on the degraded hop, with next hop back off disabled and
+ * enabled, for one and for several frames per transmit slot.
+ *
+ * Usage: airtight_hol [cycles] [degraded ack percentage]
+ */
+#include <string.h>
+
+#include "airtight_mac.h"
+#include "airtight_bench.h"
+
+/**
+ * Default number of slot table cycles simulated per run.
+ */
+#define HOL_CYCLES 20000
+
+/**
+ * Default percentage of frames to the degraded hop which are acked.
+ */
+#define HOL_DEGRADED_ACK_PERCENT 10
+
+/**
+ * Cycles between packets of each flow.
+ */
+#define HOL_PERIOD_CYCLES 4
+
+/**
+ * Destinations reached through the degraded and the healthy next hop, see
+ * airtight_routes_config.txt.
+ */
+#define HOL_DEGRADED_DESTINATION 2
+#define HOL_HEALTHY_DESTINATION 3
+
+/**
+ * Frame airtime making the transmit budget a single frame per slot.
+ */
+#define HOL_SINGLE_FRAME_AIRTIME_US (AT_CONF_SLOT_LENGTH_MS * 1000)
+
+#if (AT_CONF_HOP_BACKOFF != 1)
+#error The head-of-line simulation needs AT_CONF_HOP_BACKOFF.
+#endif
+
+static Airtight_MACState mac_state;
+static Airtight_Packet transmitted[AIRTIGHT_SLOT_MAX_PACKETS];
+static at_u8_t transmitted_count;
+static at_u32_t random_state;
+
+/**
+ * Small deterministic generator so runs are comparable.
+ */
+static at_u32_t HOL_Random(void)
+{
+    random_state = random_state * 1103515245u + 12345u;
+    return (random_state >> 16) & 0x7fff;
+}
+
+static void HOL_TransmitHandler(Airtight_Packet *packet)
+{
+    if (transmitted_count < AIRTIGHT_SLOT_MAX_PACKETS)
+    {
+        memcpy(&transmitted[transmitted_count++], packet, sizeof(Airtight_Packet));
+    }
+}
+
+static void HOL_NotificationHandler(Airtight_Notification *notification)
+{
+    (void)notification;
+}
+
+static void HOL_Send(Airtight_NodeId destination)
+{
+    static at_u16_t sequence_number = 0;
+    Airtight_Packet packet;
+
+    Airtight_InitialisePacket(&packet);
+    packet.data.fields.priority = AIRTIGHT_PRIORITY_MAX;
+    packet.data.fields.criticality = mac_state.queue->criticalities[AIRTIGHT_PRIORITY_MAX];
+    packet.data.fields.destination = destination;
+    packet.data.fields.sequence_number = sequence_number++;
+    packet.data.fields.c_value = 1;
+    Airtight_Send(&mac_state, &packet);
+}
+
+/**
+ * Simulate a run and print its results.
+ */
+static void HOL_Run(const char *name, at_u8_t threshold, at_u32_t airtime_us, size_t cycles, at_u32_t ack_percent)
+{
+    Bench_Samples latency;
+    at_u32_t degraded_frames = 0;
+    at_u32_t degraded_delivered = 0;
+
+    Airtight_InitialiseMACState(&mac_state);
+    Airtight_SetTransmitHandler(&mac_state, HOL_TransmitHandler);
+    Airtight_SetNotificationHandler(&mac_state, HOL_NotificationHandler);
+    Airtight_SetHopFailureThreshold(&mac_state, threshold);
+    mac_state.airtime_us = airtime_us;
+    random_state = 1;
+
+    Bench_SamplesInit(&latency, name, cycles);
+
+    for (size_t cycle = 0; cycle < cycles; cycle++)
+    {
+        if (cycle % HOL_PERIOD_CYCLES == 0)
+        {
+            // The degraded hop's packet is queued first, ahead of the other.
+            HOL_Send(HOL_DEGRADED_DESTINATION);
+            HOL_Send(HOL_HEALTHY_DESTINATION);
+        }
+
+        for (at_u8_t slot = 0; slot < AT_CONF_SLOT_TABLE_ROWS; slot++)
+        {
+            transmitted_count = 0;
+            Airtight_DoSlot(&mac_state, slot);
+
+            for (at_u8_t i = 0; i < transmitted_count; i++)
+            {
+                Airtight_Packet *packet = &transmitted[i];
+                const at_bool_t degraded = packet->data.fields.hop_destination == Airtight_NextHop(HOL_DEGRADED_DESTINATION);
+                const at_bool_t acked = !degraded || HOL_Random() % 100 < ack_percent;
+
+                if (degraded)
+                {
+                    degraded_frames++;
+                    degraded_delivered += acked;
+                }
+                else if (acked)
+                {
+                    Bench_SamplesAdd(&latency, (at_u16_t)(mac_state.local_slot - packet->meta.enqueue_slot));
+                }
+
+                Airtight_RegisterSendComplete(&mac_state, packet, acked);
+            }
+        }
+    }
+
+    Bench_Report(&latency, "slots healthy hop latency");
+    printf("%-40s degraded frames=%lu delivered=%lu\n", "", (unsigned long)degraded_frames, (unsigned long)degraded_delivered);
+    Bench_SamplesFree(&latency);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t cycles = argc > 1 ? strtoul(argv[1], NULL, 10) : HOL_CYCLES;
+    const at_u32_t ack_percent = argc > 2 ? strtoul(argv[2], NULL, 10) : HOL_DEGRADED_ACK_PERCENT;
+
+    printf("HOL: %zu cycles, degraded hop %u acks %lu%% of frames\n", cycles, Airtight_NextHop(HOL_DEGRADED_DESTINATION), (unsigned long)ack_percent);
+
+    HOL_Run("1 frame/slot, no back off", 0, HOL_SINGLE_FRAME_AIRTIME_US, cycles, ack_percent);
+    HOL_Run("1 frame/slot, back off", AT_CONF_HOP_FAILURE_THRESHOLD, HOL_SINGLE_FRAME_AIRTIME_US, cycles, ack_percent);
+    HOL_Run("budgeted frames/slot, no back off", 0, AT_CONF_INITIAL_AIRTIME_US, cycles, ack_percent);
+    HOL_Run("budgeted frames/slot, back off", AT_CONF_HOP_FAILURE_THRESHOLD, AT_CONF_INITIAL_AIRTIME_US, cycles, ack_percent);
+
+    return 0;
+}
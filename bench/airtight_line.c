@@ -0,0 +1,204 @@
+/**
+ * @file
+ * AirTight: end-to-end latency over a five hop line with cut-through relaying.
+ *
+ * Five MAC instances form a line, each transmitting in the slot after the
+ * one before it, so every relay receives just before its own transmit slot.
+ * The first sends packets which the others relay to a sink. Reports the
+ * end-to-end latency in slots and the relays' receive and transmit slot
+ * cycle counts with cut-through relaying disabled and enabled.
+ *
+ * Every instance runs the same node configuration, frames are passed along
+ * the line by the benchmark rather than by routes.
+ *
+ * Usage: airtight_line [packets]
+ */
+#include <string.h>
+
+#include "airtight_mac.h"
+#include "airtight_bench.h"
+
+/**
+ * Default number of packets sent along the line per run.
+ */
+#define LINE_PACKETS 20000
+
+/**
+ * Hops from the first instance to the sink.
+ */
+#define LINE_HOPS 5
+
+/**
+ * Slot table cycles between packets.
+ */
+#define LINE_PERIOD_CYCLES 2
+
+/**
+ * A destination none of the instances are, so each forwards.
+ */
+#define LINE_DESTINATION 9
+
+#if (AT_CONF_CUT_THROUGH != 1)
+#error The line benchmark compares cut-through relaying, enable AT_CONF_CUT_THROUGH.
+#endif
+
+typedef struct
+{
+    Airtight_MACState mac_state;
+    Airtight_Packet staged_frame;
+    Airtight_Packet sent[AIRTIGHT_SLOT_MAX_PACKETS];
+    at_u8_t sent_count;
+} Line_Node;
+
+static Line_Node nodes[LINE_HOPS];
+static Line_Node *current;
+
+static void Line_Sent(const Airtight_Packet *packet)
+{
+    if (current->sent_count < AIRTIGHT_SLOT_MAX_PACKETS)
+    {
+        memcpy(&current->sent[current->sent_count++], packet, sizeof(Airtight_Packet));
+    }
+}
+
+static void Line_TransmitHandler(Airtight_Packet *packet)
+{
+    Line_Sent(packet);
+}
+
+static void Line_StageHandler(Airtight_Packet *packet)
+{
+    memcpy(&current->staged_frame, packet, sizeof(Airtight_Packet));
+}
+
+static void Line_StagedTransmitHandler(Airtight_Packet *packet)
+{
+    current->staged_frame.meta = packet->meta;
+    Line_Sent(&current->staged_frame);
+}
+
+static void Line_NotificationHandler(Airtight_Notification *notification)
+{
+    (void)notification;
+}
+
+/**
+ * The slot an instance sees, shifted by one per hop so each transmits in
+ * the slot after its predecessor.
+ */
+static at_u8_t Line_LocalSlot(size_t slot, size_t hop)
+{
+    return (at_u8_t)((slot + AT_CONF_SLOT_TABLE_ROWS - hop % AT_CONF_SLOT_TABLE_ROWS) % AT_CONF_SLOT_TABLE_ROWS);
+}
+
+static void Line_Send(size_t slot)
+{
+    static at_u16_t sequence_number = 0;
+    Airtight_Packet packet;
+
+    Airtight_InitialisePacket(&packet);
+    packet.data.fields.priority = AIRTIGHT_PRIORITY_MAX;
+    packet.data.fields.criticality = nodes[0].mac_state.queue->criticalities[AIRTIGHT_PRIORITY_MAX];
+    packet.data.fields.destination = LINE_DESTINATION;
+    packet.data.fields.sequence_number = sequence_number++;
+    packet.data.fields.c_value = 1;
+    memcpy(packet.data.fields.data, &slot, sizeof(at_u32_t));
+    current = &nodes[0];
+    Airtight_Send(&nodes[0].mac_state, &packet);
+}
+
+static void Line_Run(at_bool_t cut_through, size_t packets)
+{
+    Bench_Samples latency;
+    Bench_Samples receive;
+    Bench_Samples transmit;
+
+    Bench_SamplesInit(&latency, cut_through ? "end-to-end, cut-through" : "end-to-end, store and forward", packets);
+    Bench_SamplesInit(&receive, cut_through ? "relay receive, cut-through" : "relay receive, store and forward", packets * LINE_HOPS);
+    Bench_SamplesInit(&transmit, cut_through ? "relay transmit slot, cut-through" : "relay transmit slot, store and forward", packets * LINE_HOPS);
+
+    for (size_t hop = 0; hop < LINE_HOPS; hop++)
+    {
+        Airtight_MACState *mac_state = &nodes[hop].mac_state;
+
+        Airtight_InitialiseMACState(mac_state);
+        Airtight_SetTransmitHandler(mac_state, Line_TransmitHandler);
+        Airtight_SetNotificationHandler(mac_state, Line_NotificationHandler);
+        Airtight_SetStagingHandlers(mac_state, Line_StageHandler, Line_StagedTransmitHandler);
+        Airtight_SetCutThrough(mac_state, cut_through);
+    }
+
+    const size_t slots = (packets * LINE_PERIOD_CYCLES + LINE_HOPS) * AT_CONF_SLOT_TABLE_ROWS;
+    size_t sent = 0;
+
+    for (size_t slot = 0; slot < slots; slot++)
+    {
+        if (slot % (LINE_PERIOD_CYCLES * AT_CONF_SLOT_TABLE_ROWS) == 0 && sent < packets)
+        {
+            Line_Send(slot);
+            sent++;
+        }
+
+        for (size_t hop = 0; hop < LINE_HOPS; hop++)
+        {
+            current = &nodes[hop];
+            current->sent_count = 0;
+
+            const at_u64_t start = Bench_Cycles();
+            Airtight_DoSlot(&current->mac_state, Line_LocalSlot(slot, hop));
+            const at_u64_t cycles = Bench_Cycles() - start;
+
+            if (hop > 0 && current->sent_count > 0)
+            {
+                Bench_SamplesAdd(&transmit, cycles);
+            }
+        }
+
+        for (size_t hop = 0; hop < LINE_HOPS; hop++)
+        {
+            for (at_u8_t i = 0; i < nodes[hop].sent_count; i++)
+            {
+                Airtight_Packet *frame = &nodes[hop].sent[i];
+
+                if (hop + 1 < LINE_HOPS)
+                {
+                    Airtight_Packet received;
+                    memcpy(&received, frame, sizeof(Airtight_Packet));
+                    current = &nodes[hop + 1];
+
+                    const at_u64_t start = Bench_Cycles();
+                    Airtight_HandleReceive(&current->mac_state, &received);
+                    Bench_SamplesAdd(&receive, Bench_Cycles() - start);
+                }
+                else
+                {
+                    at_u32_t injected;
+                    memcpy(&injected, frame->data.fields.data, sizeof(at_u32_t));
+                    Bench_SamplesAdd(&latency, slot - injected);
+                }
+
+                current = &nodes[hop];
+                Airtight_RegisterSendComplete(&current->mac_state, frame, true);
+            }
+        }
+    }
+
+    Bench_Report(&latency, "slots");
+    Bench_Report(&receive, "cycles");
+    Bench_Report(&transmit, "cycles");
+    Bench_SamplesFree(&latency);
+    Bench_SamplesFree(&receive);
+    Bench_SamplesFree(&transmit);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t packets = argc > 1 ? strtoul(argv[1], NULL, 10) : LINE_PACKETS;
+
+    printf("Line: %u hops, %zu packets\n", LINE_HOPS, packets);
+
+    Line_Run(false, packets);
+    Line_Run(true, packets);
+
+    return 0;
+}
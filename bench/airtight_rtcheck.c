@@ -0,0 +1,265 @@
+/**
+ * @file
+ * AirTight: real-time verification harness.
+ *
+ * Drives slot processing through Airtight_DoSlot and
+ * Airtight_RegisterSendComplete with a full PCQ and fails if any allocation
+ * or blocking stdio or syscall occurs while doing so. Allocation and I/O
+ * functions are intercepted with the linker's --wrap option, see the
+ * rtcheck target of the Makefile.
+ *
+ * The radio is stubbed by RTCheck_TransmitHandler, so the example
+ * integration's handlers, xbee frame building and the serial write are not
+ * covered. The serial write is the one syscall a transmit slot is expected
+ * to make.
+ */
+#define _DEFAULT_SOURCE
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "airtight_mac.h"
+#include "airtight_realtime.h"
+
+/**
+ * The number of slot table cycles to run.
+ */
+#define RTCHECK_CYCLES 1000
+
+static volatile at_bool_t _armed = false;
+static unsigned long _violations = 0;
+static const char *_first_violation = NULL;
+
+// \cond DO_NOT_DOCUMENT
+#define VIOLATION(name)                         \
+    do                                          \
+    {                                           \
+        if (_armed)                             \
+        {                                       \
+            if (NULL == _first_violation)       \
+                _first_violation = name;        \
+            _violations++;                      \
+        }                                       \
+    } while (0)
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void __real_free(void *pointer);
+int __real_vprintf(const char *format, va_list args);
+int __real_puts(const char *string);
+int __real_putchar(int character);
+int __real_fputs(const char *string, FILE *stream);
+size_t __real_fwrite(const void *data, size_t size, size_t count, FILE *stream);
+int __real_fflush(FILE *stream);
+ssize_t __real_write(int fd, const void *data, size_t length);
+ssize_t __real_read(int fd, void *data, size_t length);
+int __real_nanosleep(const struct timespec *duration, struct timespec *remaining);
+int __real_usleep(useconds_t microseconds);
+int __real_fsync(int fd);
+
+void *__wrap_malloc(size_t size)
+{
+    VIOLATION("malloc");
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    VIOLATION("calloc");
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    VIOLATION("realloc");
+    return __real_realloc(pointer, size);
+}
+
+void __wrap_free(void *pointer)
+{
+    VIOLATION("free");
+    __real_free(pointer);
+}
+
+int __wrap_vprintf(const char *format, va_list args)
+{
+    VIOLATION("vprintf");
+    return __real_vprintf(format, args);
+}
+
+int __wrap_printf(const char *format, ...)
+{
+    va_list args;
+    VIOLATION("printf");
+    va_start(args, format);
+    const int result = __real_vprintf(format, args);
+    va_end(args);
+    return result;
+}
+
+int __wrap_fprintf(FILE *stream, const char *format, ...)
+{
+    va_list args;
+    VIOLATION("fprintf");
+    va_start(args, format);
+    const int result = vfprintf(stream, format, args);
+    va_end(args);
+    return result;
+}
+
+int __wrap_puts(const char *string)
+{
+    VIOLATION("puts");
+    return __real_puts(string);
+}
+
+int __wrap_putchar(int character)
+{
+    VIOLATION("putchar");
+    return __real_putchar(character);
+}
+
+int __wrap_fputs(const char *string, FILE *stream)
+{
+    VIOLATION("fputs");
+    return __real_fputs(string, stream);
+}
+
+size_t __wrap_fwrite(const void *data, size_t size, size_t count, FILE *stream)
+{
+    VIOLATION("fwrite");
+    return __real_fwrite(data, size, count, stream);
+}
+
+int __wrap_fflush(FILE *stream)
+{
+    VIOLATION("fflush");
+    return __real_fflush(stream);
+}
+
+ssize_t __wrap_write(int fd, const void *data, size_t length)
+{
+    VIOLATION("write");
+    return __real_write(fd, data, length);
+}
+
+ssize_t __wrap_read(int fd, void *data, size_t length)
+{
+    VIOLATION("read");
+    return __real_read(fd, data, length);
+}
+
+int __wrap_nanosleep(const struct timespec *duration, struct timespec *remaining)
+{
+    VIOLATION("nanosleep");
+    return __real_nanosleep(duration, remaining);
+}
+
+int __wrap_usleep(useconds_t microseconds)
+{
+    VIOLATION("usleep");
+    return __real_usleep(microseconds);
+}
+
+int __wrap_fsync(int fd)
+{
+    VIOLATION("fsync");
+    return __real_fsync(fd);
+}
+// \endcond
+
+static Airtight_MACState mac_state;
+static Airtight_Packet last_transmitted;
+static at_bool_t transmitted = false;
+
+/**
+ * Stand in for the radio, the frame is kept for the send complete.
+ */
+static void RTCheck_TransmitHandler(Airtight_Packet *packet)
+{
+    memcpy(&last_transmitted, packet, sizeof(Airtight_Packet));
+    transmitted = true;
+}
+
+static void RTCheck_NotificationHandler(Airtight_Notification *notification)
+{
+    (void)notification;
+}
+
+/**
+ * Fill every priority of the PCQ which currently accepts packets.
+ */
+static void RTCheck_Fill(void)
+{
+    static at_u16_t sequence_number = 0;
+
+    for (Airtight_Priority priority = 0; priority < AIRTIGHT_PRIORITIES; priority++)
+    {
+        const size_t free_entries = PRIORITY_CRITICAL_QUEUE_SIZE - Airtight_PCQ_SizePriority(mac_state.queue, priority);
+
+        for (size_t i = 0; i < free_entries; i++)
+        {
+            Airtight_Packet packet;
+            Airtight_InitialisePacket(&packet);
+            packet.data.fields.priority = priority;
+            packet.data.fields.criticality = mac_state.queue->criticalities[priority];
+            packet.data.fields.destination = AT_CONF_NODE_ID + 1;
+            packet.data.fields.sequence_number = sequence_number++;
+            packet.data.fields.c_value = 1;
+            Airtight_Send(&mac_state, &packet);
+        }
+    }
+}
+
+int main(void)
+{
+    Airtight_RealtimeConfig config;
+    Airtight_Realtime_DefaultConfig(&config);
+    if (!Airtight_Realtime_Enter(&config))
+    {
+        puts("rtcheck: note, real-time mode not fully entered, checking slot path only.");
+    }
+
+    Airtight_InitialiseMACState(&mac_state);
+    Airtight_SetTransmitHandler(&mac_state, RTCheck_TransmitHandler);
+    Airtight_SetNotificationHandler(&mac_state, RTCheck_NotificationHandler);
+
+    unsigned long slots = 0;
+    unsigned long transmissions = 0;
+
+    for (unsigned long cycle = 0; cycle < RTCHECK_CYCLES; cycle++)
+    {
+        for (at_u8_t slot = 0; slot < AT_CONF_SLOT_TABLE_ROWS; slot++)
+        {
+            RTCheck_Fill();
+            transmitted = false;
+
+            _armed = true;
+            Airtight_DoSlot(&mac_state, slot);
+            if (transmitted)
+            {
+                // Alternate fails and successes to cover criticality changes.
+                Airtight_RegisterSendComplete(&mac_state, &last_transmitted, (slots % 3) != 0);
+                transmissions++;
+            }
+            _armed = false;
+
+            slots++;
+        }
+    }
+
+    printf("rtcheck: %lu slots, %lu transmissions, %lu violations\n", slots, transmissions, _violations);
+
+    if (_violations > 0)
+    {
+        printf("rtcheck: FAIL, first violation: %s\n", _first_violation);
+        return 1;
+    }
+
+    puts("rtcheck: PASS");
+    return 0;
+}
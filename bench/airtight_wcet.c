@@ -0,0 +1,313 @@
+/**
+ * @file
+ * AirTight: worst-case execution time benchmark of the MAC slot path.
+ *
+ * Drives Airtight_DoSlot, Airtight_RegisterSendComplete and
+ * Airtight_HandleReceive from generated worst-case queue and criticality
+ * states and reports the median, high percentiles and maximum cycle counts
+ * of each. The protocol is built in its real-time configuration, see the
+ * bench target of the Makefile.
+ *
+ * Usage: airtight_wcet [iterations] [p99 budget in cycles]
+ *
+ * Exits with failure if the 99th percentile of any scenario exceeds the
+ * budget, so regressions of the hot path fail the build target.
+ */
+#include <string.h>
+
+#include "airtight_mac.h"
+#include "airtight_bench.h"
+
+/**
+ * Default number of measured calls per scenario.
+ */
+#define WCET_ITERATIONS 20000
+
+/**
+ * Default 99th percentile budget of a scenario in cycles.
+ */
+#define WCET_BUDGET 200000
+
+static Airtight_MACState mac_state;
+static Airtight_Packet last_transmitted;
+static at_u8_t transmit_slot = 0;
+static at_u8_t listen_slot = 0;
+
+static void WCET_TransmitHandler(Airtight_Packet *packet)
+{
+    memcpy(&last_transmitted, packet, sizeof(Airtight_Packet));
+}
+
+static void WCET_StageHandler(Airtight_Packet *packet)
+{
+    memcpy(&last_transmitted, packet, sizeof(Airtight_Packet));
+}
+
+static void WCET_StagedTransmitHandler(Airtight_Packet *packet)
+{
+    last_transmitted.meta = packet->meta;
+}
+
+#if (AT_CONF_AGGREGATION == 1)
+static void WCET_AggregateTransmitHandler(Airtight_Aggregate *aggregate)
+{
+    memcpy(&last_transmitted, &aggregate->packets[0], sizeof(Airtight_Packet));
+}
+#endif
+
+static void WCET_NotificationHandler(Airtight_Notification *notification)
+{
+    (void)notification;
+}
+
+static void WCET_ReceiveCallback(Airtight_Packet *packet)
+{
+    (void)packet;
+}
+
+/**
+ * Make a packet valid for a priority.
+ */
+static void WCET_MakePacket(Airtight_Packet *packet, Airtight_Priority priority, Airtight_NodeId destination)
+{
+    static at_u16_t sequence_number = 0;
+
+    Airtight_InitialisePacket(packet);
+    packet->data.fields.priority = priority;
+    packet->data.fields.criticality = mac_state.queue->criticalities[priority];
+    packet->data.fields.source = AT_CONF_NODE_ID;
+    packet->data.fields.destination = destination;
+    packet->data.fields.sequence_number = sequence_number++;
+    packet->data.fields.c_value = 1;
+}
+
+/**
+ * Reset the MAC to LOW mode with every priority of the PCQ full.
+ */
+static void WCET_FullQueues(void)
+{
+    Airtight_InitialiseMACState(&mac_state);
+    Airtight_SetTransmitHandler(&mac_state, WCET_TransmitHandler);
+    Airtight_SetNotificationHandler(&mac_state, WCET_NotificationHandler);
+    Airtight_SetReceiveCallback(&mac_state, WCET_ReceiveCallback);
+
+    for (Airtight_Priority priority = 0; priority < AIRTIGHT_PRIORITIES; priority++)
+    {
+        for (size_t i = 0; i < PRIORITY_CRITICAL_QUEUE_SIZE; i++)
+        {
+            Airtight_Packet packet;
+            WCET_MakePacket(&packet, priority, AT_CONF_NODE_ID + 1);
+            Airtight_Send(&mac_state, &packet);
+        }
+
+#if (AT_CONF_FORWARD_QUOTAS == 1)
+        // Local packets cannot take the entries reserved for forwarding.
+        while (Airtight_PCQ_SizePriority(mac_state.queue, priority) < PRIORITY_CRITICAL_QUEUE_SIZE)
+        {
+            Airtight_Packet packet;
+            WCET_MakePacket(&packet, priority, AT_CONF_NODE_ID + 1);
+            packet.meta.forwarded = true;
+            Airtight_PCQ_Enqueue(mac_state.queue, &packet);
+        }
+#endif
+    }
+
+    mac_state.current_slot = transmit_slot;
+}
+
+/**
+ * Put the MAC in HIGH mode with full queues of every criticality, as if
+ * LOW packets had been queued before the mode change.
+ */
+static void WCET_HighWithLowQueued(void)
+{
+    WCET_FullQueues();
+    mac_state.criticality_mode = HIGH_CRIT;
+    mac_state.acknowledge_fails = AT_CONF_MAX_NODE_ACK_FAILS;
+}
+
+/**
+ * Take the head packet as if it had just been transmitted.
+ */
+static void WCET_TransmitHead(void)
+{
+    Airtight_Packet *head = Airtight_PCQ_HeadP(mac_state.queue);
+    memcpy(&last_transmitted, head, sizeof(Airtight_Packet));
+}
+
+typedef void (*WCET_Setup)(void);
+typedef void (*WCET_Call)(void);
+
+static void WCET_CallTransmitSlot(void)
+{
+    Airtight_DoSlot(&mac_state, transmit_slot);
+}
+
+static void WCET_SetupTransmitLow(void)
+{
+    WCET_FullQueues();
+    mac_state.current_slot = listen_slot;
+}
+
+static void WCET_SetupTransmitStaged(void)
+{
+    WCET_FullQueues();
+    Airtight_SetStagingHandlers(&mac_state, WCET_StageHandler, WCET_StagedTransmitHandler);
+    // Staged in the slot before, as the frame would be while listening.
+    mac_state.current_slot = (transmit_slot + AT_CONF_SLOT_TABLE_ROWS - 1) % AT_CONF_SLOT_TABLE_ROWS;
+    Airtight_StageTransmit(&mac_state);
+}
+
+#if (AT_CONF_AGGREGATION == 1)
+static void WCET_SetupTransmitAggregated(void)
+{
+    WCET_FullQueues();
+    Airtight_SetAggregateTransmitHandler(&mac_state, WCET_AggregateTransmitHandler);
+    mac_state.current_slot = listen_slot;
+}
+#endif
+
+static void WCET_SetupTransmitHighGoingLow(void)
+{
+    WCET_HighWithLowQueued();
+    // Only LOW packets remain so the transmit path must fall back to LOW.
+    for (Airtight_Priority priority = 0; priority < AIRTIGHT_PRIORITIES; priority++)
+    {
+        if (mac_state.queue->criticalities[priority] == HIGH_CRIT)
+        {
+            Airtight_PCQ_ClearPriority(mac_state.queue, priority);
+        }
+    }
+    mac_state.current_slot = listen_slot;
+}
+
+static void WCET_CallAckFail(void)
+{
+    Airtight_RegisterSendComplete(&mac_state, &last_transmitted, false);
+}
+
+static void WCET_CallAckSuccess(void)
+{
+    Airtight_RegisterSendComplete(&mac_state, &last_transmitted, true);
+}
+
+static void WCET_SetupAckFailGoingHigh(void)
+{
+    // One more failure crosses the threshold and clears every LOW queue.
+    WCET_FullQueues();
+    mac_state.acknowledge_fails = AT_CONF_CRITICALITY_CHANGE_THRESHOLD - 1;
+    WCET_TransmitHead();
+}
+
+static void WCET_SetupAckFailRetransmitLimit(void)
+{
+    WCET_HighWithLowQueued();
+    Airtight_Packet *head = Airtight_PCQ_HeadP(mac_state.queue);
+    head->meta.local_retransmit_count = AT_CONF_RETRANSMISSION_LIMIT_HIGH;
+    WCET_TransmitHead();
+}
+
+static void WCET_SetupAckSuccess(void)
+{
+    WCET_FullQueues();
+    WCET_TransmitHead();
+}
+
+static Airtight_Packet received;
+
+static void WCET_CallReceive(void)
+{
+    Airtight_HandleReceive(&mac_state, &received);
+}
+
+static void WCET_SetupReceiveForwardFull(void)
+{
+    // Forwarding into a full queue overwrites its oldest entry.
+    WCET_FullQueues();
+    mac_state.current_slot = listen_slot;
+    WCET_MakePacket(&received, AIRTIGHT_PRIORITY_MIN, AT_CONF_NODE_ID + 1);
+    received.data.fields.source = AT_CONF_NODE_ID + 2;
+}
+
+static void WCET_SetupReceiveDeliver(void)
+{
+    WCET_FullQueues();
+    mac_state.current_slot = listen_slot;
+    WCET_MakePacket(&received, AIRTIGHT_PRIORITY_MIN, AT_CONF_NODE_ID);
+    received.data.fields.source = AT_CONF_NODE_ID + 2;
+}
+
+/**
+ * A benchmark scenario, the setup is not measured.
+ */
+typedef struct
+{
+    const char *name;
+    WCET_Setup setup;
+    WCET_Call call;
+} WCET_Scenario;
+
+static const WCET_Scenario _SCENARIOS[] = {
+    {"DoSlot transmit, full queues", WCET_SetupTransmitLow, WCET_CallTransmitSlot},
+    {"DoSlot transmit, staged frame", WCET_SetupTransmitStaged, WCET_CallTransmitSlot},
+#if (AT_CONF_AGGREGATION == 1)
+    {"DoSlot transmit, aggregated", WCET_SetupTransmitAggregated, WCET_CallTransmitSlot},
+#endif
+    {"DoSlot transmit, HIGH going LOW", WCET_SetupTransmitHighGoingLow, WCET_CallTransmitSlot},
+    {"SendComplete ack, full queues", WCET_SetupAckSuccess, WCET_CallAckSuccess},
+    {"SendComplete fail, going HIGH + clear", WCET_SetupAckFailGoingHigh, WCET_CallAckFail},
+    {"SendComplete fail, retransmit limit", WCET_SetupAckFailRetransmitLimit, WCET_CallAckFail},
+    {"HandleReceive forward, full queue", WCET_SetupReceiveForwardFull, WCET_CallReceive},
+    {"HandleReceive deliver", WCET_SetupReceiveDeliver, WCET_CallReceive},
+};
+
+/**
+ * Find the first transmit and listen slots of this node.
+ */
+static void WCET_FindSlots(void)
+{
+    for (at_u8_t slot = 0; slot < AT_CONF_SLOT_TABLE_ROWS; slot++)
+    {
+        if (slot == AT_CONF_SYNC_SLOT_INDEX)
+            continue;
+        if (Airtight_GetSlotAction(LOW_CRIT, slot, slot) == ACTION_TRANSMIT && transmit_slot == 0)
+            transmit_slot = slot;
+        if (Airtight_GetSlotAction(LOW_CRIT, slot, slot) != ACTION_TRANSMIT && listen_slot == 0)
+            listen_slot = slot;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : WCET_ITERATIONS;
+    const at_u64_t budget = argc > 2 ? strtoull(argv[2], NULL, 10) : WCET_BUDGET;
+    at_bool_t over_budget = false;
+
+    WCET_FindSlots();
+
+    printf("WCET: %zu iterations per scenario, p99 budget %llu cycles\n", iterations, (unsigned long long)budget);
+
+    for (size_t s = 0; s < sizeof(_SCENARIOS) / sizeof(_SCENARIOS[0]); s++)
+    {
+        Bench_Samples samples;
+        Bench_SamplesInit(&samples, _SCENARIOS[s].name, iterations);
+
+        for (size_t i = 0; i < iterations; i++)
+        {
+            _SCENARIOS[s].setup();
+            const at_u64_t start = Bench_Cycles();
+            _SCENARIOS[s].call();
+            Bench_SamplesAdd(&samples, Bench_Cycles() - start);
+        }
+
+        Bench_Report(&samples, "cycles");
+        if (Bench_Percentile(&samples, 99.0) > budget)
+        {
+            printf("WCET: FAIL, %s exceeds budget\n", _SCENARIOS[s].name);
+            over_budget = true;
+        }
+        Bench_SamplesFree(&samples);
+    }
+
+    return over_budget ? 1 : 0;
+}
@@ -4,6 +4,11 @@
  * @file
  * AirTight: example integration of AirTight implementation.
  */
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <time.h>
+
 #include "airtight.h"
 
 /**
@@ -16,8 +21,15 @@
 typedef struct
 {
     Airtight_Packet packet;
+#if (AT_CONF_AGGREGATION == 1)
+    Airtight_Aggregate aggregate;
+    at_bool_t aggregated;
+#endif
     at_bool_t notification;
     at_bool_t active;
+    // Reserved by the staged frame, which is not yet in flight
+    at_bool_t staged;
+    at_u32_t write_time_us;
 } Integration_TransmitRecord;
 
 /**
@@ -25,11 +37,40 @@ typedef struct
  */
 Airtight_MACState mac_state;
 
+/**
+ * Reassembly of fragmented messages received by the application.
+ */
+Airtight_Reassembler reassembler;
+
+/**
+ * Fragmentation of messages sent by the application.
+ */
+Airtight_Fragmenter fragmenter;
+
+/**
+ * Application level message handler.
+ *
+ * The message is read in place from the reassembly pool and released once
+ * handled.
+ */
+void App_HandleMessage(Airtight_Message *message)
+{
+    AT_DEBUG("Received message at callback");
+    printf("Message from %u flow %u, %u bytes\n", message->source, message->flow_id, message->length);
+    Airtight_Fragment_Release(&reassembler, message);
+}
+
 /**
  * Application level receive handler.
  */
 void App_HandleReceive(Airtight_Packet *packet)
 {
+    if (Airtight_Fragment_IsFragment(packet))
+    {
+        Airtight_Fragment_Receive(&reassembler, packet, Airtight_Time_GetSynchronisedTime(&mac_state.time));
+        return;
+    }
+
     AT_DEBUG("Received packet at callback");
     Airtight_PrintPacket(packet);
 }
@@ -48,18 +89,41 @@ Integration_TransmitRecord packet_id_table[256] = {{.active = false}};
 void Integration_TransmitStatusHandler(at_u8_t packet_id, at_u8_t status)
 {
     AT_ENTER(Integration_TransmitStatusHandler);
+    static at_u32_t last_status_us = 0;
+
     if (status == 0x00 || status == 0x01)
     {
         if (packet_id_table[packet_id].active)
         {
             AT_DEBUG("Integration_TransmitStatusHandler: identified packet");
+
+            // Frames written back to back queue in the radio, so airtime is
+            // measured from when the previous frame completed if later.
+            const at_u32_t now_us = Airtight_Time_MonotonicUS();
+            at_u32_t start_us = packet_id_table[packet_id].write_time_us;
+            if ((at_i32_t)(last_status_us - start_us) > 0)
+            {
+                start_us = last_status_us;
+            }
+            last_status_us = now_us;
+
             if (packet_id_table[packet_id].notification)
             {
                 AT_DEBUG("Integration_TransmitStatusHandler: notification status, ignoring");
             }
             else
             {
-                Airtight_RegisterSendComplete(&mac_state, &packet_id_table[packet_id].packet, status == 0x00);
+                Airtight_RegisterAirtime(&mac_state, now_us - start_us);
+#if (AT_CONF_AGGREGATION == 1)
+                if (packet_id_table[packet_id].aggregated)
+                {
+                    Airtight_RegisterAggregateSendComplete(&mac_state, &packet_id_table[packet_id].aggregate, status == 0x00);
+                }
+                else
+#endif
+                {
+                    Airtight_RegisterSendComplete(&mac_state, &packet_id_table[packet_id].packet, status == 0x00);
+                }
             }
             packet_id_table[packet_id].active = false;
         }
@@ -70,6 +134,83 @@ void Integration_TransmitStatusHandler(at_u8_t packet_id, at_u8_t status)
     }
 }
 
+#if (AT_CONF_AGGREGATION == 1)
+// \cond DO_NOT_DOCUMENT
+#define Integration_ClearAggregated(record) ((record)->aggregated = false)
+// \endcond
+#else
+// \cond DO_NOT_DOCUMENT
+#define Integration_ClearAggregated(record)
+// \endcond
+#endif
+
+/**
+ * Take the next radio frame ID whose transmission record is free.
+ *
+ * Frame IDs are 8 bits, so after they wrap an ID may still belong to a frame
+ * awaiting its status or to the staged frame. Those IDs are skipped.
+ */
+at_u8_t Integration_NextFrameId(void)
+{
+    at_u8_t frame_id = xbee_next_frame_id(&mac_state.radio->device);
+
+    for (at_u16_t tries = 0; tries < 255 && (packet_id_table[frame_id].active || packet_id_table[frame_id].staged); tries++)
+    {
+        frame_id = xbee_next_frame_id(&mac_state.radio->device);
+    }
+
+    return frame_id;
+}
+
+/**
+ * Fill in the radio header for a packet.
+ */
+void Integration_BuildTransmitHeader(xbee_header_transmit_t *transmit_header, const Airtight_Packet *packet, at_u8_t frame_id)
+{
+    transmit_header->frame_type = XBEE_FRAME_TRANSMIT;
+    transmit_header->frame_id = frame_id;
+    transmit_header->ieee_address = _WPAN_IEEE_ADDR_UNDEFINED;
+    const at_u16_t address_endienness_swapped = AT_CONF_ADDRESS_HIGH_BYTE + (packet->data.fields.hop_destination << 8);
+    transmit_header->network_address_be = address_endienness_swapped;
+    transmit_header->broadcast_radius = 0;
+    transmit_header->options = 0;
+}
+
+/**
+ * Largest radio payload of a single packet.
+ */
+#if (AT_CONF_COMPACT_ENCODING == 1)
+#define INTEGRATION_PAYLOAD_MAX AIRTIGHT_CODEC_MAX_SIZE
+#else
+#define INTEGRATION_PAYLOAD_MAX AIRTIGHT_PACKET_SIZE
+#endif
+
+/**
+ * Encode a packet as the radio payload.
+ *
+ * @return the payload length
+ */
+at_u16_t Integration_EncodePacket(const Airtight_Packet *packet, at_u8_t *payload)
+{
+#if (AT_CONF_COMPACT_ENCODING == 1)
+    return Airtight_Codec_Encode(packet, payload, INTEGRATION_PAYLOAD_MAX);
+#else
+    memcpy(payload, packet->data.raw, AIRTIGHT_PACKET_SIZE);
+    return AIRTIGHT_PACKET_SIZE;
+#endif
+}
+
+/**
+ * Write a payload with a prepared header to the radio.
+ */
+void Integration_WriteFrame(const xbee_header_transmit_t *transmit_header, const at_u8_t *payload, at_u16_t length)
+{
+    AT_PROFILE_ENTER(PHASE_SERIAL_WRITE);
+    xbee_frame_write(&mac_state.radio->device, transmit_header, sizeof(*transmit_header), payload, length, 0);
+    AT_PROFILE_EXIT(PHASE_SERIAL_WRITE);
+    AT_PROFILE_FRAME_ON_WIRE();
+}
+
 /**
  * Transmission handler.
  *
@@ -79,22 +220,126 @@ void Integration_TransmitHandler(Airtight_Packet *packet)
 {
     AT_ENTER(Integration_TransmitHandler);
     xbee_header_transmit_t transmit_header;
-    transmit_header.frame_type = XBEE_FRAME_TRANSMIT;
-    transmit_header.frame_id = xbee_next_frame_id(&mac_state.radio->device);
-    transmit_header.ieee_address = _WPAN_IEEE_ADDR_UNDEFINED;
-    const at_u16_t address_endienness_swapped = AT_CONF_ADDRESS_HIGH_BYTE + (packet->data.fields.hop_destination << 8);
-    transmit_header.network_address_be = address_endienness_swapped;
-    transmit_header.broadcast_radius = 0;
-    transmit_header.options = 0;
+    Integration_BuildTransmitHeader(&transmit_header, packet, Integration_NextFrameId());
 
     memcpy(&packet_id_table[transmit_header.frame_id].packet, packet, sizeof(Airtight_Packet));
+    Integration_ClearAggregated(&packet_id_table[transmit_header.frame_id]);
     packet_id_table[transmit_header.frame_id].notification = false;
     packet_id_table[transmit_header.frame_id].active = true;
+    packet_id_table[transmit_header.frame_id].write_time_us = Airtight_Time_MonotonicUS();
+
+    at_u8_t payload[INTEGRATION_PAYLOAD_MAX];
+    const at_u16_t length = Integration_EncodePacket(packet, payload);
 
     AT_DEBUG("Integration_TransmitHandler: Transmitting!");
-    xbee_frame_write(&mac_state.radio->device, &transmit_header, sizeof(transmit_header), &packet->data.raw, AIRTIGHT_PACKET_META + AIRTIGHT_DATA, 0);
+    Integration_WriteFrame(&transmit_header, payload, length);
+}
+
+#if (AT_CONF_AGGREGATION == 1)
+/**
+ * Aggregate transmission handler.
+ *
+ * Sends several packets for the same hop destination as one frame, the
+ * aggregate is kept so its status can be registered for every packet.
+ */
+void Integration_AggregateTransmitHandler(Airtight_Aggregate *aggregate)
+{
+    AT_ENTER(Integration_AggregateTransmitHandler);
+    xbee_header_transmit_t transmit_header;
+    Integration_BuildTransmitHeader(&transmit_header, &aggregate->packets[0], Integration_NextFrameId());
+
+    Integration_TransmitRecord *record = &packet_id_table[transmit_header.frame_id];
+    memcpy(&record->aggregate, aggregate, sizeof(Airtight_Aggregate));
+    record->aggregated = true;
+    record->notification = false;
+    record->active = true;
+    record->write_time_us = Airtight_Time_MonotonicUS();
+
+    AT_DEBUG("Integration_AggregateTransmitHandler: Transmitting!");
+    Integration_WriteFrame(&transmit_header, aggregate->raw, Airtight_Aggregate_Length(aggregate));
+}
+#endif
+
+#if (AT_CONF_STAGED_TRANSMIT == 1)
+/**
+ * Header of the frame staged for the next transmit slot.
+ */
+xbee_header_transmit_t staged_header;
+
+/**
+ * Encoded payload of the staged frame, the fields sent do not change in the
+ * slot.
+ */
+at_u8_t staged_payload[INTEGRATION_PAYLOAD_MAX];
+
+/**
+ * Length of the staged payload.
+ */
+at_u16_t staged_length = 0;
+
+/**
+ * Staging handler.
+ *
+ * Builds the radio header and transmission record ahead of the transmit
+ * slot. The record stays inactive until the frame is written, and keeps its
+ * frame ID while the frame is restaged.
+ */
+void Integration_StageHandler(Airtight_Packet *packet)
+{
+    AT_ENTER(Integration_StageHandler);
+    const at_u8_t frame_id = packet_id_table[staged_header.frame_id].staged ? staged_header.frame_id : Integration_NextFrameId();
+
+    Integration_BuildTransmitHeader(&staged_header, packet, frame_id);
+    staged_length = Integration_EncodePacket(packet, staged_payload);
+
+    memcpy(&packet_id_table[frame_id].packet, packet, sizeof(Airtight_Packet));
+    Integration_ClearAggregated(&packet_id_table[frame_id]);
+    packet_id_table[frame_id].notification = false;
+    packet_id_table[frame_id].active = false;
+    packet_id_table[frame_id].staged = true;
+}
+
+/**
+ * Staged transmission handler.
+ *
+ * Writes the frame built by Integration_StageHandler, only the metadata
+ * refreshed in the slot is copied.
+ */
+void Integration_StagedTransmitHandler(Airtight_Packet *packet)
+{
+    AT_ENTER(Integration_StagedTransmitHandler);
+    Integration_TransmitRecord *record = &packet_id_table[staged_header.frame_id];
+
+    record->packet.meta = packet->meta;
+    record->staged = false;
+    record->active = true;
+    record->write_time_us = Airtight_Time_MonotonicUS();
+
+    AT_DEBUG("Integration_StagedTransmitHandler: Transmitting!");
+    Integration_WriteFrame(&staged_header, staged_payload, staged_length);
+}
+#endif
+
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+/**
+ * Pre-issues the next slot's channel to the radio.
+ */
+void Integration_QueueChannelHandler(at_u8_t channel)
+{
+    AT_ENTER(Integration_QueueChannelHandler);
+    Airtight_Radio_QueueChannel(mac_state.radio, channel);
 }
 
+/**
+ * Retunes the radio at the start of a slot.
+ */
+void Integration_ApplyChannelHandler(at_u8_t channel)
+{
+    AT_ENTER(Integration_ApplyChannelHandler);
+    Airtight_Radio_ApplyChannel(mac_state.radio, channel);
+}
+#endif
+
 /**
  * Notification transmission handler.
  *
@@ -105,7 +350,7 @@ void Integration_NotificationHandler(Airtight_Notification *notification)
     AT_ENTER(Integration_NotificationHandler);
     xbee_header_transmit_t transmit_header;
     transmit_header.frame_type = XBEE_FRAME_TRANSMIT;
-    transmit_header.frame_id = xbee_next_frame_id(&mac_state.radio->device);
+    transmit_header.frame_id = Integration_NextFrameId();
     transmit_header.ieee_address = _WPAN_IEEE_ADDR_UNDEFINED;
     transmit_header.network_address_be = WPAN_NET_ADDR_BCAST_ALL_NODES;
     transmit_header.broadcast_radius = 0;
@@ -113,6 +358,7 @@ void Integration_NotificationHandler(Airtight_Notification *notification)
 
     packet_id_table[transmit_header.frame_id].notification = true;
     packet_id_table[transmit_header.frame_id].active = true;
+    packet_id_table[transmit_header.frame_id].write_time_us = Airtight_Time_MonotonicUS();
 
     AT_DEBUG("Integration_NotificationHandler: Transmitting Notification!");
     xbee_frame_write(&mac_state.radio->device, &transmit_header, sizeof(transmit_header), &notification->raw, AIRTIGHT_NOTIFICATION_PACKET, 0);
@@ -123,15 +369,52 @@ void Integration_NotificationHandler(Airtight_Notification *notification)
  *
  * Takes packets from the radio and sends them to AirTight.
  */
-void Integration_ReceiveHandler(at_u8_t *raw_packet, at_u16_t length)
+void Integration_ReceiveHandler(at_u8_t *raw_packet, at_u16_t length, const Airtight_Radio_FrameInfo *info)
 {
     AT_ENTER(Integration_ReceiveHandler);
+    const Airtight_NodeId hop_source = info->source & 0xff;
+
+#if (AT_CONF_AGGREGATION == 1)
+    if (Airtight_Aggregate_IsAggregate(raw_packet, length))
+    {
+        AT_DEBUG("Integration_ReceiveHandler: Received aggregate");
+        Airtight_Packet packets[AIRTIGHT_AGGREGATE_MAX_PACKETS];
+        const at_u8_t count = Airtight_Aggregate_Unpack(raw_packet, length, hop_source, packets, AIRTIGHT_AGGREGATE_MAX_PACKETS);
+
+        for (at_u8_t i = 0; i < count; i++)
+        {
+            Airtight_HandleReceive(&mac_state, &packets[i]);
+        }
+        return;
+    }
+#endif
 
-    if (length >= AIRTIGHT_PACKET_META)
+    // Notifications are the only broadcast frames.
+    if (info->broadcast && length == AIRTIGHT_NOTIFICATION_PACKET)
+    {
+        AT_DEBUG("Integration_ReceiveHandler: Received notification");
+        Airtight_Notification notification;
+
+        memcpy(&notification.raw, raw_packet, length < sizeof(notification.raw) ? length : sizeof(notification.raw));
+
+        Airtight_HandleNotificationReceive(&mac_state, &notification);
+    }
+    else if (Airtight_Codec_IsCompact(raw_packet, length))
+    {
+        AT_DEBUG("Integration_ReceiveHandler: Received compact packet");
+        Airtight_Packet packet;
+
+        if (Airtight_Codec_Decode(raw_packet, length, hop_source, &packet) > 0)
+        {
+            Airtight_HandleReceive(&mac_state, &packet);
+        }
+    }
+    else if (length >= AIRTIGHT_PACKET_META)
     {
         AT_DEBUG("Integration_ReceiveHandler: Received packet");
         Airtight_Packet packet;
 
+        Airtight_InitialisePacket(&packet);
         memset(&packet.data.raw, 0, sizeof(packet.data.raw));
         memcpy(&packet.data.raw, raw_packet, length < sizeof(packet.data.raw) ? length : sizeof(packet.data.raw));
 
@@ -141,15 +424,6 @@ void Integration_ReceiveHandler(at_u8_t *raw_packet, at_u16_t length)
 
         Airtight_HandleReceive(&mac_state, &packet);
     }
-    else if (length == AIRTIGHT_NOTIFICATION_PACKET)
-    {
-        AT_DEBUG("Integration_ReceiveHandler: Received notification");
-        Airtight_Notification notification;
-
-        memcpy(&notification.raw, raw_packet, length < sizeof(notification.raw) ? length : sizeof(notification.raw));
-
-        Airtight_HandleNotificationReceive(&mac_state, &notification);
-    }
 }
 
 /**
@@ -210,10 +484,101 @@ void App_Tick(at_u8_t slot)
 #endif
 
         memcpy(packet_to_send.data.fields.data, packet_content.raw, sizeof(packet_content.raw));
+        packet_to_send.meta.data_length = 1 + packet_content.fields.length;
         Airtight_Send(&mac_state, &packet_to_send);
     }
+
+#if (AT_CONF_NODE_ID == 0)
+    // Occasionally send a configuration blob too large for one packet.
+    if (slot_counter == 0 && incremented)
+    {
+        Airtight_Packet message_header;
+        at_u8_t message[40];
+
+        Airtight_InitialisePacket(&message_header);
+        message_header.data.fields.c_value = 1;
+        message_header.data.fields.priority = 0;
+        message_header.data.fields.criticality = LOW_CRIT;
+        message_header.data.fields.destination = 0x02;
+        message_header.data.fields.flow_id = 0x01;
+
+        for (size_t i = 0; i < sizeof(message); i++)
+        {
+            message[i] = i;
+        }
+
+        if (!Airtight_Fragment_Send(&fragmenter, &mac_state, &message_header, message, sizeof(message)))
+        {
+            AT_DEBUG("App_Tick: no queue space for message");
+        }
+    }
+#endif
 }
 
+#if (defined(AIRTIGHT_LOGGING) && AT_CONF_LOG_DEFERRED == 1) || AT_CONF_PROFILER == 1
+// \cond DO_NOT_DOCUMENT
+#define INTEGRATION_DRAIN 1
+// \endcond
+#else
+// \cond DO_NOT_DOCUMENT
+#define INTEGRATION_DRAIN 0
+// \endcond
+#endif
+
+#if (INTEGRATION_DRAIN == 1)
+/**
+ * Drains between profiler statistics dumps, about every 600 slots.
+ */
+#define INTEGRATION_PROFILE_DUMP_DRAINS ((600 * AT_CONF_SLOT_LENGTH_MS) / AT_CONF_DRAIN_INTERVAL_MS)
+
+/**
+ * Drain thread.
+ *
+ * Prints deferred log entries and processes profiler events so neither
+ * stdout nor the raw profile file is written from the slotter. It is started
+ * before real-time mode is entered so it keeps the default scheduling policy
+ * and cannot delay slot processing.
+ *
+ * The argument is the raw profile file, or NULL.
+ */
+void *Integration_DrainThread(void *argument)
+{
+    const struct timespec interval = {
+        .tv_sec = AT_CONF_DRAIN_INTERVAL_MS / 1000,
+        .tv_nsec = (AT_CONF_DRAIN_INTERVAL_MS % 1000) * 1000000L,
+    };
+#if (AT_CONF_PROFILER == 1)
+    FILE *profile_raw = argument;
+    at_u32_t drains = 0;
+#else
+    (void)argument;
+#endif
+
+    while (1)
+    {
+#if defined(AIRTIGHT_LOGGING) && (AT_CONF_LOG_DEFERRED == 1)
+        Airtight_Log_Flush(stdout);
+#endif
+#if (AT_CONF_PROFILER == 1)
+        Airtight_Profiler_Process(profile_raw);
+        if (++drains >= INTEGRATION_PROFILE_DUMP_DRAINS)
+        {
+            drains = 0;
+            Airtight_Profiler_Dump(stdout);
+            if (NULL != profile_raw)
+            {
+                fflush(profile_raw);
+            }
+        }
+#endif
+        fflush(stdout);
+        nanosleep(&interval, NULL);
+    }
+
+    return NULL;
+}
+#endif
+
 /**
  * Integration example entry point.
  */
@@ -247,20 +612,82 @@ int main(void)
     getchar();
 
     Airtight_InitialiseMACState(&mac_state);
+
+#if (AT_CONF_PCQ_PERSISTENT == 1)
+    static Airtight_PCQ_Persist persist;
+    Airtight_PriorityCriticalQueue *persistent_queue = Airtight_PCQ_Persist_Open(&persist, AT_CONF_PCQ_PERSIST_PATH);
+    if (NULL == persistent_queue)
+    {
+        puts("Error: failed to open persistent PCQ.");
+        return 1;
+    }
+    if (persist.recovered)
+    {
+        printf("Recovered %zu packets from persistent PCQ.\n", Airtight_PCQ_Size(persistent_queue));
+    }
+    Airtight_SetQueue(&mac_state, persistent_queue);
+#endif
+
     at_u8_t slot = 0xff;
     at_time_t counter = 0;
 
     Airtight_SetReceiveCallback(&mac_state, App_HandleReceive);
+    Airtight_Fragment_InitSender(&fragmenter);
+    Airtight_Fragment_InitReceiver(&reassembler, App_HandleMessage);
     Airtight_SetTransmitHandler(&mac_state, Integration_TransmitHandler);
     Airtight_SetNotificationHandler(&mac_state, Integration_NotificationHandler);
+#if (AT_CONF_AGGREGATION == 1)
+    Airtight_SetAggregateTransmitHandler(&mac_state, Integration_AggregateTransmitHandler);
+#endif
+#if (AT_CONF_STAGED_TRANSMIT == 1)
+    Airtight_SetStagingHandlers(&mac_state, Integration_StageHandler, Integration_StagedTransmitHandler);
+#endif
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+    Airtight_SetChannelHandlers(&mac_state, Integration_QueueChannelHandler, Integration_ApplyChannelHandler);
+#endif
+
+#if (INTEGRATION_DRAIN == 1)
+    void *drain_argument = NULL;
+#if (AT_CONF_PROFILER == 1)
+    // Raw events are kept for the offline report tool.
+    FILE *profile_raw = fopen("airtight_profile.bin", "wb");
+    if (NULL == profile_raw)
+    {
+        puts("Warning: failed to open airtight_profile.bin, raw profiler events are not saved.");
+    }
+    drain_argument = profile_raw;
+#endif
+
+    pthread_t drain_thread;
+    if (pthread_create(&drain_thread, NULL, Integration_DrainThread, drain_argument) != 0)
+    {
+        puts("Error: failed to start drain thread.");
+        return 1;
+    }
+#endif
+
+#if (AT_CONF_REALTIME == 1)
+    Airtight_RealtimeConfig realtime_config;
+    Airtight_Realtime_DefaultConfig(&realtime_config);
+    if (!Airtight_Realtime_Enter(&realtime_config))
+    {
+        puts("Warning: running without full real-time guarantees.");
+    }
+#endif
 
     // Core event loop
     while (1)
     {
+        AT_PROFILE_ENTER(PHASE_APP_TICK);
         App_Tick(slot);
+        AT_PROFILE_EXIT(PHASE_APP_TICK);
+        AT_PROFILE_ENTER(PHASE_RADIO_TICK);
         Airtight_Radio_DeviceTick(&radio);
+        AT_PROFILE_EXIT(PHASE_RADIO_TICK);
         Airtight_Slotter_SingleThreadedSlotterTick(&mac_state, &slot, &counter);
+        AT_PROFILE_ENTER(PHASE_RADIO_TICK);
         Airtight_Radio_DeviceTick(&radio);
+        AT_PROFILE_EXIT(PHASE_RADIO_TICK);
     }
 
     return 0;
@@ -11,9 +11,12 @@
 #include "airtight_utilities.h"
 #include "airtight_packet.h"
 #include "airtight_mac.h"
+#include "airtight_fragment.h"
 #include "airtight_radio.h"
 #include "airtight_slotter.h"
 #include "airtight_time.h"
+#include "airtight_realtime.h"
+#include "airtight_profiler.h"
 
 #include <stdio.h>
 
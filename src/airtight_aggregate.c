@@ -0,0 +1,124 @@
+/**
+ * @addtogroup Airtight_Aggregate
+ * @{
+ * @file
+ * AirTight: aggregation of packets into a single radio frame implementation.
+ *
+ * An aggregate frame is the marker byte, a count of packets and then each
+ * packet back to back, either in the compact encoding or as its full
+ * transmissible data. Each entry's first byte tells the two apart.
+ */
+#include "airtight_aggregate.h"
+
+/**
+ * Initialise an empty aggregate.
+ */
+void Airtight_Aggregate_Init(Airtight_Aggregate *aggregate)
+{
+    aggregate->count = 0;
+    aggregate->length = AIRTIGHT_AGGREGATE_HEADER;
+    aggregate->raw[0] = AIRTIGHT_AGGREGATE_MARKER;
+    aggregate->raw[1] = 0;
+}
+
+/**
+ * Add a packet ready for sending to an aggregate.
+ *
+ * @return true if the packet was added, false if the aggregate is full
+ */
+at_bool_t Airtight_Aggregate_Add(Airtight_Aggregate *aggregate, const Airtight_Packet *packet)
+{
+    if (Airtight_Aggregate_Full(aggregate))
+    {
+        return false;
+    }
+
+#if (AT_CONF_COMPACT_ENCODING == 1)
+    const at_u16_t entry_length = Airtight_Codec_Encode(packet, &aggregate->raw[aggregate->length], AT_CONF_AGGREGATE_MAX_PAYLOAD - aggregate->length);
+#else
+    const at_u16_t entry_length = AIRTIGHT_PACKET_SIZE;
+    memcpy(&aggregate->raw[aggregate->length], packet->data.raw, AIRTIGHT_PACKET_SIZE);
+#endif
+
+    memcpy(&aggregate->packets[aggregate->count], packet, sizeof(Airtight_Packet));
+    aggregate->length += entry_length;
+    aggregate->count++;
+    aggregate->raw[1] = aggregate->count;
+
+    return true;
+}
+
+/**
+ * Check whether another packet, of any length, fits in an aggregate.
+ */
+at_bool_t Airtight_Aggregate_Full(const Airtight_Aggregate *aggregate)
+{
+    return aggregate->count >= AIRTIGHT_AGGREGATE_MAX_PACKETS ||
+           aggregate->length + AIRTIGHT_AGGREGATE_ENTRY_MAX > AT_CONF_AGGREGATE_MAX_PAYLOAD;
+}
+
+/**
+ * The length of the encoded aggregate frame in bytes.
+ */
+at_u16_t Airtight_Aggregate_Length(const Airtight_Aggregate *aggregate)
+{
+    return aggregate->length;
+}
+
+/**
+ * Check whether a received frame is an aggregate.
+ */
+at_bool_t Airtight_Aggregate_IsAggregate(const at_u8_t *raw, at_u16_t length)
+{
+    return length >= AIRTIGHT_AGGREGATE_HEADER && raw[0] == AIRTIGHT_AGGREGATE_MARKER;
+}
+
+/**
+ * Split a received aggregate frame into its packets.
+ *
+ * Packets beyond the received length or max_packets are ignored. hop_source
+ * is the 802.15.4 source of the frame, needed by compact packets.
+ *
+ * @return the number of packets written to packets_out
+ */
+at_u8_t Airtight_Aggregate_Unpack(const at_u8_t *raw, at_u16_t length, Airtight_NodeId hop_source, Airtight_Packet *packets_out, at_u8_t max_packets)
+{
+    if (!Airtight_Aggregate_IsAggregate(raw, length))
+    {
+        return 0;
+    }
+
+    const at_u8_t count = raw[1] < max_packets ? raw[1] : max_packets;
+    at_u16_t position = AIRTIGHT_AGGREGATE_HEADER;
+    at_u8_t unpacked = 0;
+
+    while (unpacked < count && position < length)
+    {
+        at_u16_t entry_length;
+
+        if (Airtight_Codec_IsCompact(&raw[position], length - position))
+        {
+            entry_length = Airtight_Codec_Decode(&raw[position], length - position, hop_source, &packets_out[unpacked]);
+        }
+        else if (length - position >= AIRTIGHT_PACKET_SIZE)
+        {
+            entry_length = AIRTIGHT_PACKET_SIZE;
+            Airtight_InitialisePacket(&packets_out[unpacked]);
+            memcpy(packets_out[unpacked].data.raw, &raw[position], AIRTIGHT_PACKET_SIZE);
+        }
+        else
+        {
+            entry_length = 0;
+        }
+
+        if (entry_length == 0)
+        {
+            break;
+        }
+
+        position += entry_length;
+        unpacked++;
+    }
+
+    return unpacked;
+}
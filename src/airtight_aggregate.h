@@ -0,0 +1,67 @@
+/**
+ * @addtogroup Airtight_Aggregate
+ * @{
+ * @file
+ * AirTight: aggregation of packets into a single radio frame header.
+ */
+#ifndef __AIRTIGHT_AGGREGATE_H
+#define __AIRTIGHT_AGGREGATE_H
+
+#include <string.h>
+
+#include "airtight_types.h"
+#include "airtight_packet.h"
+#include "airtight_mac_config.h"
+#include "airtight_codec.h"
+
+/**
+ * First byte of an aggregate frame. Never a valid priority so an aggregate
+ * cannot be mistaken for a single packet.
+ */
+#define AIRTIGHT_AGGREGATE_MARKER 0xC1
+
+/**
+ * Size of the aggregate frame header, the marker and the packet count.
+ */
+#define AIRTIGHT_AGGREGATE_HEADER 2
+
+/**
+ * The largest packet entry of an aggregate frame.
+ */
+#if (AT_CONF_COMPACT_ENCODING == 1)
+#define AIRTIGHT_AGGREGATE_ENTRY_MAX AIRTIGHT_CODEC_MAX_SIZE
+#else
+#define AIRTIGHT_AGGREGATE_ENTRY_MAX AIRTIGHT_PACKET_SIZE
+#endif
+
+/**
+ * The most packets which fit in one aggregate frame, however short.
+ */
+#define AIRTIGHT_AGGREGATE_MAX_PACKETS ((AT_CONF_AGGREGATE_MAX_PAYLOAD - AIRTIGHT_AGGREGATE_HEADER) / AIRTIGHT_AGGREGATE_ENTRY_MAX)
+
+#if (AT_CONF_AGGREGATION == 1 && AIRTIGHT_AGGREGATE_MAX_PACKETS < 2)
+#error Aggregate payload must fit at least two packets.
+#endif
+
+/**
+ * Several packets for the same hop destination sent as one frame.
+ *
+ * The sent copy of each packet is kept alongside the encoded frame so its
+ * transmit status can be registered against every packet.
+ */
+typedef struct
+{
+    Airtight_Packet packets[AIRTIGHT_AGGREGATE_MAX_PACKETS];
+    at_u8_t count;
+    at_u16_t length;
+    at_u8_t raw[AT_CONF_AGGREGATE_MAX_PAYLOAD];
+} Airtight_Aggregate;
+
+void Airtight_Aggregate_Init(Airtight_Aggregate *aggregate);
+at_bool_t Airtight_Aggregate_Add(Airtight_Aggregate *aggregate, const Airtight_Packet *packet);
+at_bool_t Airtight_Aggregate_Full(const Airtight_Aggregate *aggregate);
+at_u16_t Airtight_Aggregate_Length(const Airtight_Aggregate *aggregate);
+at_bool_t Airtight_Aggregate_IsAggregate(const at_u8_t *raw, at_u16_t length);
+at_u8_t Airtight_Aggregate_Unpack(const at_u8_t *raw, at_u16_t length, Airtight_NodeId hop_source, Airtight_Packet *packets_out, at_u8_t max_packets);
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @addtogroup Airtight_Bulk
+ * @{
+ * @file
+ * AirTight: best-effort bulk packet queue implementation.
+ */
+#include "airtight_bulk.h"
+
+/**
+ * Initialise an empty queue.
+ */
+void Airtight_Bulk_Init(Airtight_BulkQueue *queue)
+{
+    queue->head = 0;
+    queue->count = 0;
+    queue->dropped = 0;
+}
+
+/**
+ * Copy a packet to the tail of the queue.
+ *
+ * @return false if the queue is full, the packet is dropped and counted
+ */
+at_bool_t Airtight_Bulk_Push(Airtight_BulkQueue *queue, const Airtight_Packet *packet)
+{
+    if (queue->count == AT_CONF_BULK_QUEUE_SIZE)
+    {
+        queue->dropped++;
+        return false;
+    }
+
+    memcpy(&queue->packets[(queue->head + queue->count) % AT_CONF_BULK_QUEUE_SIZE], packet, sizeof(Airtight_Packet));
+    queue->count++;
+
+    return true;
+}
+
+/**
+ * The oldest packet, NULL if the queue is empty.
+ */
+Airtight_Packet *Airtight_Bulk_Head(Airtight_BulkQueue *queue)
+{
+    return queue->count == 0 ? NULL : &queue->packets[queue->head];
+}
+
+/**
+ * Remove the oldest packet.
+ */
+void Airtight_Bulk_Pop(Airtight_BulkQueue *queue)
+{
+    if (queue->count > 0)
+    {
+        queue->head = (queue->head + 1) % AT_CONF_BULK_QUEUE_SIZE;
+        queue->count--;
+    }
+}
+
+at_u8_t Airtight_Bulk_Size(const Airtight_BulkQueue *queue)
+{
+    return queue->count;
+}
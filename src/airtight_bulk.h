@@ -0,0 +1,39 @@
+/**
+ * @addtogroup Airtight_Bulk
+ * @{
+ * @file
+ * AirTight: best-effort bulk packet queue header.
+ */
+#ifndef __AIRTIGHT_BULK_H
+#define __AIRTIGHT_BULK_H
+
+#include "airtight_types.h"
+#include "airtight_packet.h"
+#include "airtight_mac_config.h"
+
+/**
+ * Flow ID bit marking a packet as bulk on the air, so relays forward it
+ * through their bulk queue whichever slot it arrives in. Application flows
+ * must not use it.
+ */
+#define AIRTIGHT_BULK_FLOW_FLAG 0x40
+
+/**
+ * A FIFO of bulk packets kept apart from the PCQ, so best-effort traffic
+ * never delays or displaces critical packets.
+ */
+typedef struct
+{
+    Airtight_Packet packets[AT_CONF_BULK_QUEUE_SIZE];
+    at_u8_t head;
+    at_u8_t count;
+    at_u32_t dropped;
+} Airtight_BulkQueue;
+
+void Airtight_Bulk_Init(Airtight_BulkQueue *queue);
+at_bool_t Airtight_Bulk_Push(Airtight_BulkQueue *queue, const Airtight_Packet *packet);
+Airtight_Packet *Airtight_Bulk_Head(Airtight_BulkQueue *queue);
+void Airtight_Bulk_Pop(Airtight_BulkQueue *queue);
+at_u8_t Airtight_Bulk_Size(const Airtight_BulkQueue *queue);
+
+#endif
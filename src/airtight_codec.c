@@ -0,0 +1,118 @@
+/**
+ * @addtogroup Airtight_Codec
+ * @{
+ * @file
+ * AirTight: compact on-air packet encoding implementation.
+ *
+ * A compact packet carries a seven byte header followed by only the used data:
+ *
+ * | Byte | Bits | Field                                  |
+ * |------|------|----------------------------------------|
+ * | 0    | 7-6  | marker, 0b10                           |
+ * | 0    | 5-4  | version                                |
+ * | 0    | 3-0  | priority                               |
+ * | 1    | 7-5  | c_value                                |
+ * | 1    | 4-0  | data length                            |
+ * | 2    |      | flow_id                                |
+ * | 3    |      | source                                 |
+ * | 4    |      | destination                            |
+ * | 5-6  |      | sequence_number, little endian         |
+ *
+ * The criticality follows from the priority via AT_CONF_CRITICALITIES. The
+ * hop source is the 802.15.4 source address and the hop destination is the
+ * receiving node, as the radio filters on destination address.
+ */
+#include "airtight_codec.h"
+
+static const Airtight_Criticality _CRITICALITIES[] = AT_CONF_CRITICALITIES;
+
+/**
+ * Check whether a received frame holds a compact packet.
+ */
+at_bool_t Airtight_Codec_IsCompact(const at_u8_t *raw, at_u16_t length)
+{
+    return length >= AIRTIGHT_CODEC_HEADER && (raw[0] & AIRTIGHT_CODEC_MARKER_MASK) == AIRTIGHT_CODEC_MARKER;
+}
+
+/**
+ * The number of bytes a packet takes when encoded.
+ */
+at_u16_t Airtight_Codec_Size(const Airtight_Packet *packet)
+{
+    const at_u8_t data_length = packet->meta.data_length > AIRTIGHT_DATA ? AIRTIGHT_DATA : packet->meta.data_length;
+
+    return AIRTIGHT_CODEC_HEADER + data_length;
+}
+
+/**
+ * Encode a packet in the compact format.
+ *
+ * Only the first meta.data_length bytes of data are sent.
+ *
+ * @return the encoded length, or 0 if it does not fit in max_length
+ */
+at_u16_t Airtight_Codec_Encode(const Airtight_Packet *packet, at_u8_t *out, at_u16_t max_length)
+{
+    const Airtight_PacketDataInner *fields = &packet->data.fields;
+    const at_u16_t size = Airtight_Codec_Size(packet);
+
+    if (size > max_length)
+    {
+        return 0;
+    }
+
+    out[0] = AIRTIGHT_CODEC_MARKER | (AIRTIGHT_CODEC_VERSION << 4) | (fields->priority & 0x0f);
+    out[1] = (at_u8_t)((fields->c_value & 0x07) << 5) | (at_u8_t)(size - AIRTIGHT_CODEC_HEADER);
+    out[2] = fields->flow_id;
+    out[3] = fields->source;
+    out[4] = fields->destination;
+    out[5] = fields->sequence_number & 0xff;
+    out[6] = fields->sequence_number >> 8;
+    memcpy(&out[AIRTIGHT_CODEC_HEADER], fields->data, size - AIRTIGHT_CODEC_HEADER);
+
+    return size;
+}
+
+/**
+ * Decode a compact packet into the in-memory packet form.
+ *
+ * Unsent data bytes are zeroed. Decoding stops after the first packet so
+ * packets may be read back to back.
+ *
+ * @return the number of bytes consumed, or 0 if the packet is invalid or of
+ * an unknown version
+ */
+at_u16_t Airtight_Codec_Decode(const at_u8_t *raw, at_u16_t length, Airtight_NodeId hop_source, Airtight_Packet *packet_out)
+{
+    if (!Airtight_Codec_IsCompact(raw, length) || ((raw[0] >> 4) & 0x03) != AIRTIGHT_CODEC_VERSION)
+    {
+        return 0;
+    }
+
+    const Airtight_Priority priority = raw[0] & 0x0f;
+    const at_u8_t data_length = raw[1] & 0x1f;
+
+    if (priority > AIRTIGHT_PRIORITY_MAX || data_length > AIRTIGHT_DATA || AIRTIGHT_CODEC_HEADER + data_length > length)
+    {
+        return 0;
+    }
+
+    Airtight_PacketDataInner *fields = &packet_out->data.fields;
+
+    Airtight_InitialisePacket(packet_out);
+    fields->priority = priority;
+    fields->criticality = _CRITICALITIES[priority];
+    fields->c_value = raw[1] >> 5;
+    fields->flow_id = raw[2];
+    fields->source = raw[3];
+    fields->destination = raw[4];
+    fields->sequence_number = raw[5] | (raw[6] << 8);
+    fields->hop_source = hop_source;
+    fields->hop_destination = AT_CONF_NODE_ID;
+
+    memset(fields->data, 0x00, AIRTIGHT_DATA);
+    memcpy(fields->data, &raw[AIRTIGHT_CODEC_HEADER], data_length);
+    packet_out->meta.data_length = data_length;
+
+    return AIRTIGHT_CODEC_HEADER + data_length;
+}
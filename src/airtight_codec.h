@@ -0,0 +1,52 @@
+/**
+ * @addtogroup Airtight_Codec
+ * @{
+ * @file
+ * AirTight: compact on-air packet encoding header.
+ */
+#ifndef __AIRTIGHT_CODEC_H
+#define __AIRTIGHT_CODEC_H
+
+#include <string.h>
+
+#include "airtight_types.h"
+#include "airtight_packet.h"
+#include "airtight_mac_config.h"
+
+/**
+ * Mask and value of the top bits of the first byte marking a compact packet.
+ * A fixed packet starts with its priority and an aggregate with 0xC1, so
+ * neither can match.
+ */
+#define AIRTIGHT_CODEC_MARKER_MASK 0xC0
+#define AIRTIGHT_CODEC_MARKER 0x80
+
+/**
+ * Version of the compact encoding, sent in the first byte.
+ */
+#define AIRTIGHT_CODEC_VERSION 2
+
+/**
+ * Size of the compact header in bytes.
+ */
+#define AIRTIGHT_CODEC_HEADER 7
+
+/**
+ * Size of the largest compact packet in bytes.
+ */
+#define AIRTIGHT_CODEC_MAX_SIZE (AIRTIGHT_CODEC_HEADER + AIRTIGHT_DATA)
+
+#if (AIRTIGHT_PRIORITIES > 16)
+#error Compact encoding supports at most 16 priorities.
+#endif
+
+#if (AT_CONF_MAX_C_VALUE > 7 || AIRTIGHT_DATA > 31)
+#error Compact encoding supports C values up to 7 and up to 31 data bytes.
+#endif
+
+at_bool_t Airtight_Codec_IsCompact(const at_u8_t *raw, at_u16_t length);
+at_u16_t Airtight_Codec_Size(const Airtight_Packet *packet);
+at_u16_t Airtight_Codec_Encode(const Airtight_Packet *packet, at_u8_t *out, at_u16_t max_length);
+at_u16_t Airtight_Codec_Decode(const at_u8_t *raw, at_u16_t length, Airtight_NodeId hop_source, Airtight_Packet *packet_out);
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @addtogroup Airtight_Dedup
+ * @{
+ * @file
+ * AirTight: per-flow duplicate suppression implementation.
+ *
+ * Burst copies of a packet share its sequence number, so every copy after
+ * the first to arrive is recognised by the window of its source and flow.
+ * Sequence numbers are compared with serial number arithmetic so windows
+ * continue across wraparound.
+ */
+#include "airtight_dedup.h"
+
+/**
+ * Initialise an empty table.
+ */
+void Airtight_Dedup_Init(Airtight_DedupTable *table)
+{
+    for (at_u8_t i = 0; i < AT_CONF_DEDUP_FLOWS; i++)
+    {
+        table->entries[i].in_use = false;
+    }
+
+    table->clock = 0;
+    table->duplicates = 0;
+}
+
+/**
+ * Find the window of a flow, or take the least recently used one for it.
+ */
+static Airtight_DedupEntry *Airtight_Dedup_Find(Airtight_DedupTable *table, Airtight_NodeId source, at_u8_t flow_id, at_bool_t *found)
+{
+    Airtight_DedupEntry *replace = &table->entries[0];
+
+    for (at_u8_t i = 0; i < AT_CONF_DEDUP_FLOWS; i++)
+    {
+        Airtight_DedupEntry *entry = &table->entries[i];
+
+        if (entry->in_use && entry->source == source && entry->flow_id == flow_id)
+        {
+            *found = true;
+            return entry;
+        }
+
+        if (replace->in_use && (!entry->in_use || entry->last_used < replace->last_used))
+        {
+            replace = entry;
+        }
+    }
+
+    *found = false;
+    return replace;
+}
+
+/**
+ * Record a received packet's sequence number.
+ *
+ * A packet older than the window is taken as its source having restarted
+ * its numbering, and the window restarts from it.
+ *
+ * @return true if the packet is new, false if it is a duplicate
+ */
+at_bool_t Airtight_Dedup_Check(Airtight_DedupTable *table, const Airtight_Packet *packet)
+{
+    const at_u16_t sequence_number = packet->data.fields.sequence_number;
+    at_bool_t found;
+    Airtight_DedupEntry *entry = Airtight_Dedup_Find(table, packet->data.fields.source, packet->data.fields.flow_id, &found);
+
+    entry->last_used = ++table->clock;
+
+    if (!found)
+    {
+        entry->in_use = true;
+        entry->source = packet->data.fields.source;
+        entry->flow_id = packet->data.fields.flow_id;
+        entry->highest = sequence_number;
+        entry->window = 1;
+        return true;
+    }
+
+    const at_i16_t ahead = (at_i16_t)(sequence_number - entry->highest);
+
+    if (ahead > 0)
+    {
+        entry->window = ahead >= AIRTIGHT_DEDUP_WINDOW ? 0 : entry->window << ahead;
+        entry->window |= 1;
+        entry->highest = sequence_number;
+        return true;
+    }
+
+    const at_u16_t behind = (at_u16_t)(-ahead);
+
+    if (behind >= AIRTIGHT_DEDUP_WINDOW)
+    {
+        entry->highest = sequence_number;
+        entry->window = 1;
+        return true;
+    }
+
+    const at_u64_t bit = (at_u64_t)1 << behind;
+
+    if (entry->window & bit)
+    {
+        table->duplicates++;
+        return false;
+    }
+
+    entry->window |= bit;
+    return true;
+}
@@ -0,0 +1,49 @@
+/**
+ * @addtogroup Airtight_Dedup
+ * @{
+ * @file
+ * AirTight: per-flow duplicate suppression header.
+ */
+#ifndef __AIRTIGHT_DEDUP_H
+#define __AIRTIGHT_DEDUP_H
+
+#include "airtight_types.h"
+#include "airtight_packet.h"
+#include "airtight_mac_config.h"
+
+/**
+ * The number of sequence numbers behind the highest seen which are tracked
+ * per flow.
+ */
+#define AIRTIGHT_DEDUP_WINDOW 64
+
+/**
+ * Sliding window of the sequence numbers seen from one source and flow.
+ *
+ * Bit i of window is set if sequence number highest - i has been seen.
+ */
+typedef struct
+{
+    at_bool_t in_use;
+    Airtight_NodeId source;
+    at_u8_t flow_id;
+    at_u16_t highest;
+    at_u64_t window;
+    at_u32_t last_used;
+} Airtight_DedupEntry;
+
+/**
+ * A fixed table of windows, the least recently used is replaced when a new
+ * flow is seen with the table full.
+ */
+typedef struct
+{
+    Airtight_DedupEntry entries[AT_CONF_DEDUP_FLOWS];
+    at_u32_t clock;
+    at_u32_t duplicates;
+} Airtight_DedupTable;
+
+void Airtight_Dedup_Init(Airtight_DedupTable *table);
+at_bool_t Airtight_Dedup_Check(Airtight_DedupTable *table, const Airtight_Packet *packet);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @addtogroup Airtight_Flows
+ * @{
+ * @file
+ * AirTight: flow configuration implementation.
+ */
+#include "airtight_flows.h"
+
+/**
+ * Check whether only the newest queued packet of a flow is kept, so a new
+ * packet replaces the queued one in place.
+ */
+at_bool_t Airtight_FlowIsLatestValue(at_u8_t flow_id)
+{
+    // Unused when no flows are configured.
+    (void)flow_id;
+
+#define LATEST_VALUE(id) \
+    if (flow_id == id)   \
+    {                    \
+        return true;     \
+    }
+#define DEADLINE(id, ms)
+
+#include "airtight_flows_config.txt"
+
+#undef LATEST_VALUE
+#undef DEADLINE
+
+    return false;
+}
+
+/**
+ * Get the relative deadline of a flow in milliseconds, after which a queued
+ * packet is no longer worth sending.
+ *
+ * @return the deadline, or 0 if the flow has none
+ */
+at_time_t Airtight_FlowDeadline(at_u8_t flow_id)
+{
+    // Unused when no flows are configured.
+    (void)flow_id;
+
+#define LATEST_VALUE(id)
+#define DEADLINE(id, ms) \
+    if (flow_id == id)   \
+    {                    \
+        return ms;       \
+    }
+
+#include "airtight_flows_config.txt"
+
+#undef LATEST_VALUE
+#undef DEADLINE
+
+    return 0;
+}
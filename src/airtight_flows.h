@@ -0,0 +1,16 @@
+/**
+ * @addtogroup Airtight_Flows
+ * @{
+ * @file
+ * AirTight: flow configuration header.
+ */
+#ifndef __AIRTIGHT_FLOWS_H
+#define __AIRTIGHT_FLOWS_H
+
+#include "airtight_types.h"
+#include "airtight_mac_config.h"
+
+at_bool_t Airtight_FlowIsLatestValue(at_u8_t flow_id);
+at_time_t Airtight_FlowDeadline(at_u8_t flow_id);
+
+#endif
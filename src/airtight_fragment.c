@@ -0,0 +1,288 @@
+/**
+ * @addtogroup Airtight_Fragment
+ * @{
+ * @file
+ * AirTight: fragmentation and reassembly of large messages implementation.
+ *
+ * A message is sent as a flow of ordinary packets whose flow ID has
+ * AIRTIGHT_FRAGMENT_FLOW_FLAG set. Each packet's data starts with the
+ * message ID, the fragment index and the total message length (little
+ * endian), followed by up to AIRTIGHT_FRAGMENT_PAYLOAD bytes of the message.
+ */
+#include "airtight_fragment.h"
+
+/**
+ * The number of fragments a message of a length is split into.
+ */
+static inline at_u16_t Airtight_Fragment_Count(at_u16_t length)
+{
+    return (length + AIRTIGHT_FRAGMENT_PAYLOAD - 1) / AIRTIGHT_FRAGMENT_PAYLOAD;
+}
+
+/**
+ * Initialise a sender.
+ */
+void Airtight_Fragment_InitSender(Airtight_Fragmenter *fragmenter)
+{
+    fragmenter->next_message_id = 0;
+    fragmenter->next_sequence_number = 0;
+}
+
+/**
+ * Split a message into fragments and send them with Airtight_Send.
+ *
+ * The header packet gives the priority, criticality, destination, flow and
+ * C value used for every fragment. The message is only sent if
+ * Airtight_SendAdmits accepts all of its fragments: none may be shed by the
+ * criticality mode or the next hop, and all, including burst copies, must
+ * fit in the free space of the queue they go to, as a full queue would
+ * otherwise evict earlier fragments.
+ *
+ * @return true if every fragment was queued, false otherwise
+ */
+at_bool_t Airtight_Fragment_Send(Airtight_Fragmenter *fragmenter, Airtight_MACState *mac_state, const Airtight_Packet *header, const at_u8_t *message, at_u16_t length)
+{
+    AT_ENTER(Airtight_Fragment_Send);
+    const Airtight_Priority priority = header->data.fields.priority;
+
+    if (length == 0 || length > AT_CONF_FRAGMENT_MAX_MESSAGE || priority > AIRTIGHT_PRIORITY_MAX ||
+        (header->data.fields.flow_id & AIRTIGHT_FRAGMENT_FLOW_FLAG))
+    {
+        AT_DEBUG("Airtight_Fragment_Send: invalid message.");
+        return false;
+    }
+
+    const at_u16_t fragments = Airtight_Fragment_Count(length);
+
+    if (!Airtight_SendAdmits(mac_state, header, fragments))
+    {
+        AT_DEBUG("Airtight_Fragment_Send: message not admitted or not enough queue space.");
+        return false;
+    }
+
+    const at_u16_t message_id = fragmenter->next_message_id++;
+    at_bool_t queued = true;
+
+    for (at_u16_t index = 0; index < fragments; index++)
+    {
+        const at_u16_t offset = index * AIRTIGHT_FRAGMENT_PAYLOAD;
+        const at_u16_t chunk = length - offset < AIRTIGHT_FRAGMENT_PAYLOAD ? length - offset : AIRTIGHT_FRAGMENT_PAYLOAD;
+        Airtight_Packet packet;
+
+        memcpy(&packet, header, sizeof(Airtight_Packet));
+        packet.data.fields.flow_id |= AIRTIGHT_FRAGMENT_FLOW_FLAG;
+
+        packet.data.fields.sequence_number = fragmenter->next_sequence_number++;
+
+        packet.data.fields.data[0] = message_id & 0xff;
+        packet.data.fields.data[1] = message_id >> 8;
+        packet.data.fields.data[2] = (at_u8_t)index;
+        packet.data.fields.data[3] = length & 0xff;
+        packet.data.fields.data[4] = length >> 8;
+        memset(&packet.data.fields.data[AIRTIGHT_FRAGMENT_HEADER], 0x00, AIRTIGHT_FRAGMENT_PAYLOAD);
+        memcpy(&packet.data.fields.data[AIRTIGHT_FRAGMENT_HEADER], &message[offset], chunk);
+        packet.meta.data_length = AIRTIGHT_FRAGMENT_HEADER + chunk;
+
+        queued = Airtight_Send(mac_state, &packet) && queued;
+    }
+
+    return queued;
+}
+
+/**
+ * Initialise a receiver with the callback given reassembled messages.
+ */
+void Airtight_Fragment_InitReceiver(Airtight_Reassembler *reassembler, Airtight_MessageCallback callback)
+{
+    for (at_u8_t i = 0; i < AT_CONF_FRAGMENT_POOL_SIZE; i++)
+    {
+        reassembler->buffers[i].state = REASSEMBLY_FREE;
+    }
+
+    reassembler->callback = callback;
+    reassembler->evictions = 0;
+    reassembler->drops = 0;
+}
+
+/**
+ * Check whether a packet is a fragment of a larger message.
+ */
+at_bool_t Airtight_Fragment_IsFragment(const Airtight_Packet *packet)
+{
+    return (packet->data.fields.flow_id & AIRTIGHT_FRAGMENT_FLOW_FLAG) != 0;
+}
+
+/**
+ * Find the buffer of a message, or a buffer to reassemble it in.
+ *
+ * Free buffers are preferred to complete ones, and the complete buffer whose
+ * message finished longest ago is reused first, so duplicates of recent
+ * messages are recognised for as long as possible and no buffer keeps a
+ * stale message ID.
+ *
+ * @return the buffer, NULL if every buffer is busy
+ */
+static Airtight_ReassemblyBuffer *Airtight_Fragment_FindBuffer(Airtight_Reassembler *reassembler, Airtight_NodeId source, at_u8_t flow_id, at_u16_t message_id)
+{
+    Airtight_ReassemblyBuffer *free_buffer = NULL;
+    Airtight_ReassemblyBuffer *complete_buffer = NULL;
+
+    for (at_u8_t i = 0; i < AT_CONF_FRAGMENT_POOL_SIZE; i++)
+    {
+        Airtight_ReassemblyBuffer *buffer = &reassembler->buffers[i];
+
+        if (buffer->state == REASSEMBLY_FREE)
+        {
+            free_buffer = NULL == free_buffer ? buffer : free_buffer;
+        }
+        else if (buffer->source == source && buffer->flow_id == flow_id && buffer->message_id == message_id)
+        {
+            return buffer;
+        }
+        else if (buffer->state == REASSEMBLY_COMPLETE &&
+                 (NULL == complete_buffer || (at_timediff_t)(buffer->last_time - complete_buffer->last_time) < 0))
+        {
+            complete_buffer = buffer;
+        }
+    }
+
+    return NULL != free_buffer ? free_buffer : complete_buffer;
+}
+
+/**
+ * Take a received fragment, delivering its message once complete.
+ *
+ * Buffers of incomplete messages are evicted once no fragment has arrived
+ * for AT_CONF_FRAGMENT_TIMEOUT_MS. Fragments are dropped when every buffer is
+ * busy. Duplicate fragments are ignored.
+ */
+void Airtight_Fragment_Receive(Airtight_Reassembler *reassembler, const Airtight_Packet *packet, at_time_t now)
+{
+    AT_ENTER(Airtight_Fragment_Receive);
+    const Airtight_PacketDataInner *fields = &packet->data.fields;
+
+    Airtight_Fragment_Expire(reassembler, now);
+
+    if (!Airtight_Fragment_IsFragment(packet))
+    {
+        return;
+    }
+
+    const at_u16_t message_id = fields->data[0] | (fields->data[1] << 8);
+    const at_u8_t index = fields->data[2];
+    const at_u16_t length = fields->data[3] | (fields->data[4] << 8);
+
+    if (length == 0 || length > AT_CONF_FRAGMENT_MAX_MESSAGE || index >= Airtight_Fragment_Count(length))
+    {
+        AT_DEBUG("Airtight_Fragment_Receive: invalid fragment.");
+        reassembler->drops++;
+        return;
+    }
+
+    Airtight_ReassemblyBuffer *buffer = Airtight_Fragment_FindBuffer(reassembler, fields->source, fields->flow_id, message_id);
+
+    if (NULL == buffer)
+    {
+        AT_DEBUG("Airtight_Fragment_Receive: no free buffer, dropping fragment.");
+        reassembler->drops++;
+        return;
+    }
+
+    const at_bool_t new_message = buffer->state == REASSEMBLY_FREE ||
+                                  buffer->source != fields->source || buffer->flow_id != fields->flow_id || buffer->message_id != message_id;
+
+    if (!new_message && buffer->state != REASSEMBLY_ACTIVE)
+    {
+        AT_DEBUG("Airtight_Fragment_Receive: fragment of delivered message.");
+        return;
+    }
+
+    if (new_message)
+    {
+        buffer->state = REASSEMBLY_ACTIVE;
+        buffer->source = fields->source;
+        buffer->flow_id = fields->flow_id;
+        buffer->message_id = message_id;
+        buffer->length = length;
+        buffer->fragments_received = 0;
+        memset(buffer->received, 0x00, sizeof(buffer->received));
+    }
+    else if (buffer->length != length)
+    {
+        AT_DEBUG("Airtight_Fragment_Receive: fragment length mismatch.");
+        reassembler->drops++;
+        return;
+    }
+
+    buffer->last_time = now;
+
+    if (buffer->received[index / 8] & (1 << (index % 8)))
+    {
+        return;
+    }
+
+    const at_u16_t offset = index * AIRTIGHT_FRAGMENT_PAYLOAD;
+    const at_u16_t chunk = length - offset < AIRTIGHT_FRAGMENT_PAYLOAD ? length - offset : AIRTIGHT_FRAGMENT_PAYLOAD;
+
+    memcpy(&buffer->data[offset], &fields->data[AIRTIGHT_FRAGMENT_HEADER], chunk);
+    buffer->received[index / 8] |= 1 << (index % 8);
+    buffer->fragments_received++;
+
+    if (buffer->fragments_received == Airtight_Fragment_Count(length))
+    {
+        Airtight_Message message;
+
+        message.source = buffer->source;
+        message.flow_id = buffer->flow_id & ~AIRTIGHT_FRAGMENT_FLOW_FLAG;
+        message.length = buffer->length;
+        message.data = buffer->data;
+
+        buffer->state = REASSEMBLY_DELIVERED;
+
+        AT_DEBUG("Airtight_Fragment_Receive: message complete.");
+        if (NULL != reassembler->callback)
+        {
+            reassembler->callback(&message);
+        }
+        else
+        {
+            Airtight_Fragment_Release(reassembler, &message);
+        }
+    }
+}
+
+/**
+ * Give a delivered message's buffer back to the pool.
+ */
+void Airtight_Fragment_Release(Airtight_Reassembler *reassembler, Airtight_Message *message)
+{
+    for (at_u8_t i = 0; i < AT_CONF_FRAGMENT_POOL_SIZE; i++)
+    {
+        if (reassembler->buffers[i].data == message->data && reassembler->buffers[i].state == REASSEMBLY_DELIVERED)
+        {
+            reassembler->buffers[i].state = REASSEMBLY_COMPLETE;
+            return;
+        }
+    }
+}
+
+/**
+ * Evict incomplete messages which have timed out.
+ *
+ * Called on every received fragment, and may be called periodically so
+ * buffers are freed while nothing is received.
+ */
+void Airtight_Fragment_Expire(Airtight_Reassembler *reassembler, at_time_t now)
+{
+    for (at_u8_t i = 0; i < AT_CONF_FRAGMENT_POOL_SIZE; i++)
+    {
+        Airtight_ReassemblyBuffer *buffer = &reassembler->buffers[i];
+
+        if (buffer->state == REASSEMBLY_ACTIVE && (at_timediff_t)(now - buffer->last_time) > AT_CONF_FRAGMENT_TIMEOUT_MS)
+        {
+            AT_DEBUG("Airtight_Fragment_Expire: evicting incomplete message.");
+            buffer->state = REASSEMBLY_FREE;
+            reassembler->evictions++;
+        }
+    }
+}
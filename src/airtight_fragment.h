@@ -0,0 +1,119 @@
+/**
+ * @addtogroup Airtight_Fragment
+ * @{
+ * @file
+ * AirTight: fragmentation and reassembly of large messages header.
+ */
+#ifndef __AIRTIGHT_FRAGMENT_H
+#define __AIRTIGHT_FRAGMENT_H
+
+#include <string.h>
+
+#include "airtight_types.h"
+#include "airtight_packet.h"
+#include "airtight_mac_config.h"
+#include "airtight_mac.h"
+
+/**
+ * Flow ID bit marking a packet as a fragment. Application flows must not
+ * use it.
+ */
+#define AIRTIGHT_FRAGMENT_FLOW_FLAG 0x80
+
+/**
+ * Size of the fragment header at the start of the packet data: the 16 bit
+ * message ID, fragment index and the 16 bit total message length.
+ */
+#define AIRTIGHT_FRAGMENT_HEADER 5
+
+/**
+ * Message bytes carried by each fragment.
+ */
+#define AIRTIGHT_FRAGMENT_PAYLOAD (AIRTIGHT_DATA - AIRTIGHT_FRAGMENT_HEADER)
+
+/**
+ * The most fragments of one message.
+ */
+#define AIRTIGHT_FRAGMENT_MAX_FRAGMENTS ((AT_CONF_FRAGMENT_MAX_MESSAGE + AIRTIGHT_FRAGMENT_PAYLOAD - 1) / AIRTIGHT_FRAGMENT_PAYLOAD)
+
+#if (AIRTIGHT_FRAGMENT_MAX_FRAGMENTS > 256)
+#error Fragment index is 8 bits, reduce AT_CONF_FRAGMENT_MAX_MESSAGE.
+#endif
+
+/**
+ * Sender state, numbering messages and their fragments.
+ */
+typedef struct
+{
+    at_u16_t next_message_id;
+    at_u16_t next_sequence_number;
+} Airtight_Fragmenter;
+
+/**
+ * A reassembled message.
+ *
+ * data points into the reassembly pool and stays valid until the message is
+ * given back with Airtight_Fragment_Release.
+ */
+typedef struct
+{
+    Airtight_NodeId source;
+    at_u8_t flow_id;
+    at_u16_t length;
+    const at_u8_t *data;
+} Airtight_Message;
+
+typedef void (*Airtight_MessageCallback)(Airtight_Message *message);
+
+/**
+ * State of a reassembly buffer.
+ */
+typedef enum
+{
+    REASSEMBLY_FREE = 0,
+    REASSEMBLY_ACTIVE,
+    REASSEMBLY_DELIVERED,
+    REASSEMBLY_COMPLETE
+} Airtight_ReassemblyState;
+
+/**
+ * A buffer reassembling one message.
+ *
+ * Complete buffers remember their message so late burst copies of its
+ * fragments are ignored until the buffer is reused. last_time is when the
+ * latest fragment arrived, complete buffers are reused oldest first.
+ */
+typedef struct
+{
+    Airtight_ReassemblyState state;
+    Airtight_NodeId source;
+    at_u8_t flow_id;
+    at_u16_t message_id;
+    at_u16_t length;
+    at_u16_t fragments_received;
+    at_time_t last_time;
+    at_u8_t received[(AIRTIGHT_FRAGMENT_MAX_FRAGMENTS + 7) / 8];
+    at_u8_t data[AT_CONF_FRAGMENT_MAX_MESSAGE];
+} Airtight_ReassemblyBuffer;
+
+/**
+ * Receiver state, a fixed pool of reassembly buffers.
+ */
+typedef struct
+{
+    Airtight_ReassemblyBuffer buffers[AT_CONF_FRAGMENT_POOL_SIZE];
+    Airtight_MessageCallback callback;
+    at_u16_t evictions;
+    at_u16_t drops;
+} Airtight_Reassembler;
+
+void Airtight_Fragment_InitSender(Airtight_Fragmenter *fragmenter);
+at_bool_t Airtight_Fragment_Send(Airtight_Fragmenter *fragmenter, Airtight_MACState *mac_state, const Airtight_Packet *header, const at_u8_t *message, at_u16_t length);
+
+void Airtight_Fragment_InitReceiver(Airtight_Reassembler *reassembler, Airtight_MessageCallback callback);
+at_bool_t Airtight_Fragment_IsFragment(const Airtight_Packet *packet);
+void Airtight_Fragment_Receive(Airtight_Reassembler *reassembler, const Airtight_Packet *packet, at_time_t now);
+void Airtight_Fragment_Release(Airtight_Reassembler *reassembler, Airtight_Message *message);
+void Airtight_Fragment_Expire(Airtight_Reassembler *reassembler, at_time_t now);
+
+#endif
@@ -17,7 +17,7 @@
  */
 typedef struct
 {
-    at_u8_t sequence_number;
+    at_u16_t sequence_number;
     at_u8_t flow_id;
 } Airtight_ReceiveRecord;
 
@@ -26,7 +26,7 @@ typedef struct
  */
 typedef struct
 {
-    at_u8_t sequence_number;
+    at_u16_t sequence_number;
     at_u8_t flow_id;
     at_u32_t inject_time;
     at_u32_t send_time;
@@ -0,0 +1,90 @@
+/**
+ * @addtogroup AirTight_Logging
+ * @{
+ * @file
+ * AirTight: data logging functionality implementation.
+ *
+ * Deferred logging stores entries in a single producer single consumer ring
+ * so the slot path only copies bytes, the ring may be drained from another
+ * thread.
+ *
+ * PORT: uses the GCC/Clang atomic builtins.
+ */
+#include "airtight_logging.h"
+
+#if defined(AIRTIGHT_LOGGING) && (AT_CONF_LOG_DEFERRED == 1)
+
+#if (AT_CONF_LOG_RING_SIZE & (AT_CONF_LOG_RING_SIZE - 1)) != 0
+#error AT_CONF_LOG_RING_SIZE must be a power of two.
+#endif
+
+static Airtight_LogEntry _ring[AT_CONF_LOG_RING_SIZE];
+static at_u32_t _write_index = 0;
+static at_u32_t _read_index = 0;
+static at_u32_t _dropped = 0;
+
+/**
+ * Store a log entry to be printed later.
+ *
+ * If the ring is full the entry is dropped and counted.
+ *
+ * @note event must outlive the entry, typically a string literal.
+ */
+void Airtight_Log_Defer(at_time_t time, const char *event, at_u8_t slot, const Airtight_Packet *packet)
+{
+    const at_u32_t write_index = _write_index;
+
+    if (write_index - __atomic_load_n(&_read_index, __ATOMIC_ACQUIRE) >= AT_CONF_LOG_RING_SIZE)
+    {
+        _dropped++;
+        return;
+    }
+
+    Airtight_LogEntry *entry = &_ring[write_index & (AT_CONF_LOG_RING_SIZE - 1)];
+    entry->time = time;
+    entry->event = event;
+    entry->slot = slot;
+    memcpy(entry->raw, packet->data.raw, AIRTIGHT_PACKET_SIZE);
+
+    __atomic_store_n(&_write_index, write_index + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Print all stored log entries in the same format as immediate logging.
+ *
+ * @return the number of entries printed
+ */
+size_t Airtight_Log_Flush(FILE *stream)
+{
+    const at_u32_t write_index = __atomic_load_n(&_write_index, __ATOMIC_ACQUIRE);
+    at_u32_t read_index = _read_index;
+    size_t count = 0;
+
+    while (read_index != write_index)
+    {
+        const Airtight_LogEntry *entry = &_ring[read_index & (AT_CONF_LOG_RING_SIZE - 1)];
+
+        fprintf(stream, AIRTIGHT_LOGGING_PREFIX "%u %s %u %u ", entry->time, entry->event, AT_CONF_NODE_ID, entry->slot);
+        for (size_t i = 0; i < AIRTIGHT_PACKET_SIZE; i++)
+        {
+            fprintf(stream, "%02x", entry->raw[i]);
+        }
+        fputs("\n", stream);
+
+        read_index++;
+        count++;
+        __atomic_store_n(&_read_index, read_index, __ATOMIC_RELEASE);
+    }
+
+    return count;
+}
+
+/**
+ * Get the number of log entries dropped as the ring was full.
+ */
+at_u32_t Airtight_Log_Dropped(void)
+{
+    return _dropped;
+}
+
+#endif
@@ -12,11 +12,41 @@
 #include "airtight_mac_config.h"
 #include "airtight_packet.h"
 
+#if (AT_CONF_LOGGING == 1)
 #define AIRTIGHT_LOGGING
+#endif
 
 #define AIRTIGHT_LOGGING_PREFIX "LOG "
 
-#ifdef AIRTIGHT_LOGGING
+#if defined(AIRTIGHT_LOGGING) && (AT_CONF_LOG_DEFERRED == 1)
+
+/**
+ * A log entry waiting to be printed.
+ */
+typedef struct
+{
+    at_time_t time;
+    const char *event;
+    at_u8_t slot;
+    at_u8_t raw[AIRTIGHT_PACKET_SIZE];
+} Airtight_LogEntry;
+
+void Airtight_Log_Defer(at_time_t time, const char *event, at_u8_t slot, const Airtight_Packet *packet);
+size_t Airtight_Log_Flush(FILE *stream);
+at_u32_t Airtight_Log_Dropped(void);
+
+/**
+ * Log data for analysis about the behaviour of the protocol.
+ * @note Deferred, the entry is printed by Airtight_Log_Flush.
+ */
+#define AT_LOG(time, event, slot, packet) Airtight_Log_Defer(time, event, slot, &(packet))
+
+/**
+ * Simplified AT_LOG for use where an Airtight_MACState is available.
+ */
+#define AT_LOG_MAC(mac_state, event, packet) AT_LOG(Airtight_Time_GetSynchronisedTime(&mac_state->time), event, mac_state->current_slot, packet)
+
+#elif defined(AIRTIGHT_LOGGING)
 
 /**
  * Log data for analysis about the behaviour of the protocol.
@@ -1,9 +1,68 @@
 #include "airtight_mac.h"
 
+static const at_u8_t _RETRANSMISSION_LIMITS[AIRTIGHT_CRITICALITY_LEVELS] = AT_CONF_RETRANSMISSION_LIMITS;
+static const at_u8_t _CHANGE_THRESHOLDS[AIRTIGHT_CRITICALITY_LEVELS] = AT_CONF_CRITICALITY_CHANGE_THRESHOLDS;
+
+/**
+ * The priorities served in the current criticality mode, those of its level
+ * and every more critical one.
+ */
+static inline Airtight_PriorityMask Airtight_ServedPriorities(Airtight_MACState *mac_state)
+{
+    return Airtight_PCQ_PrioritiesOf(mac_state->queue, AIRTIGHT_CRITICALITY_AT_LEAST(mac_state->criticality_mode));
+}
+
+#if (AT_CONF_CUT_THROUGH == 1)
+/**
+ * Queue a staged cut-through packet, so it is not lost when the staged frame
+ * is dropped. The packet is queued as it was received, the staged copy was
+ * already prepared for its slot.
+ */
+static void Airtight_SpillCutThrough(Airtight_MACState *mac_state)
+{
+    if (!mac_state->staged.valid || !mac_state->staged.cut_through)
+    {
+        return;
+    }
+
+    Airtight_Packet packet;
+    memcpy(&packet, &mac_state->staged.original, sizeof(Airtight_Packet));
+    packet.meta.cut_through = false;
+
+    mac_state->staged.valid = false;
+    mac_state->staged.cut_through = false;
+
+    AT_DEBUG("Airtight_SpillCutThrough: queueing dropped cut-through packet");
+    Airtight_Enqueue(mac_state, &packet);
+}
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_SpillCutThrough(mac_state)
+// \endcond
+#endif
+
+#if (AT_CONF_STAGED_TRANSMIT == 1)
+/**
+ * Drop the staged frame, it will be rebuilt before the next transmit slot.
+ */
+static inline void Airtight_InvalidateStaged(Airtight_MACState *mac_state)
+{
+    Airtight_SpillCutThrough(mac_state);
+    mac_state->staged.valid = false;
+}
+
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_InvalidateStaged(mac_state)
+// \endcond
+#endif
+
 void Airtight_InitialiseMACState(Airtight_MACState *mac_state)
 {
     AT_ENTER(Airtight_InitialiseMACState);
     mac_state->acknowledge_fails = 0;
+    mac_state->unexpected_transmitters = 0;
+    mac_state->airtime_us = AT_CONF_INITIAL_AIRTIME_US;
     mac_state->criticality_mode = LOW_CRIT;
     mac_state->current_slot = 0xff;
     mac_state->previous_slot = 0xfe;
@@ -12,12 +71,64 @@ void Airtight_InitialiseMACState(Airtight_MACState *mac_state)
     mac_state->receive_callback = NULL;
     mac_state->transmit_handler = NULL;
     mac_state->notification_handler = NULL;
+    mac_state->stage_handler = NULL;
+    mac_state->staged_transmit_handler = NULL;
+    mac_state->staged.valid = false;
+    mac_state->staged.cut_through = false;
+#if (AT_CONF_AGGREGATION == 1)
+    mac_state->aggregate_transmit_handler = NULL;
+#endif
+#if (AT_CONF_CUT_THROUGH == 1)
+    mac_state->cut_through_enabled = true;
+#endif
+#if (AT_CONF_MODE_SCHEDULES == 1)
+    mac_state->schedule_mode = LOW_CRIT;
+    mac_state->mode_switch = (Airtight_ModeSwitch){.pending = false, .announce = false, .mode = LOW_CRIT, .slot = 0};
+#endif
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+    memset(&mac_state->propagation, 0x00, sizeof(mac_state->propagation));
+    mac_state->propagation.announced_mode = LOW_CRIT;
+    for (at_u16_t id = 0; id < AT_CONF_CRITICALITY_TABLE_SIZE; id++)
+    {
+        mac_state->propagation.origins[id].mode = LOW_CRIT;
+    }
+#endif
 
-    Airtight_PCQ_Init(&mac_state->queue);
+    mac_state->queue = &mac_state->local_queue;
+    Airtight_PCQ_Init(mac_state->queue);
     Airtight_History_Init(&mac_state->send_history);
     Airtight_History_Init(&mac_state->receive_history);
+
+#if (AT_CONF_DEDUP == 1)
+    Airtight_Dedup_Init(&mac_state->dedup);
+#endif
     Airtight_Time_Init(&mac_state->time);
     Airtight_Time_InitAlarm(&mac_state->fault_alarm);
+
+#if (AT_CONF_HOP_BACKOFF == 1)
+    mac_state->hop_failure_threshold = AT_CONF_HOP_FAILURE_THRESHOLD;
+    memset(mac_state->hop_health, 0x00, sizeof(mac_state->hop_health));
+#endif
+#if (AT_CONF_SLOT_LENDING == 1)
+    mac_state->slot_borrowed = false;
+#endif
+#if (AT_CONF_BEST_EFFORT == 1)
+    Airtight_Bulk_Init(&mac_state->best_effort.queue);
+    mac_state->best_effort.mode = false;
+    mac_state->best_effort.slot_active = false;
+    mac_state->best_effort.subslot = 0;
+    mac_state->best_effort.in_flight = false;
+    mac_state->best_effort.backoff = 0;
+    mac_state->best_effort.window = AT_CONF_BEST_EFFORT_WINDOW_MIN;
+    mac_state->best_effort.retries = 0;
+    // Nodes must draw different backoffs
+    mac_state->best_effort.random = (at_u16_t)((AT_CONF_NODE_ID + 1) * 0x9E37u);
+#endif
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+    mac_state->queue_channel_handler = NULL;
+    mac_state->apply_channel_handler = NULL;
+    mac_state->synchronised = AT_CONF_NODE_ID == AT_CONF_SYNC_NODE_ID;
+#endif
 }
 
 void Airtight_SetReceiveCallback(Airtight_MACState *mac_state, Airtight_ReceiveCallback callback)
@@ -38,161 +149,1438 @@ void Airtight_SetNotificationHandler(Airtight_MACState *mac_state, Airtight_Noti
     mac_state->notification_handler = handler;
 }
 
+#if (AT_CONF_AGGREGATION == 1)
+/**
+ * Set the handler which sends aggregate frames.
+ *
+ * Without it every packet is sent in its own frame.
+ */
+void Airtight_SetAggregateTransmitHandler(Airtight_MACState *mac_state, Airtight_AggregateTransmitHandler handler)
+{
+    AT_ENTER(Airtight_SetAggregateTransmitHandler);
+    mac_state->aggregate_transmit_handler = handler;
+}
+#endif
+
+/**
+ * Set the handlers used to build frames ahead of the transmit slot.
+ *
+ * The stage handler builds the radio frame for a packet, the staged
+ * transmit handler sends the last frame built and receives the packet with
+ * refreshed metadata. Without both frames are built in the slot by the
+ * transmit handler.
+ */
+void Airtight_SetStagingHandlers(Airtight_MACState *mac_state, Airtight_TransmitHandler stage_handler, Airtight_TransmitHandler staged_transmit_handler)
+{
+    AT_ENTER(Airtight_SetStagingHandlers);
+    mac_state->stage_handler = stage_handler;
+    mac_state->staged_transmit_handler = staged_transmit_handler;
+}
+
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+/**
+ * Set the handlers which retune the radio.
+ *
+ * The queue handler is given the next slot's channel during a slot, so the
+ * radio can be sent the change ahead of time, and the apply handler is
+ * given the channel at the start of each slot. The apply handler must cope
+ * with a channel other than the one queued, e.g. after a missed slot.
+ */
+void Airtight_SetChannelHandlers(Airtight_MACState *mac_state, Airtight_ChannelHandler queue_handler, Airtight_ChannelHandler apply_handler)
+{
+    AT_ENTER(Airtight_SetChannelHandlers);
+    mac_state->queue_channel_handler = queue_handler;
+    mac_state->apply_channel_handler = apply_handler;
+}
+#endif
+
+/**
+ * Replace the PCQ used by the MAC, e.g. with a persistent PCQ.
+ *
+ * The queue is used as is, so a recovered queue keeps its packets.
+ */
+void Airtight_SetQueue(Airtight_MACState *mac_state, Airtight_PriorityCriticalQueue *queue)
+{
+    AT_ENTER(Airtight_SetQueue);
+    mac_state->queue = queue;
+}
+
+#if (AT_CONF_CUT_THROUGH == 1)
+/**
+ * Enable or disable cut-through relaying, which is enabled by default.
+ */
+void Airtight_SetCutThrough(Airtight_MACState *mac_state, at_bool_t enabled)
+{
+    Airtight_SpillCutThrough(mac_state);
+    mac_state->cut_through_enabled = enabled;
+}
+#endif
+
+#if (AT_CONF_HOP_BACKOFF == 1)
+/**
+ * Set the consecutive failed acks after which a next hop is backed off, 0
+ * disables back off.
+ */
+void Airtight_SetHopFailureThreshold(Airtight_MACState *mac_state, at_u8_t threshold)
+{
+    mac_state->hop_failure_threshold = threshold;
+}
+
+/**
+ * Check whether packets for a next hop may be sent now.
+ */
+at_bool_t Airtight_HopEligible(Airtight_MACState *mac_state, Airtight_NodeId hop)
+{
+    if (hop >= AT_CONF_HOP_TABLE_SIZE || mac_state->hop_failure_threshold == 0)
+    {
+        return true;
+    }
+
+    const Airtight_HopHealth *health = &mac_state->hop_health[hop];
+
+    return health->failures < mac_state->hop_failure_threshold || health->retry_due;
+}
+
+/**
+ * Mark the next hops whose back off ended this slot as due a retry.
+ *
+ * Called every slot, so retry_slot is compared while it is still within
+ * half the range of local_slot.
+ */
+static void Airtight_ExpireHopBackoff(Airtight_MACState *mac_state)
+{
+    if (mac_state->hop_failure_threshold == 0)
+    {
+        return;
+    }
+
+    for (at_u16_t hop = 0; hop < AT_CONF_HOP_TABLE_SIZE; hop++)
+    {
+        Airtight_HopHealth *health = &mac_state->hop_health[hop];
+
+        if (!health->retry_due && health->failures >= mac_state->hop_failure_threshold &&
+            (at_i16_t)(mac_state->local_slot - health->retry_slot) >= 0)
+        {
+            health->retry_due = true;
+        }
+    }
+}
+
+/**
+ * Update a next hop's health with the ack result of a frame sent to it.
+ *
+ * Each failure past the threshold doubles the back off, so a hop which is
+ * down is only probed occasionally.
+ */
+static void Airtight_RegisterHopResult(Airtight_MACState *mac_state, Airtight_NodeId hop, at_bool_t was_acked)
+{
+    if (hop >= AT_CONF_HOP_TABLE_SIZE)
+    {
+        return;
+    }
+
+    Airtight_HopHealth *health = &mac_state->hop_health[hop];
+
+    if (was_acked)
+    {
+        health->failures = 0;
+        return;
+    }
+
+    if (health->failures < 0xff)
+    {
+        health->failures++;
+    }
+
+    if (mac_state->hop_failure_threshold > 0 && health->failures >= mac_state->hop_failure_threshold)
+    {
+        at_u16_t backoff = AT_CONF_HOP_BACKOFF_SLOTS;
+
+        for (at_u8_t i = mac_state->hop_failure_threshold; i < health->failures && backoff < AT_CONF_HOP_BACKOFF_MAX_SLOTS; i++)
+        {
+            backoff *= 2;
+        }
+
+        if (backoff > AT_CONF_HOP_BACKOFF_MAX_SLOTS)
+        {
+            backoff = AT_CONF_HOP_BACKOFF_MAX_SLOTS;
+        }
+
+        health->retry_slot = mac_state->local_slot + backoff;
+        health->retry_due = false;
+        AT_DEBUGF("Airtight_RegisterHopResult: backing off hop %u for %u slots\n", hop, backoff);
+    }
+}
+
+// \cond DO_NOT_DOCUMENT
+#define Airtight_CursorSkips(mac_state, cursor, packet) \
+    (!(cursor)->all_hops && !Airtight_HopEligible((mac_state), Airtight_NextHop((packet)->data.fields.destination)))
+// \endcond
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_RegisterHopResult(mac_state, hop, was_acked)
+#define Airtight_ExpireHopBackoff(mac_state)
+#define Airtight_CursorSkips(mac_state, cursor, packet) false
+// \endcond
+#endif
+
 at_bool_t Airtight_CheckShouldGoHigh(Airtight_MACState *mac_state)
 {
     AT_ENTER(Airtight_CheckShouldGoHigh);
-    return mac_state->criticality_mode != HIGH_CRIT && mac_state->acknowledge_fails >= AT_CONF_CRITICALITY_CHANGE_THRESHOLD;
+    return mac_state->criticality_mode != HIGH_CRIT && mac_state->acknowledge_fails >= _CHANGE_THRESHOLDS[mac_state->criticality_mode];
 }
 
-void Airtight_GoHigh(Airtight_MACState *mac_state)
+#if (AT_CONF_MODE_SCHEDULES == 1)
+/**
+ * The slot table mode in force at a local slot, after any announced switch.
+ */
+static inline Airtight_Criticality Airtight_ScheduleModeAt(Airtight_MACState *mac_state, at_u16_t local_slot)
 {
-    AT_ENTER(Airtight_GoHigh);
-    mac_state->criticality_mode = HIGH_CRIT;
+    const Airtight_ModeSwitch *mode_switch = &mac_state->mode_switch;
 
-#if (AT_CONF_CLEAR_LOW_PACKETS_ON_HIGH == 1)
-    Airtight_PCQ_ClearCriticality(&mac_state->queue, LOW_CRIT);
-#endif
+    if (mode_switch->pending && (at_i16_t)(local_slot - mode_switch->slot) >= 0)
+    {
+        return mode_switch->mode;
+    }
+
+    return mac_state->schedule_mode;
 }
 
-at_bool_t Airtight_CheckShouldDequeuePacket(Airtight_Packet *packet)
+/**
+ * Take up an announced switch of slot table.
+ *
+ * Announcements already known, or for before the pending switch, are
+ * ignored. A switch whose slot has passed, which the rest of the network
+ * has already made, is made in the next slot. A switch to HIGH while the
+ * HIGH table is in force is still held and passed on, as it vetoes a switch
+ * to LOW for the same slot.
+ *
+ * @return true if the switch was taken up
+ */
+static at_bool_t Airtight_AdoptModeSwitch(Airtight_MACState *mac_state, Airtight_Criticality mode, at_u16_t slot)
 {
-    AT_ENTER(Airtight_CheckShouldDequeuePacket);
-    if (packet->data.fields.criticality == HIGH_CRIT)
+    Airtight_ModeSwitch *mode_switch = &mac_state->mode_switch;
+    const at_bool_t passed = (at_i16_t)(slot - mac_state->local_slot) <= 0;
+
+    if (mode_switch->pending)
     {
-        return packet->meta.local_retransmit_count >= AT_CONF_RETRANSMISSION_LIMIT_HIGH;
+        const at_i16_t later = (at_i16_t)(slot - mode_switch->slot);
+
+        // Of two switches for one slot HIGH wins.
+        if (later < 0 || (later == 0 && (mode == mode_switch->mode || mode != HIGH_CRIT)))
+        {
+            return false;
+        }
     }
-    else
+    else if (mode == mac_state->schedule_mode && (passed || mode != HIGH_CRIT))
     {
-        return packet->meta.local_retransmit_count >= AT_CONF_RETRANSMISSION_LIMIT_LOW;
+        return false;
     }
+
+    mode_switch->pending = true;
+    mode_switch->announce = !passed;
+    mode_switch->mode = mode;
+    mode_switch->slot = passed ? mac_state->local_slot : slot;
+    Airtight_InvalidateStaged(mac_state);
+
+    AT_DEBUGF("Airtight_AdoptModeSwitch: mode %u from local slot %u", mode, mode_switch->slot);
+    return true;
 }
 
-void Airtight_TriggerFault(Airtight_MACState *mac_state)
+/**
+ * Switch to the slot table of a mode at the start of a cycle far enough
+ * ahead for the rest of the network to hear of it.
+ */
+void Airtight_RequestModeSwitch(Airtight_MACState *mac_state, Airtight_Criticality mode)
 {
-    AT_ENTER(Airtight_TriggerFault);
-    if (!mac_state->fault_active)
+    AT_ENTER(Airtight_RequestModeSwitch);
+    const Airtight_ModeSwitch *mode_switch = &mac_state->mode_switch;
+    const Airtight_Criticality target = mode_switch->pending ? mode_switch->mode : mac_state->schedule_mode;
+
+    if (mode != target)
     {
-        mac_state->fault_active = true;
-        // Start fault clear timer
-        Airtight_Time_SetAlarm(&mac_state->fault_alarm, AT_CONF_SLOT_LENGTH_MS * AT_CONF_FAULT_LENGTH_SLOTS);
+        const at_u16_t cycle_start = mac_state->local_slot - mac_state->current_slot;
+        at_u16_t slot = cycle_start + AT_CONF_SLOT_TABLE_ROWS * AT_CONF_MODE_SWITCH_LEAD_CYCLES;
+
+        // Supersede a pending switch by making this one after it.
+        if (mode_switch->pending && (at_i16_t)(slot - mode_switch->slot) <= 0)
+        {
+            slot = mode_switch->slot + AT_CONF_SLOT_TABLE_ROWS;
+        }
+
+        Airtight_AdoptModeSwitch(mac_state, mode, slot);
     }
 }
 
-void Airtight_CheckForFaultTrigger(Airtight_MACState *mac_state, at_u8_t sync_slot)
+/**
+ * Make a pending switch of slot table once its slot is reached.
+ */
+static void Airtight_ApplyModeSwitch(Airtight_MACState *mac_state)
 {
-    AT_ENTER(Airtight_CheckForFaultTrigger);
-    at_i16_t offset = (sync_slot % AT_CONF_FAULT_PERIOD_INTERVAL_SLOTS) - AT_CONF_SLOT_FAULT_OFFSET;
-    if (offset > 0 && offset < AT_CONF_SLOT_TABLE_ROWS)
+    Airtight_ModeSwitch *mode_switch = &mac_state->mode_switch;
+
+    if (mode_switch->pending && (at_i16_t)(mac_state->local_slot - mode_switch->slot) >= 0)
     {
-        Airtight_TriggerFault(mac_state);
+        // Announcing late still brings nodes which missed the switch over.
+        mode_switch->pending = false;
+        mac_state->schedule_mode = mode_switch->mode;
+        Airtight_InvalidateStaged(mac_state);
+        AT_DEBUGF("Airtight_ApplyModeSwitch: now using the mode %u slot table", mac_state->schedule_mode);
     }
 }
 
-void Airtight_RegisterFailedAck(Airtight_MACState *mac_state)
+/**
+ * Take up a switch of slot table announced by another node.
+ *
+ * A node still in HIGH mode does not follow a switch to LOW but vetoes it,
+ * announcing HIGH for the same slot, so the network leaves the HIGH table
+ * only once every node has relaxed. If the slot has already passed the
+ * network has switched, so the node follows and asks to switch back.
+ */
+static void Airtight_HearModeSwitch(Airtight_MACState *mac_state, Airtight_Criticality mode, at_u16_t slot)
 {
-    AT_ENTER(Airtight_RegisterFailedAck);
-    mac_state->acknowledge_fails++;
-    if (mac_state->acknowledge_fails > AT_CONF_MAX_NODE_ACK_FAILS)
+    if (mode == HIGH_CRIT || mac_state->criticality_mode != HIGH_CRIT)
     {
-        mac_state->acknowledge_fails = AT_CONF_MAX_NODE_ACK_FAILS;
+        Airtight_AdoptModeSwitch(mac_state, mode, slot);
+    }
+    else if ((at_i16_t)(slot - mac_state->local_slot) > 0)
+    {
+        AT_DEBUGF("Airtight_HearModeSwitch: vetoing the switch to LOW at local slot %u", slot);
+        Airtight_AdoptModeSwitch(mac_state, HIGH_CRIT, slot);
+    }
+    else
+    {
+        Airtight_AdoptModeSwitch(mac_state, mode, slot);
+        Airtight_ApplyModeSwitch(mac_state);
+        Airtight_RequestModeSwitch(mac_state, HIGH_CRIT);
     }
 }
 
-void Airtight_ClearAckFails(Airtight_MACState *mac_state)
+/**
+ * Announce a pending switch of slot table in this node's transmit slot.
+ *
+ * @return true if the announcement was sent, taking a frame of the slot
+ */
+static at_bool_t Airtight_AnnounceModeSwitch(Airtight_MACState *mac_state)
 {
-    AT_ENTER(Airtight_ClearAckFails);
-    mac_state->acknowledge_fails = 0;
+    Airtight_ModeSwitch *mode_switch = &mac_state->mode_switch;
+
+    if (!mode_switch->announce || NULL == mac_state->notification_handler)
+    {
+        return false;
+    }
+
+    Airtight_Notification notification =
+        {{.fault_activity = FAULT_MODE_SWITCH,
+          .root_id = AT_CONF_NODE_ID,
+          .sync_slot = mode_switch->slot,
+          .sync_time = mode_switch->mode}};
+
+    mode_switch->announce = false;
+    mac_state->notification_handler(&notification);
+
+    return true;
+}
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_ScheduleModeAt(mac_state, local_slot) LOW_CRIT
+#define Airtight_RequestModeSwitch(mac_state, mode)
+// \endcond
+#endif
+
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+/**
+ * The most critical mode announced by the nodes a next hop leads towards.
+ * Packets less critical than it, sent through the hop, would only be
+ * discarded.
+ *
+ * Only this node's route towards the announcing node is known, so packets
+ * sharing its first hop are taken to pass through it. Origins whose lease has
+ * run out were taken back to LOW at the start of the slot.
+ *
+ * @return the mode, LOW_CRIT if no announcement applies
+ */
+Airtight_Criticality Airtight_HopMode(Airtight_MACState *mac_state, Airtight_NodeId hop)
+{
+    AT_ENTER(Airtight_HopMode);
+    Airtight_Criticality mode = LOW_CRIT;
+
+    for (at_u16_t id = 0; id < AT_CONF_CRITICALITY_TABLE_SIZE; id++)
+    {
+        const Airtight_CriticalityOrigin *origin = &mac_state->propagation.origins[id];
+
+        if (origin->via == hop && origin->mode < mode)
+        {
+            mode = origin->mode;
+        }
+    }
+
+    return mode;
 }
 
-void Airtight_GoLow(Airtight_MACState *mac_state)
+/**
+ * Take origins whose lease has run out back to LOW, as the LOW announcement
+ * may have been lost. Latched once a slot, before local_slot wraps round to
+ * the expiry again.
+ */
+static void Airtight_ExpireCriticalityOrigins(Airtight_MACState *mac_state)
 {
-    AT_ENTER(Airtight_GoLow);
-    mac_state->criticality_mode = LOW_CRIT;
-    Airtight_ClearAckFails(mac_state);
+    for (at_u16_t id = 0; id < AT_CONF_CRITICALITY_TABLE_SIZE; id++)
+    {
+        Airtight_CriticalityOrigin *origin = &mac_state->propagation.origins[id];
+
+        if (origin->mode != LOW_CRIT && (at_i16_t)(mac_state->local_slot - origin->expiry_slot) >= 0)
+        {
+            origin->mode = LOW_CRIT;
+        }
+    }
 }
 
-void Airtight_RecordSuccessfullySentPacket(Airtight_MACState *mac_state, Airtight_Packet *packet)
+/**
+ * Hold a criticality notice for this node's next transmit slot, replacing
+ * an older one from the same origin.
+ */
+static void Airtight_QueueCriticalityNotice(Airtight_MACState *mac_state, const Airtight_Notification *notice)
 {
-    AT_ENTER(Airtight_RecordSuccessfullySentPacket);
-    Airtight_Record record;
-    record.send.flow_id = packet->data.fields.flow_id;
-    record.send.inject_time = packet->meta.inject_time;
-    record.send.sequence_number = packet->data.fields.sequence_number;
-    record.send.send_time = packet->meta.send_time;
+    Airtight_CriticalityPropagation *propagation = &mac_state->propagation;
 
-    Airtight_History_Push(&mac_state->send_history, &record);
+    for (at_u8_t i = 0; i < propagation->relay_count; i++)
+    {
+        if (propagation->relays[i].criticality.origin_id == notice->criticality.origin_id)
+        {
+            propagation->relays[i] = *notice;
+            return;
+        }
+    }
+
+    if (propagation->relay_count >= AIRTIGHT_CRITICALITY_RELAYS)
+    {
+        AT_DEBUG("Airtight_QueueCriticalityNotice: relays full, dropping notice");
+        return;
+    }
+
+    propagation->relays[propagation->relay_count++] = *notice;
+}
+
+/**
+ * Start a notice of this node's criticality mode with a new epoch.
+ */
+static void Airtight_AnnounceCriticality(Airtight_MACState *mac_state, Airtight_Criticality mode)
+{
+    Airtight_CriticalityPropagation *propagation = &mac_state->propagation;
+    Airtight_Notification notice = {.criticality = {.origin_id = AT_CONF_NODE_ID,
+                                                    .fault_activity = FAULT_CRITICALITY,
+                                                    .epoch = ++propagation->epoch,
+                                                    .mode = mode,
+                                                    .ttl = AT_CONF_CRITICALITY_PROPAGATION_HOPS,
+                                                    .reserved = 0}};
+
+    propagation->announced_mode = mode;
+    propagation->announce_slot = mac_state->local_slot;
+    Airtight_QueueCriticalityNotice(mac_state, &notice);
+
+    AT_DEBUGF("Airtight_AnnounceCriticality: announcing mode %u, epoch %u", mode, propagation->epoch);
 }
 
-void Airtight_RecordSuccessfullyReceivedPacket(Airtight_MACState *mac_state, Airtight_Packet *packet)
-{
-    AT_ENTER(Airtight_RecordSuccessfullyReceivedPacket);
-    Airtight_Record record;
-    record.receive.flow_id = packet->data.fields.flow_id;
-    record.receive.sequence_number = packet->data.fields.sequence_number;
+/**
+ * Send held criticality notices in this node's transmit slot, first starting
+ * one if this node's mode has changed.
+ *
+ * A more critical mode is announced at once, and repeated every
+ * AT_CONF_CRITICALITY_HOLD_SLOTS to renew the neighbours' leases. A less
+ * critical mode is only announced once the node has not become less
+ * critical again for that long. A node that has left HIGH mode asks to leave
+ * the HIGH slot table after the same hold.
+ *
+ * @return the frames used, at most budget
+ */
+static at_u8_t Airtight_SendCriticalityNotices(Airtight_MACState *mac_state, at_u8_t budget)
+{
+    Airtight_CriticalityPropagation *propagation = &mac_state->propagation;
+    const Airtight_Criticality mode = mac_state->criticality_mode;
+
+    if (mode < propagation->announced_mode ||
+        (mode > propagation->announced_mode &&
+         (at_u16_t)(mac_state->local_slot - propagation->relax_slot) >= AT_CONF_CRITICALITY_HOLD_SLOTS))
+    {
+        Airtight_AnnounceCriticality(mac_state, mode);
+    }
+    else if (propagation->announced_mode != LOW_CRIT &&
+             (at_u16_t)(mac_state->local_slot - propagation->announce_slot) >= AT_CONF_CRITICALITY_HOLD_SLOTS)
+    {
+        Airtight_AnnounceCriticality(mac_state, propagation->announced_mode);
+    }
+
+    if (propagation->release_table && (at_u16_t)(mac_state->local_slot - propagation->relax_slot) >= AT_CONF_CRITICALITY_HOLD_SLOTS)
+    {
+        propagation->release_table = false;
+        Airtight_RequestModeSwitch(mac_state, LOW_CRIT);
+    }
+
+    if (NULL == mac_state->notification_handler)
+    {
+        propagation->relay_count = 0;
+        return 0;
+    }
+
+    at_u8_t sent = 0;
+    while (sent < propagation->relay_count && sent < budget)
+    {
+        mac_state->notification_handler(&propagation->relays[sent]);
+        sent++;
+    }
+
+    propagation->relay_count -= sent;
+    memmove(propagation->relays, &propagation->relays[sent], propagation->relay_count * sizeof(Airtight_Notification));
+
+    return sent;
+}
+
+/**
+ * Record a neighbour's criticality notice and pass it on while its ttl
+ * allows.
+ *
+ * Copies of a notice already heard through another neighbour are dropped,
+ * unless the origin has been silent for a lease, as it may have restarted
+ * its epochs.
+ */
+static void Airtight_HandleCriticalityNotice(Airtight_MACState *mac_state, const Airtight_Notification *notification)
+{
+    const Airtight_CriticalityNotice *notice = &notification->criticality;
+
+    if (notice->origin_id == AT_CONF_NODE_ID || notice->origin_id >= AT_CONF_CRITICALITY_TABLE_SIZE || notice->mode > LOW_CRIT)
+    {
+        return;
+    }
+
+    Airtight_CriticalityOrigin *origin = &mac_state->propagation.origins[notice->origin_id];
+
+    if (origin->known && (at_i16_t)(notice->epoch - origin->epoch) <= 0 &&
+        (at_i16_t)(mac_state->local_slot - origin->expiry_slot) < 0)
+    {
+        return;
+    }
+
+    origin->known = true;
+    origin->epoch = notice->epoch;
+    origin->mode = notice->mode;
+    origin->via = Airtight_NextHop(notice->origin_id);
+    origin->expiry_slot = mac_state->local_slot + AT_CONF_CRITICALITY_LEASE_SLOTS;
+
+    AT_DEBUGF("Airtight_HandleCriticalityNotice: node %u in mode %u, via %u", notice->origin_id, notice->mode, origin->via);
+
+    if (notice->ttl > 1)
+    {
+        Airtight_Notification relay = *notification;
+        relay.criticality.ttl--;
+        Airtight_QueueCriticalityNotice(mac_state, &relay);
+    }
+}
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_ExpireCriticalityOrigins(mac_state)
+// \endcond
+#endif
+
+/**
+ * Move to the next more critical mode, clearing the packets of the levels
+ * no longer served that AT_CONF_CRITICALITY_CLEAR_MASK selects. Below the
+ * top level failed acks are counted afresh against the new mode's threshold,
+ * on reaching HIGH_CRIT they keep counting as with two levels.
+ */
+void Airtight_GoHigh(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_GoHigh);
+    if (mac_state->criticality_mode != HIGH_CRIT)
+    {
+        mac_state->criticality_mode--;
+    }
+    if (mac_state->criticality_mode != HIGH_CRIT)
+    {
+        mac_state->acknowledge_fails = 0;
+    }
+    Airtight_InvalidateStaged(mac_state);
+    Airtight_RequestModeSwitch(mac_state, mac_state->criticality_mode == HIGH_CRIT ? HIGH_CRIT : LOW_CRIT);
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+    mac_state->propagation.release_table = false;
+#endif
+
+    const Airtight_CriticalityMask shed = AT_CONF_CRITICALITY_CLEAR_MASK & ~AIRTIGHT_CRITICALITY_AT_LEAST(mac_state->criticality_mode);
+    Airtight_PCQ_ClearMask(mac_state->queue, Airtight_PCQ_PrioritiesOf(mac_state->queue, shed));
+}
+
+at_bool_t Airtight_CheckShouldDequeuePacket(Airtight_Packet *packet)
+{
+    AT_ENTER(Airtight_CheckShouldDequeuePacket);
+    const Airtight_Criticality criticality = packet->data.fields.criticality;
+
+    return packet->meta.local_retransmit_count >= _RETRANSMISSION_LIMITS[criticality < LOW_CRIT ? criticality : LOW_CRIT];
+}
+
+void Airtight_TriggerFault(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_TriggerFault);
+    if (!mac_state->fault_active)
+    {
+        mac_state->fault_active = true;
+        // Start fault clear timer
+        Airtight_Time_SetAlarm(&mac_state->fault_alarm, AT_CONF_SLOT_LENGTH_MS * AT_CONF_FAULT_LENGTH_SLOTS);
+    }
+}
+
+void Airtight_CheckForFaultTrigger(Airtight_MACState *mac_state, at_u8_t sync_slot)
+{
+    AT_ENTER(Airtight_CheckForFaultTrigger);
+    at_i16_t offset = (sync_slot % AT_CONF_FAULT_PERIOD_INTERVAL_SLOTS) - AT_CONF_SLOT_FAULT_OFFSET;
+    if (offset > 0 && offset < AT_CONF_SLOT_TABLE_ROWS)
+    {
+        Airtight_TriggerFault(mac_state);
+    }
+}
+
+void Airtight_RegisterFailedAck(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_RegisterFailedAck);
+    mac_state->acknowledge_fails++;
+    if (mac_state->acknowledge_fails > AT_CONF_MAX_NODE_ACK_FAILS)
+    {
+        mac_state->acknowledge_fails = AT_CONF_MAX_NODE_ACK_FAILS;
+    }
+}
+
+void Airtight_ClearAckFails(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_ClearAckFails);
+    mac_state->acknowledge_fails = 0;
+}
+
+/**
+ * Move to the next less critical mode.
+ */
+void Airtight_GoLow(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_GoLow);
+    if (mac_state->criticality_mode != LOW_CRIT)
+    {
+        mac_state->criticality_mode++;
+    }
+    Airtight_ClearAckFails(mac_state);
+    Airtight_InvalidateStaged(mac_state);
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+    // The slot table is relaxed with the criticality notice, after the hold.
+    mac_state->propagation.relax_slot = mac_state->local_slot;
+    mac_state->propagation.release_table = mac_state->criticality_mode != HIGH_CRIT;
+#else
+    Airtight_RequestModeSwitch(mac_state, mac_state->criticality_mode == HIGH_CRIT ? HIGH_CRIT : LOW_CRIT);
+#endif
+}
+
+void Airtight_RecordSuccessfullySentPacket(Airtight_MACState *mac_state, Airtight_Packet *packet)
+{
+    AT_ENTER(Airtight_RecordSuccessfullySentPacket);
+    Airtight_Record record;
+    record.send.flow_id = packet->data.fields.flow_id;
+    record.send.inject_time = packet->meta.inject_time;
+    record.send.sequence_number = packet->data.fields.sequence_number;
+    record.send.send_time = packet->meta.send_time;
+
+    Airtight_History_Push(&mac_state->send_history, &record);
+}
+
+void Airtight_RecordSuccessfullyReceivedPacket(Airtight_MACState *mac_state, Airtight_Packet *packet)
+{
+    AT_ENTER(Airtight_RecordSuccessfullyReceivedPacket);
+    Airtight_Record record;
+    record.receive.flow_id = packet->data.fields.flow_id;
+    record.receive.sequence_number = packet->data.fields.sequence_number;
+
+    Airtight_History_Push(&mac_state->receive_history, &record);
+}
+
+void Airtight_ClearFault(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_ClearFault);
+    mac_state->fault_active = false;
+}
+
+#if (AT_CONF_EDF == 1)
+/**
+ * Drop queued packets whose deadline has passed, so they take no airtime.
+ */
+static void Airtight_DropExpired(Airtight_MACState *mac_state)
+{
+    const at_time_t now = Airtight_Time_GetSynchronisedTime(&mac_state->time);
+
+    for (Airtight_Priority i = 0; i < AIRTIGHT_PRIORITIES; i++)
+    {
+        if (Airtight_PCQ_DropExpiredPriority(mac_state->queue, i, now) > 0)
+        {
+            AT_DEBUGF("Airtight_DropExpired: dropped expired packets at priority %u\n", i);
+        }
+    }
+}
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_DropExpired(mac_state)
+// \endcond
+#endif
+
+/**
+ * Find the queued packet the next transmission should carry.
+ *
+ * This is the first packet Airtight_NextTransmitPacket visits. Failing that,
+ * packets served in the current mode are preferred, otherwise the head of
+ * the PCQ is taken. This has no side effects so may be used ahead of the slot.
+ *
+ * @return a pointer into the PCQ, NULL if there is nothing to send
+ */
+Airtight_Packet *Airtight_PeekTransmitPacket(Airtight_MACState *mac_state)
+{
+    Airtight_TransmitCursor cursor = {.priority = 0, .offset = 0, .all_hops = false};
+    Airtight_Packet *packet = Airtight_NextTransmitPacket(mac_state, &cursor);
+
+    if (NULL == packet && mac_state->criticality_mode != LOW_CRIT)
+    {
+        packet = Airtight_PCQ_HeadMaskP(mac_state->queue, Airtight_ServedPriorities(mac_state));
+    }
+
+    if (NULL == packet)
+    {
+        packet = Airtight_PCQ_HeadP(mac_state->queue);
+    }
+
+    return packet;
+}
+
+/**
+ * Step through the packets a transmit slot may carry, in the order they
+ * should be sent.
+ *
+ * Priorities are taken in order and each is sent in queue order. Only
+ * packets at least as critical as the current mode are considered. Packets for backed off next hops
+ * are skipped unless the cursor's all_hops is set, so a failing hop does not
+ * hold up the packets queued behind its own. A zeroed cursor starts from the
+ * first packet, which is the one Airtight_PeekTransmitPacket finds when there
+ * is an eligible packet at the current mode's criticality.
+ *
+ * @return a pointer into the PCQ, NULL once every packet has been visited
+ */
+Airtight_Packet *Airtight_NextTransmitPacket(Airtight_MACState *mac_state, Airtight_TransmitCursor *cursor)
+{
+    for (; cursor->priority < AIRTIGHT_PRIORITIES; cursor->priority++, cursor->offset = 0)
+    {
+        if (mac_state->queue->criticalities[cursor->priority] > mac_state->criticality_mode)
+        {
+            continue;
+        }
+
+        Airtight_Packet *packet;
+
+        while (NULL != (packet = Airtight_PCQ_PeekPriorityP(mac_state->queue, cursor->priority, cursor->offset)))
+        {
+            cursor->offset++;
+
+            if (!Airtight_CursorSkips(mac_state, cursor, packet))
+            {
+                return packet;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Update the smoothed frame airtime with a measurement from the radio.
+ *
+ * The measurement should run from the later of the frame being written and
+ * the previous frame completing, to its transmit status being received.
+ */
+void Airtight_RegisterAirtime(Airtight_MACState *mac_state, at_u32_t airtime_us)
+{
+    // Exponentially weighted with a weight of 1/8 for the new measurement.
+    const at_i32_t error = (at_i32_t)airtime_us - (at_i32_t)mac_state->airtime_us;
+    mac_state->airtime_us = (at_u32_t)((at_i32_t)mac_state->airtime_us + error / 8);
+
+    if (mac_state->airtime_us == 0)
+    {
+        mac_state->airtime_us = 1;
+    }
+}
+
+/**
+ * The number of packets which fit back to back in a transmit slot.
+ *
+ * @return at least 1 and at most AT_CONF_MAX_TRANSMITS_PER_SLOT
+ */
+at_u8_t Airtight_TransmitBudget(Airtight_MACState *mac_state)
+{
+    const at_u32_t usable_us = AT_CONF_SLOT_LENGTH_MS * 1000UL > AT_CONF_SLOT_GUARD_US ? AT_CONF_SLOT_LENGTH_MS * 1000UL - AT_CONF_SLOT_GUARD_US : 0;
+    const at_u32_t budget = usable_us / mac_state->airtime_us;
+
+    if (budget < 1)
+    {
+        return 1;
+    }
+    if (budget > AT_CONF_MAX_TRANSMITS_PER_SLOT)
+    {
+        return AT_CONF_MAX_TRANSMITS_PER_SLOT;
+    }
+
+    return budget;
+}
+
+/**
+ * Copy a queued packet and fill in its hop specific fields for sending.
+ */
+void Airtight_PrepareTransmitPacket(Airtight_MACState *mac_state, Airtight_Packet *forward_packet, const Airtight_Packet *queued_packet, at_u16_t hop_send_slot)
+{
+    memcpy(forward_packet, queued_packet, sizeof(Airtight_Packet));
+
+    forward_packet->data.fields.hop_source = AT_CONF_NODE_ID;
+    forward_packet->data.fields.hop_destination = Airtight_NextHop(forward_packet->data.fields.destination);
+
+    forward_packet->meta.send_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
+    forward_packet->meta.failed_ack_status = mac_state->acknowledge_fails;
+    forward_packet->meta.hop_send_slot = hop_send_slot;
+}
+
+/**
+ * The number of slots until this node's next transmit slot.
+ *
+ * @return the distance in slots, or 0 if this node never transmits
+ */
+at_u8_t Airtight_SlotsUntilTransmit(Airtight_MACState *mac_state)
+{
+    at_u8_t slot = mac_state->current_slot;
+
+    for (at_u16_t distance = 1; distance <= AIRTIGHT_HYPERPERIOD_SLOTS; distance++)
+    {
+        slot = (slot + 1) % AT_CONF_SLOT_TABLE_ROWS;
+        const at_u16_t local_slot = mac_state->local_slot + distance;
+
+        if (slot != AT_CONF_SYNC_SLOT_INDEX &&
+            Airtight_GetSlotAction(Airtight_ScheduleModeAt(mac_state, local_slot), local_slot, slot) == ACTION_TRANSMIT)
+        {
+            return distance;
+        }
+    }
+
+    return 0;
+}
+
+#if (AT_CONF_STAGED_TRANSMIT == 1)
+/**
+ * Build the frame for this node's next transmit slot ahead of time.
+ *
+ * The packet the slot would carry is prepared as if sent in that slot and
+ * handed to the stage handler, which builds the radio frame. Any previously
+ * staged frame is discarded.
+ */
+void Airtight_StageTransmit(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_StageTransmit);
+    Airtight_SpillCutThrough(mac_state);
+    mac_state->staged.valid = false;
+
+    if (NULL == mac_state->stage_handler || NULL == mac_state->staged_transmit_handler)
+    {
+        return;
+    }
+
+    Airtight_DropExpired(mac_state);
+
+    const at_u8_t distance = Airtight_SlotsUntilTransmit(mac_state);
+    Airtight_Packet *source = Airtight_PeekTransmitPacket(mac_state);
+
+    if (distance == 0 || NULL == source)
+    {
+        return;
+    }
+
+    Airtight_PrepareTransmitPacket(mac_state, &mac_state->staged.packet, source, mac_state->local_slot + distance);
+    mac_state->staged.source = source;
+    mac_state->staged.cut_through = false;
+    mac_state->staged.local_slot = mac_state->local_slot + distance;
+    mac_state->staged.valid = true;
+
+    AT_DEBUG("Airtight_StageTransmit: staging frame");
+    mac_state->stage_handler(&mac_state->staged.packet);
+}
+
+/**
+ * Check the staged frame still carries the packet this slot should send.
+ */
+static at_bool_t Airtight_StagedMatches(Airtight_MACState *mac_state, const Airtight_Packet *packet)
+{
+    const Airtight_PacketDataInner *staged = &mac_state->staged.packet.data.fields;
+
+    return mac_state->staged.valid &&
+           mac_state->staged.source == packet &&
+           mac_state->staged.local_slot == mac_state->local_slot &&
+           staged->sequence_number == packet->data.fields.sequence_number &&
+           staged->source == packet->data.fields.source &&
+           staged->flow_id == packet->data.fields.flow_id &&
+           staged->destination == packet->data.fields.destination;
+}
+#endif
+
+#if (AT_CONF_CUT_THROUGH == 1)
+/**
+ * Stage a received packet to forward as the frame of the next slot, without
+ * queueing it.
+ *
+ * This is only done when the next slot is this node's transmit slot and the
+ * packet would be the first it sends: nothing is queued at its priority or
+ * a more urgent one, and its next hop is not backed off. One packet may be
+ * cut through per slot. A frame staged from the PCQ is replaced, its packet
+ * stays queued.
+ *
+ * @return true if the packet was staged, false if it should be queued
+ */
+static at_bool_t Airtight_TryCutThrough(Airtight_MACState *mac_state, Airtight_Packet *packet)
+{
+    const Airtight_Priority priority = packet->data.fields.priority;
+    const Airtight_Criticality criticality = packet->data.fields.criticality;
+
+    if (!mac_state->cut_through_enabled ||
+        NULL == mac_state->stage_handler || NULL == mac_state->staged_transmit_handler ||
+        (mac_state->staged.valid && mac_state->staged.cut_through) ||
+        priority > AIRTIGHT_PRIORITY_MAX ||
+        criticality != mac_state->queue->criticalities[priority] ||
+        criticality > mac_state->criticality_mode ||
+        Airtight_SlotsUntilTransmit(mac_state) != 1)
+    {
+        return false;
+    }
+
+    for (Airtight_Priority i = 0; i <= priority; i++)
+    {
+        if (Airtight_PCQ_SizePriority(mac_state->queue, i) > 0)
+        {
+            return false;
+        }
+    }
+
+#if (AT_CONF_HOP_BACKOFF == 1)
+    if (!Airtight_HopEligible(mac_state, Airtight_NextHop(packet->data.fields.destination)))
+    {
+        return false;
+    }
+#endif
+
+    packet->meta.local_retransmit_count = 0;
+    packet->meta.enqueue_slot = mac_state->local_slot;
+    packet->meta.cut_through = true;
+    memcpy(&mac_state->staged.original, packet, sizeof(Airtight_Packet));
+
+    Airtight_PrepareTransmitPacket(mac_state, &mac_state->staged.packet, packet, mac_state->local_slot + 1);
+    mac_state->staged.source = NULL;
+    mac_state->staged.local_slot = mac_state->local_slot + 1;
+    mac_state->staged.valid = true;
+    mac_state->staged.cut_through = true;
+
+    AT_LOG_MAC(mac_state, "CUT_THROUGH", *packet);
+    mac_state->stage_handler(&mac_state->staged.packet);
+
+    return true;
+}
+
+/**
+ * Send the staged cut-through frame if it was staged for this slot.
+ *
+ * @return true if it was sent
+ */
+static at_bool_t Airtight_TransmitCutThrough(Airtight_MACState *mac_state)
+{
+    if (!mac_state->staged.valid || !mac_state->staged.cut_through)
+    {
+        return false;
+    }
+
+    if (mac_state->staged.local_slot != mac_state->local_slot)
+    {
+        Airtight_SpillCutThrough(mac_state);
+        return false;
+    }
+
+    mac_state->staged.valid = false;
+    mac_state->staged.cut_through = false;
+    mac_state->staged.packet.meta.send_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
+    mac_state->staged.packet.meta.failed_ack_status = mac_state->acknowledge_fails;
+
+    AT_DEBUG("Airtight_TransmitCutThrough: calling staged transmit handler");
+    AT_LOG_MAC(mac_state, "TRANSMIT", mac_state->staged.packet);
+    mac_state->staged_transmit_handler(&mac_state->staged.packet);
+
+    return true;
+}
+#endif
+
+/**
+ * Prepare a queued packet and pass it to the transmit handler.
+ */
+static void Airtight_TransmitPacket(Airtight_MACState *mac_state, const Airtight_Packet *queued_packet)
+{
+    Airtight_Packet forward_packet;
+
+    Airtight_PrepareTransmitPacket(mac_state, &forward_packet, queued_packet, mac_state->local_slot);
+
+    if (NULL != mac_state->transmit_handler)
+    {
+        AT_DEBUG("Airtight_TransmitPacket: calling transmit handler");
+        AT_LOG_MAC(mac_state, "TRANSMIT", forward_packet);
+        mac_state->transmit_handler(&forward_packet);
+    }
+    else
+    {
+        AT_DEBUG("Airtight_TransmitPacket: warning, no transmit handler");
+    }
+}
+
+/**
+ * Send a single packet, from the staged frame if it is the first of the slot
+ * and still matches.
+ */
+static void Airtight_TransmitSingle(Airtight_MACState *mac_state, const Airtight_Packet *queued_packet, at_bool_t first)
+{
+#if (AT_CONF_STAGED_TRANSMIT == 1)
+    if (first && Airtight_StagedMatches(mac_state, queued_packet))
+    {
+        // Only the unsent metadata is refreshed, the frame is already built.
+        mac_state->staged.valid = false;
+        mac_state->staged.packet.meta.send_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
+        mac_state->staged.packet.meta.failed_ack_status = mac_state->acknowledge_fails;
+
+        AT_DEBUG("Airtight_TransmitSingle: calling staged transmit handler");
+        AT_LOG_MAC(mac_state, "TRANSMIT", mac_state->staged.packet);
+        mac_state->staged_transmit_handler(&mac_state->staged.packet);
+        return;
+    }
+#else
+    (void)first;
+#endif
+
+    Airtight_TransmitPacket(mac_state, queued_packet);
+}
+
+#if (AT_CONF_AGGREGATION == 1)
+/**
+ * Send a candidate packet together with later candidates for the same hop
+ * destination as one aggregate frame.
+ *
+ * Packets included are removed from the candidates.
+ *
+ * @return false if no other candidate shares the hop, nothing is sent
+ */
+static at_bool_t Airtight_TransmitAggregate(Airtight_MACState *mac_state, Airtight_Packet **candidates, at_u8_t candidate_count, at_u8_t first)
+{
+    const Airtight_NodeId hop_destination = Airtight_NextHop(candidates[first]->data.fields.destination);
+    at_u8_t members[AIRTIGHT_AGGREGATE_MAX_PACKETS];
+    at_u8_t member_count = 0;
+
+    members[member_count++] = first;
+    for (at_u8_t i = first + 1; i < candidate_count && member_count < AIRTIGHT_AGGREGATE_MAX_PACKETS; i++)
+    {
+        if (NULL != candidates[i] && Airtight_NextHop(candidates[i]->data.fields.destination) == hop_destination)
+        {
+            members[member_count++] = i;
+        }
+    }
+
+    if (member_count < 2)
+    {
+        return false;
+    }
+
+    Airtight_Aggregate aggregate;
+    Airtight_Aggregate_Init(&aggregate);
+
+    for (at_u8_t i = 0; i < member_count; i++)
+    {
+        Airtight_Packet forward_packet;
+        Airtight_PrepareTransmitPacket(mac_state, &forward_packet, candidates[members[i]], mac_state->local_slot);
+        Airtight_Aggregate_Add(&aggregate, &forward_packet);
+        AT_LOG_MAC(mac_state, "TRANSMIT", forward_packet);
+        candidates[members[i]] = NULL;
+    }
+
+    AT_DEBUG("Airtight_TransmitAggregate: calling aggregate transmit handler");
+    mac_state->aggregate_transmit_handler(&aggregate);
+
+    return true;
+}
+#endif
+
+#if (AT_CONF_SLOT_LENDING == 1)
+/**
+ * Tell the slot's secondary owner that this node has nothing to send, so it
+ * may use the rest of the slot.
+ *
+ * Only a slot with nothing to send is lent, so no queued packet waits
+ * longer, and only in LOW criticality mode, so HIGH mode keeps the slots
+ * the analysis assumed.
+ */
+static void Airtight_LendSlot(Airtight_MACState *mac_state)
+{
+    const Airtight_Criticality schedule_mode = Airtight_ScheduleModeAt(mac_state, mac_state->local_slot);
+
+    if (mac_state->criticality_mode != LOW_CRIT || NULL == mac_state->notification_handler ||
+        !Airtight_SlotHasSecondary(schedule_mode, mac_state->local_slot, mac_state->current_slot))
+    {
+        return;
+    }
+
+    Airtight_Notification notification =
+        {{.fault_activity = FAULT_SLOT_FREE,
+          .root_id = AT_CONF_NODE_ID,
+          .sync_slot = mac_state->local_slot,
+          .sync_time = 0}};
+
+    AT_DEBUG("Airtight_LendSlot: lending slot to secondary owner");
+    mac_state->notification_handler(&notification);
+}
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_LendSlot(mac_state)
+// \endcond
+#endif
+
+#if (AT_CONF_BEST_EFFORT == 1)
+/**
+ * Draw the sub-slots to wait before sending the head of the bulk queue.
+ */
+static void Airtight_DrawBackoff(Airtight_MACState *mac_state)
+{
+    Airtight_BestEffort *best_effort = &mac_state->best_effort;
+    at_u16_t random = best_effort->random;
+
+    // xorshift16
+    random ^= random << 7;
+    random ^= random >> 9;
+    random ^= random << 8;
+    best_effort->random = random;
+
+    best_effort->backoff = random % best_effort->window;
+}
+
+/**
+ * Queue a packet for best-effort service in contention slots.
+ *
+ * Bulk packets are sent once each, without burst copies, and never enter
+ * the PCQ.
+ *
+ * @return false if the bulk queue is full and the packet was dropped
+ */
+at_bool_t Airtight_SendBulk(Airtight_MACState *mac_state, Airtight_Packet *packet)
+{
+    AT_ENTER(Airtight_SendBulk);
+    const at_bool_t was_empty = Airtight_Bulk_Size(&mac_state->best_effort.queue) == 0;
+
+    packet->meta.bulk = true;
+    packet->data.fields.flow_id |= AIRTIGHT_BULK_FLOW_FLAG;
+    packet->meta.local_retransmit_count = 0;
+    packet->meta.enqueue_slot = mac_state->local_slot;
+    packet->meta.inject_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
+
+    AT_LOG_MAC(mac_state, "BULK", *packet);
+    if (!Airtight_Bulk_Push(&mac_state->best_effort.queue, packet))
+    {
+        AT_DEBUG("Airtight_SendBulk: bulk queue full, dropping packet.");
+        return false;
+    }
+
+    if (was_empty)
+    {
+        Airtight_DrawBackoff(mac_state);
+    }
+
+    return true;
+}
+
+/**
+ * Send the head of the bulk queue unless a bulk packet is already in
+ * flight.
+ */
+static at_bool_t Airtight_TransmitBulk(Airtight_MACState *mac_state)
+{
+    Airtight_Packet *head = Airtight_Bulk_Head(&mac_state->best_effort.queue);
+
+    if (NULL == head || mac_state->best_effort.in_flight || NULL == mac_state->transmit_handler)
+    {
+        return false;
+    }
+
+    Airtight_Packet forward_packet;
+    Airtight_PrepareTransmitPacket(mac_state, &forward_packet, head, mac_state->local_slot);
+
+    AT_DEBUG("Airtight_TransmitBulk: calling transmit handler");
+    AT_LOG_MAC(mac_state, "TRANSMIT", forward_packet);
+    mac_state->best_effort.in_flight = true;
+    mac_state->transmit_handler(&forward_packet);
+
+    return true;
+}
+
+/**
+ * Give up on guarantees after acks keep failing in HIGH criticality mode.
+ *
+ * The PCQ is cleared as configured and packets sent from now on are queued
+ * for best-effort service, which also uses this node's transmit slots.
+ */
+static void Airtight_GoBestEffort(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_GoBestEffort);
+    mac_state->best_effort.mode = true;
+    Airtight_ClearAckFails(mac_state);
+    Airtight_InvalidateStaged(mac_state);
+
+#if (AT_CONF_CLEAR_PACKETS_ON_BEST_EFFORT == 1)
+    Airtight_PCQ_ClearMask(mac_state->queue, Airtight_PCQ_PrioritiesOf(mac_state->queue, AIRTIGHT_CRITICALITY_ALL));
+#elif (AT_CONF_CLEAR_HIGH_PACKETS_ON_BEST_EFFORT == 1)
+    Airtight_PCQ_ClearMask(mac_state->queue, Airtight_PCQ_PrioritiesOf(mac_state->queue, AIRTIGHT_CRITICALITY_BIT(HIGH_CRIT)));
+#endif
+}
+
+static at_bool_t Airtight_CheckShouldGoBestEffort(Airtight_MACState *mac_state)
+{
+    return mac_state->criticality_mode == HIGH_CRIT && !mac_state->best_effort.mode &&
+           mac_state->acknowledge_fails >= AT_CONF_BEST_EFFORT_THRESHOLD;
+}
+
+/**
+ * Handle the transmit status of a bulk packet.
+ *
+ * The contention window doubles with each failure and resets on success,
+ * which also ends best-effort mode as the node's link works again.
+ */
+static void Airtight_RegisterBulkSendComplete(Airtight_MACState *mac_state, Airtight_Packet *packet, at_bool_t was_acked)
+{
+    Airtight_BestEffort *best_effort = &mac_state->best_effort;
+    Airtight_Packet *head = Airtight_Bulk_Head(&best_effort->queue);
+
+    best_effort->in_flight = false;
+
+    if (NULL == head || !Airtight_IsSamePacket(head, packet))
+    {
+        AT_DEBUG("Airtight_RegisterBulkSendComplete: packet no longer queued.");
+        return;
+    }
+
+    if (was_acked)
+    {
+        AT_LOG_MAC(mac_state, "ACK_SUCCESS", *packet);
+        Airtight_Bulk_Pop(&best_effort->queue);
+        best_effort->window = AT_CONF_BEST_EFFORT_WINDOW_MIN;
+        best_effort->retries = 0;
+
+        if (best_effort->mode)
+        {
+            AT_DEBUG("Airtight_RegisterBulkSendComplete: leaving best-effort mode");
+            best_effort->mode = false;
+            Airtight_ClearAckFails(mac_state);
+        }
+    }
+    else
+    {
+        AT_LOG_MAC(mac_state, "ACK_FAIL", *packet);
+        if (++best_effort->retries > AT_CONF_BEST_EFFORT_RETRIES)
+        {
+            Airtight_Bulk_Pop(&best_effort->queue);
+            best_effort->retries = 0;
+        }
+        if (best_effort->window < AT_CONF_BEST_EFFORT_WINDOW_MAX)
+        {
+            best_effort->window *= 2;
+        }
+    }
+
+    Airtight_DrawBackoff(mac_state);
+}
+
+/**
+ * Contend for the current best-effort slot in one of its sub-slots.
+ *
+ * Called as the slot's sub-slots pass. Each sub-slot counts down the
+ * backoff and the head of the bulk queue is sent when it reaches zero,
+ * with the radio's own CCA deferring to a neighbour already sending. Other
+ * slots are ignored.
+ */
+void Airtight_DoSubSlot(Airtight_MACState *mac_state, at_u8_t subslot)
+{
+    Airtight_BestEffort *best_effort = &mac_state->best_effort;
+
+    if (!best_effort->slot_active || subslot == best_effort->subslot || subslot >= AT_CONF_BEST_EFFORT_SUBSLOTS)
+    {
+        return;
+    }
+
+    best_effort->subslot = subslot;
+
+    if (best_effort->in_flight || Airtight_Bulk_Size(&best_effort->queue) == 0)
+    {
+        return;
+    }
+
+    if (best_effort->backoff > 0)
+    {
+        best_effort->backoff--;
+        return;
+    }
 
-    Airtight_History_Push(&mac_state->receive_history, &record);
+    Airtight_TransmitBulk(mac_state);
 }
 
-void Airtight_ClearFault(Airtight_MACState *mac_state)
+/**
+ * Start or end best-effort contention as a slot begins.
+ */
+static void Airtight_StartBestEffortSlot(Airtight_MACState *mac_state, Airtight_SlotAction scheduled_action)
 {
-    AT_ENTER(Airtight_ClearFault);
-    mac_state->fault_active = false;
+    mac_state->best_effort.slot_active = scheduled_action == ACTION_BEST_EFFORT;
+    mac_state->best_effort.subslot = AT_CONF_BEST_EFFORT_SUBSLOTS;
+    Airtight_DoSubSlot(mac_state, 0);
 }
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_StartBestEffortSlot(mac_state, scheduled_action)
+// \endcond
+#endif
 
-void Airtight_HandleTransmitSlot(Airtight_MACState *mac_state)
+/**
+ * Send the frames of a transmit slot, or of a slot lent by its owner.
+ */
+static void Airtight_TransmitInSlot(Airtight_MACState *mac_state, at_bool_t lent)
 {
-    AT_ENTER(Airtight_HandleTransmitSlot);
-    Airtight_Packet forward_packet;
-    at_bool_t has_packet = false;
+    Airtight_TransmitCursor cursor = {.priority = 0, .offset = 0, .all_hops = false};
+    Airtight_Packet *candidates[AIRTIGHT_SLOT_MAX_PACKETS];
+    at_u8_t candidate_count = 0;
 
     AT_DEBUG("Airtight_HandleTransmitSlot: finding packet");
-    if (mac_state->criticality_mode == HIGH_CRIT)
+    Airtight_DropExpired(mac_state);
+
+#if (AT_CONF_CUT_THROUGH == 1)
+    at_u8_t frames = Airtight_TransmitCutThrough(mac_state) ? 1 : 0;
+#else
+    at_u8_t frames = 0;
+#endif
+
+    if (mac_state->criticality_mode != LOW_CRIT && NULL == Airtight_PCQ_HeadMaskP(mac_state->queue, Airtight_ServedPriorities(mac_state)))
     {
-        AT_DEBUG("Airtight_HandleTransmitSlot: finding high-crit packet");
-        has_packet = Airtight_PCQ_HeadCriticality(&mac_state->queue, HIGH_CRIT, &forward_packet);
-        if (!has_packet)
-        {
-            AT_DEBUG("Airtight_HandleTransmitSlot: no packet at criticality, going low");
-            Airtight_GoLow(mac_state);
-        }
+        AT_DEBUG("Airtight_HandleTransmitSlot: no packet at criticality, going low");
+        Airtight_GoLow(mac_state);
+    }
+
+#if (AT_CONF_MODE_SCHEDULES == 1)
+    frames += Airtight_AnnounceModeSwitch(mac_state) ? 1 : 0;
+#endif
+
+    // Frames are sent back to back while the slot has time for them. The
+    // owner's notice has taken the time of a frame from a lent slot.
+    at_u8_t budget = Airtight_TransmitBudget(mac_state);
+    if (lent && budget > 1)
+    {
+        budget--;
     }
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+    frames += Airtight_SendCriticalityNotices(mac_state, frames < budget ? budget - frames : 0);
+#endif
+#if (AT_CONF_AGGREGATION == 1)
+    const at_u8_t frame_capacity = NULL != mac_state->aggregate_transmit_handler ? AIRTIGHT_AGGREGATE_MAX_PACKETS : 1;
+#else
+    const at_u8_t frame_capacity = 1;
+#endif
 
-    if (mac_state->criticality_mode != HIGH_CRIT || !has_packet)
+    while (candidate_count < budget * frame_capacity)
     {
-        AT_DEBUG("Airtight_HandleTransmitSlot: finding any-crit packet");
-        has_packet = Airtight_PCQ_Head(&mac_state->queue, &forward_packet);
+        Airtight_Packet *queued_packet = Airtight_NextTransmitPacket(mac_state, &cursor);
+
+        if (NULL == queued_packet)
+        {
+#if (AT_CONF_HOP_BACKOFF == 1)
+            // Rather than leave the slot idle, probe the backed off hops.
+            if (candidate_count == 0 && !cursor.all_hops)
+            {
+                cursor = (Airtight_TransmitCursor){.priority = 0, .offset = 0, .all_hops = true};
+                continue;
+            }
+#endif
+            break;
+        }
+
+        candidates[candidate_count++] = queued_packet;
     }
 
-    if (!has_packet && Airtight_PCQ_Size(&mac_state->queue) > 0)
+#if (AT_CONF_BEST_EFFORT == 1)
+    // In best-effort mode the node's own slots carry bulk packets too.
+    if (candidate_count == 0 && frames == 0 && mac_state->best_effort.mode && Airtight_TransmitBulk(mac_state))
     {
-        AT_DEBUG("Airtight_HandleTransmitSlot: warning, no packet found but size > 0");
-        // Error has occurred
+        frames++;
     }
+#endif
 
-    if (!has_packet)
+    if (candidate_count == 0 && frames == 0)
     {
         AT_DEBUG("Airtight_HandleTransmitSlot: no packet found");
+        if (!lent)
+        {
+            Airtight_LendSlot(mac_state);
+        }
+        Airtight_InvalidateStaged(mac_state);
         return;
     }
 
-    forward_packet.data.fields.hop_source = AT_CONF_NODE_ID;
-    forward_packet.data.fields.hop_destination = Airtight_NextHop(forward_packet.data.fields.destination);
+    for (at_u8_t first = 0; first < candidate_count && frames < budget; first++)
+    {
+        if (NULL == candidates[first])
+        {
+            continue;
+        }
 
-    forward_packet.meta.send_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
-    forward_packet.meta.failed_ack_status = mac_state->acknowledge_fails;
-    forward_packet.meta.hop_send_slot = mac_state->local_slot;
+#if (AT_CONF_AGGREGATION == 1)
+        if (frame_capacity > 1 && Airtight_TransmitAggregate(mac_state, candidates, candidate_count, first))
+        {
+            frames++;
+            continue;
+        }
+#endif
 
-    if (NULL != mac_state->transmit_handler)
-    {
-        AT_DEBUG("Airtight_HandleTransmitSlot: calling transmit handler");
-        AT_LOG_MAC(mac_state, "TRANSMIT", forward_packet);
-        mac_state->transmit_handler(&forward_packet);
+        Airtight_TransmitSingle(mac_state, candidates[first], frames == 0);
+        frames++;
     }
-    else
+
+    Airtight_InvalidateStaged(mac_state);
+}
+
+void Airtight_HandleTransmitSlot(Airtight_MACState *mac_state)
+{
+    AT_ENTER(Airtight_HandleTransmitSlot);
+    Airtight_TransmitInSlot(mac_state, false);
+}
+
+#if (AT_CONF_SLOT_LENDING == 1)
+/**
+ * Use a slot lent by its owner if this node is the slot's secondary owner.
+ *
+ * The notice must be for the current slot, from a node the table lets
+ * transmit in it, and each slot is used once even if several owners lend.
+ */
+static void Airtight_HandleSlotFree(Airtight_MACState *mac_state, const Airtight_Notification *notification)
+{
+    const Airtight_Criticality schedule_mode = Airtight_ScheduleModeAt(mac_state, mac_state->local_slot);
+
+    if (mac_state->slot_borrowed || notification->fields.sync_slot != mac_state->local_slot ||
+        mac_state->current_slot == AT_CONF_SYNC_SLOT_INDEX ||
+        Airtight_GetSlotAction(schedule_mode, mac_state->local_slot, mac_state->current_slot) != ACTION_SECONDARY ||
+        !Airtight_SlotTransmitter(schedule_mode, mac_state->local_slot, mac_state->current_slot, notification->fields.root_id))
     {
-        AT_DEBUG("Airtight_HandleTransmitSlot: warning, no transmit handler");
+        return;
     }
+
+    AT_DEBUG("Airtight_HandleSlotFree: transmitting in lent slot");
+    mac_state->slot_borrowed = true;
+    Airtight_TransmitInSlot(mac_state, true);
 }
+#endif
 
 void Airtight_HandleBroadcastSync(Airtight_MACState *mac_state)
 {
@@ -214,6 +1602,18 @@ void Airtight_HandleBroadcastSync(Airtight_MACState *mac_state)
     }
 }
 
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+/**
+ * The channel of a slot for this node. A node which has not heard a sync
+ * does not know the network's local_slot, so it stays on the sync slot's
+ * channel, where the sync node's broadcast will reach it.
+ */
+static at_u8_t Airtight_SlotChannel(const Airtight_MACState *mac_state, at_u16_t local_slot, at_u8_t slot)
+{
+    return Airtight_GetSlotChannel(local_slot, mac_state->synchronised ? slot : AT_CONF_SYNC_SLOT_INDEX);
+}
+#endif
+
 void Airtight_DoSlot(Airtight_MACState *mac_state, at_u8_t slot)
 {
     AT_ENTER("Airtight_DoSlot");
@@ -230,10 +1630,30 @@ void Airtight_DoSlot(Airtight_MACState *mac_state, at_u8_t slot)
 
     mac_state->previous_slot = previous_slot;
 
-    scheduled_action = Airtight_GetSlotAction(slot);
+#if (AT_CONF_SLOT_LENDING == 1)
+    mac_state->slot_borrowed = false;
+#endif
+
+    Airtight_ExpireHopBackoff(mac_state);
+    Airtight_ExpireCriticalityOrigins(mac_state);
+
+#if (AT_CONF_MODE_SCHEDULES == 1)
+    Airtight_ApplyModeSwitch(mac_state);
+#endif
+
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+    if (NULL != mac_state->apply_channel_handler)
+    {
+        mac_state->apply_channel_handler(Airtight_SlotChannel(mac_state, mac_state->local_slot, slot));
+    }
+#endif
+
+    scheduled_action = Airtight_GetSlotAction(Airtight_ScheduleModeAt(mac_state, mac_state->local_slot), mac_state->local_slot, slot);
 
     AT_DEBUGF("Slot index: %u, %x\n", slot, scheduled_action);
 
+    Airtight_StartBestEffortSlot(mac_state, scheduled_action);
+
     if (slot == AT_CONF_SYNC_SLOT_INDEX && AT_CONF_NODE_ID == AT_CONF_SYNC_NODE_ID)
     {
         Airtight_HandleBroadcastSync(mac_state);
@@ -243,12 +1663,51 @@ void Airtight_DoSlot(Airtight_MACState *mac_state, at_u8_t slot)
     {
         Airtight_HandleTransmitSlot(mac_state);
     }
+#if (AT_CONF_STAGED_TRANSMIT == 1)
+    else if (!mac_state->staged.valid)
+    {
+        Airtight_StageTransmit(mac_state);
+    }
+#endif
+
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+    // After this slot's frames so the change is held by the radio until the
+    // next slot applies it.
+    if (NULL != mac_state->queue_channel_handler)
+    {
+        mac_state->queue_channel_handler(Airtight_SlotChannel(mac_state, mac_state->local_slot + 1, (slot + 1) % AT_CONF_SLOT_TABLE_ROWS));
+    }
+#endif
+}
+
+#if (AT_CONF_EDF == 1)
+/**
+ * Set a packet's absolute deadline from its flow's relative deadline and its
+ * inject time at this node.
+ */
+static inline void Airtight_SetDeadline(Airtight_Packet *packet)
+{
+    const at_time_t relative = Airtight_FlowDeadline(packet->data.fields.flow_id);
+
+    packet->meta.has_deadline = relative > 0;
+    packet->meta.deadline = packet->meta.inject_time + relative;
 }
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_SetDeadline(packet)
+// \endcond
+#endif
 
-void Airtight_Enqueue(Airtight_MACState *mac_state, Airtight_Packet *packet)
+/**
+ * Queue a packet in the PCQ.
+ *
+ * @return true if the packet was queued, false if it was discarded
+ */
+at_bool_t Airtight_Enqueue(Airtight_MACState *mac_state, Airtight_Packet *packet)
 {
     AT_ENTER(Airtight_Enqueue);
     const Airtight_Priority priority = packet->data.fields.priority;
+    at_bool_t queued = false;
 
     if (priority >= AIRTIGHT_PRIORITY_MIN && priority <= AIRTIGHT_PRIORITY_MAX)
     {
@@ -262,77 +1721,223 @@ void Airtight_Enqueue(Airtight_MACState *mac_state, Airtight_Packet *packet)
         data_packet.meta.local_retransmit_count = 0;
         data_packet.meta.enqueue_slot = mac_state->local_slot;
         data_packet.meta.inject_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
+        Airtight_SetDeadline(&data_packet);
 
-        Airtight_PCQ_Enqueue(&mac_state->queue, &data_packet);
+        queued = Airtight_PCQ_Enqueue(mac_state->queue, &data_packet);
 #else
         packet->meta.local_retransmit_count = 0;
         packet->meta.enqueue_slot = mac_state->local_slot;
         packet->meta.inject_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
+        Airtight_SetDeadline(packet);
+
+        queued = Airtight_PCQ_Enqueue(mac_state->queue, packet);
+#endif
 
-        Airtight_PCQ_Enqueue(&mac_state->queue, packet);
+#if (AT_CONF_STAGED_TRANSMIT == 1)
+        // Restage if nothing was staged or the new packet goes out first.
+        if (!mac_state->staged.valid ||
+            priority < mac_state->staged.packet.data.fields.priority ||
+            packet->data.fields.criticality < mac_state->staged.packet.data.fields.criticality)
+        {
+            Airtight_StageTransmit(mac_state);
+        }
 #endif
     }
     else
     {
         AT_DEBUG("Airtight_Enqueue: wrong priority packet.");
     }
+
+    return queued;
 }
 
-void Airtight_Send(Airtight_MACState *mac_state, Airtight_Packet *packet)
+/**
+ * The number of burst copies Airtight_Send queues of a packet.
+ */
+static inline at_u8_t Airtight_SendCopies(const Airtight_Packet *packet)
 {
-    AT_ENTER(Airtight_Send);
+    return packet->data.fields.c_value > AT_CONF_MAX_C_VALUE ? AT_CONF_MAX_C_VALUE : packet->data.fields.c_value;
+}
 
+/**
+ * Check whether Airtight_Send would accept a packet: its priority and
+ * criticality must match and, unless it is queued as bulk, it must have a
+ * copy to send and neither the mode nor its next hop may shed it.
+ */
+static at_bool_t Airtight_SendAccepts(Airtight_MACState *mac_state, const Airtight_Packet *packet)
+{
     const Airtight_Priority priority = packet->data.fields.priority;
     const Airtight_Priority criticality = packet->data.fields.criticality;
 
     if (!(priority >= AIRTIGHT_PRIORITY_MIN && priority <= AIRTIGHT_PRIORITY_MAX))
     {
         AT_DEBUG("Airtight_Send: packet has invalid priority, discarding.");
-        return;
+        return false;
     }
-    if (criticality != mac_state->queue.criticalities[priority])
+    if (criticality != mac_state->queue->criticalities[priority])
     {
         AT_DEBUG("Airtight_Send: packet has invalid criticality for priority, discarding.");
-        return;
+        return false;
     }
 
-    at_u8_t c_count_limit = packet->data.fields.c_value;
-    if (c_count_limit > AT_CONF_MAX_C_VALUE)
+#if (AT_CONF_BEST_EFFORT == 1)
+    if (mac_state->best_effort.mode)
     {
-        c_count_limit = AT_CONF_MAX_C_VALUE;
+        return true;
     }
-    // If c_count_limit was signed we would perform a sign check, it's not however
+#endif
 
-    AT_DEBUG("Airtight_Send: packet set to send.");
+    if (Airtight_SendCopies(packet) == 0)
+    {
+        AT_DEBUG("Airtight_Send: packet has a C value of 0, discarding.");
+        return false;
+    }
 
 #if (AT_CONF_DISCARD_LOW_WHILE_HIGH == 1)
-    if (mac_state->criticality_mode == HIGH_CRIT && criticality == LOW_CRIT)
+    if (criticality > mac_state->criticality_mode)
     {
-        AT_DEBUG("Airtight_Send: Discarded LOW packet while HIGH.");
+        AT_DEBUG("Airtight_Send: Discarded packet less critical than the mode.");
         // TODO: Count discards
-        return;
+        return false;
+    }
+#endif
+
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+    if (criticality > Airtight_HopMode(mac_state, Airtight_NextHop(packet->data.fields.destination)))
+    {
+        AT_DEBUG("Airtight_Send: Discarded packet routed towards a more critical node.");
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+/**
+ * Check whether count packets like a packet would all be queued by
+ * Airtight_Send now, without evicting any queued packet.
+ */
+at_bool_t Airtight_SendAdmits(Airtight_MACState *mac_state, const Airtight_Packet *packet, size_t count)
+{
+    if (!Airtight_SendAccepts(mac_state, packet))
+    {
+        return false;
+    }
+
+#if (AT_CONF_BEST_EFFORT == 1)
+    if (mac_state->best_effort.mode)
+    {
+        return count <= (size_t)(AT_CONF_BULK_QUEUE_SIZE - Airtight_Bulk_Size(&mac_state->best_effort.queue));
+    }
+#endif
+
+    return count * Airtight_SendCopies(packet) <= Airtight_PCQ_FreeLocalPriority(mac_state->queue, packet->data.fields.priority);
+}
+
+/**
+ * Queue a packet for sending, as its C value's burst copies or, in
+ * best-effort mode, as bulk.
+ *
+ * @return true if the packet was queued, false if it was discarded
+ */
+at_bool_t Airtight_Send(Airtight_MACState *mac_state, Airtight_Packet *packet)
+{
+    AT_ENTER(Airtight_Send);
+
+    if (!Airtight_SendAccepts(mac_state, packet))
+    {
+        return false;
+    }
+
+    AT_DEBUG("Airtight_Send: packet set to send.");
+
+#if (AT_CONF_BEST_EFFORT == 1)
+    if (mac_state->best_effort.mode)
+    {
+        AT_DEBUG("Airtight_Send: best-effort mode, queueing as bulk.");
+        return Airtight_SendBulk(mac_state, packet);
     }
 #endif
 
     AT_LOG_MAC(mac_state, "SEND", *packet);
 
-    at_u8_t base_sequence_number = packet->data.fields.sequence_number;
+    // Burst copies share the sequence number so receivers can drop all but
+    // the first to arrive.
+    packet->meta.forwarded = false;
+
+    const at_u8_t c_count_limit = Airtight_SendCopies(packet);
+    at_bool_t queued = true;
 
     for (at_u8_t c_value = 0; c_value < c_count_limit; c_value++)
     {
-        packet->data.fields.sequence_number = base_sequence_number + c_value;
         packet->meta.burst_number = c_value;
         AT_DEBUGF("Airtight_Send: enqueue c_value = %u", c_value);
 
         packet->meta.inject_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
 
-        Airtight_Enqueue(mac_state, packet);
+        queued = Airtight_Enqueue(mac_state, packet) && queued;
     }
+
+    return queued;
 }
 
-void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet *packet, at_bool_t was_acked)
+/**
+ * Find the queued copy of a sent packet.
+ *
+ * Several packets may be in flight from one slot and their statuses can
+ * arrive in any order, so the copy is matched by identity rather than
+ * assumed to be the head.
+ *
+ * @return a pointer into the PCQ, NULL if the packet is no longer queued
+ */
+static Airtight_Packet *Airtight_FindQueuedPacket(Airtight_MACState *mac_state, const Airtight_Packet *packet, Airtight_QueueIndex *offset_out)
+{
+    const Airtight_Priority priority = packet->data.fields.priority;
+
+    if (mac_state->queue->criticalities[priority] != packet->data.fields.criticality)
+    {
+        return NULL;
+    }
+
+    for (Airtight_QueueIndex offset = 0; offset < Airtight_PCQ_SizePriority(mac_state->queue, priority); offset++)
+    {
+        Airtight_Packet *queued_packet = Airtight_PCQ_PeekPriorityP(mac_state->queue, priority, offset);
+
+        if (Airtight_IsSamePacket(queued_packet, packet))
+        {
+            *offset_out = offset;
+            return queued_packet;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Remove the queued copy of a sent packet, if it is still queued.
+ */
+static void Airtight_DequeueSentPacket(Airtight_MACState *mac_state, const Airtight_Packet *packet)
+{
+    Airtight_QueueIndex offset;
+
+    if (NULL != Airtight_FindQueuedPacket(mac_state, packet, &offset))
+    {
+        Airtight_PCQ_RemovePriority(mac_state->queue, packet->data.fields.priority, offset, NULL);
+    }
+    else
+    {
+        AT_DEBUG("Airtight_DequeueSentPacket: packet no longer queued.");
+    }
+}
+
+/**
+ * Handle the transmit status of a sent packet.
+ *
+ * count_failure is false for all but one packet of an aggregate, as the
+ * frame's single failed ack must only be counted once towards going HIGH.
+ */
+static void Airtight_HandleSendComplete(Airtight_MACState *mac_state, Airtight_Packet *packet, at_bool_t was_acked, at_bool_t count_failure)
 {
-    AT_ENTER(Airtight_RegisterSendComplete);
 
 #ifdef AIRTIGHT_DEBUG
     Airtight_PrintPacket(packet);
@@ -340,8 +1945,15 @@ void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet
 
     AT_DEBUG("Airtight_RegisterSendComplete: Handling send complete of above packet.");
 
+    // The head may be dequeued or have its retransmit count changed.
+    Airtight_InvalidateStaged(mac_state);
+
     const Airtight_Priority priority = packet->data.fields.priority;
-    const Airtight_Priority criticality = packet->data.fields.criticality;
+
+    if (was_acked || count_failure)
+    {
+        Airtight_RegisterHopResult(mac_state, packet->data.fields.hop_destination, was_acked);
+    }
 
     if (was_acked && !mac_state->fault_active)
     {
@@ -354,7 +1966,7 @@ void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet
         {
             AT_DEBUG("Airtight_RegisterSendComplete: Dequeued packet");
             AT_LOG_MAC(mac_state, "DEQUEUE", *packet);
-            Airtight_PCQ_DequeuePriorityCriticality(&mac_state->queue, priority, criticality, NULL);
+            Airtight_DequeueSentPacket(mac_state, packet);
         }
         else
         {
@@ -370,20 +1982,26 @@ void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet
             AT_DEBUG("Airtight_RegisterSendComplete: ack failure due to fault activity.");
         }
 
-        AT_DEBUG("Airtight_RegisterSendComplete: Registering failed ack.");
         AT_LOG_MAC(mac_state, "ACK_FAIL", *packet);
-        Airtight_RegisterFailedAck(mac_state);
-
-        AT_DEBUG("Airtight_RegisterSendComplete: checking to go high...");
-        if (Airtight_CheckShouldGoHigh(mac_state))
+        if (count_failure)
         {
-            AT_DEBUG("Airtight_RegisterSendComplete: going high");
-            Airtight_GoHigh(mac_state);
-        }
+            AT_DEBUG("Airtight_RegisterSendComplete: Registering failed ack.");
+            Airtight_RegisterFailedAck(mac_state);
 
-#if (AT_CONF_CLEAR_HIGH_PACKETS_ON_BEST_EFFORT == 1)
-        // TODO
+            AT_DEBUG("Airtight_RegisterSendComplete: checking to go high...");
+            if (Airtight_CheckShouldGoHigh(mac_state))
+            {
+                AT_DEBUG("Airtight_RegisterSendComplete: going high");
+                Airtight_GoHigh(mac_state);
+            }
+#if (AT_CONF_BEST_EFFORT == 1)
+            else if (Airtight_CheckShouldGoBestEffort(mac_state))
+            {
+                AT_DEBUG("Airtight_RegisterSendComplete: going best-effort");
+                Airtight_GoBestEffort(mac_state);
+            }
 #endif
+        }
 
         AT_DEBUG("Airtight_RegisterSendComplete: checking to dequeue packet...");
         if (Airtight_CheckShouldDequeuePacket(packet))
@@ -392,7 +2010,7 @@ void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet
             if (priority >= AIRTIGHT_PRIORITY_MIN && priority <= AIRTIGHT_PRIORITY_MAX)
             {
                 AT_LOG_MAC(mac_state, "DEQUEUE", *packet);
-                Airtight_PCQ_DequeuePriorityCriticality(&mac_state->queue, priority, criticality, NULL);
+                Airtight_DequeueSentPacket(mac_state, packet);
             }
             else
             {
@@ -404,10 +2022,23 @@ void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet
             AT_DEBUG("Airtight_RegisterSendComplete: not dequeueing packet");
             if (priority >= AIRTIGHT_PRIORITY_MIN && priority <= AIRTIGHT_PRIORITY_MAX)
             {
-                Airtight_Packet *head_packet = Airtight_PCQ_HeadPriorityCriticalityP(&mac_state->queue, priority, criticality);
+                Airtight_QueueIndex offset;
+                Airtight_Packet *queued_packet = Airtight_FindQueuedPacket(mac_state, packet, &offset);
+
+#if (AT_CONF_CUT_THROUGH == 1)
+                // A cut-through packet was never queued, it is queued to retry.
+                if (NULL == queued_packet && packet->meta.cut_through)
+                {
+                    Airtight_Packet retry;
+                    memcpy(&retry, packet, sizeof(Airtight_Packet));
+                    retry.meta.cut_through = false;
+                    Airtight_Enqueue(mac_state, &retry);
+                    queued_packet = Airtight_FindQueuedPacket(mac_state, &retry, &offset);
+                }
+#endif
 
-                if (NULL != head_packet)
-                    head_packet->meta.local_retransmit_count++;
+                if (NULL != queued_packet)
+                    queued_packet->meta.local_retransmit_count++;
             }
             else
             {
@@ -417,6 +2048,37 @@ void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet
     }
 }
 
+void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet *packet, at_bool_t was_acked)
+{
+    AT_ENTER(Airtight_RegisterSendComplete);
+#if (AT_CONF_BEST_EFFORT == 1)
+    if (packet->meta.bulk)
+    {
+        Airtight_RegisterBulkSendComplete(mac_state, packet, was_acked);
+        return;
+    }
+#endif
+    Airtight_HandleSendComplete(mac_state, packet, was_acked, true);
+}
+
+#if (AT_CONF_AGGREGATION == 1)
+/**
+ * Handle the transmit status of an aggregate frame.
+ *
+ * Every packet is dequeued or retried as if sent alone, but a failed ack
+ * counts once for the frame.
+ */
+void Airtight_RegisterAggregateSendComplete(Airtight_MACState *mac_state, Airtight_Aggregate *aggregate, at_bool_t was_acked)
+{
+    AT_ENTER(Airtight_RegisterAggregateSendComplete);
+
+    for (at_u8_t i = 0; i < aggregate->count; i++)
+    {
+        Airtight_HandleSendComplete(mac_state, &aggregate->packets[i], was_acked, i == 0);
+    }
+}
+#endif
+
 void Airtight_HandleReceive(Airtight_MACState *mac_state, Airtight_Packet *packet)
 {
     AT_ENTER(Airtight_HandleReceive);
@@ -427,10 +2089,19 @@ void Airtight_HandleReceive(Airtight_MACState *mac_state, Airtight_Packet *packe
 
     AT_DEBUGF("Airtight_HandleReceive: received packet destination %x.\n", received_destination);
 
-    if (!Airtight_SlotShouldReceive(mac_state->current_slot))
+    const Airtight_Criticality schedule_mode = Airtight_ScheduleModeAt(mac_state, mac_state->local_slot);
+
+    if (!Airtight_SlotShouldReceive(schedule_mode, mac_state->local_slot, mac_state->current_slot))
     {
         AT_DEBUG("Airtight_HandleReceive: packet should not have been received in this slot.");
     }
+    else if (!Airtight_SlotTransmitter(schedule_mode, mac_state->local_slot, mac_state->current_slot, packet->data.fields.hop_source))
+    {
+        // Rows may have several transmitters, so this is a neighbour the
+        // table wrongly lets this node hear, or a node out of sync.
+        AT_DEBUG("Airtight_HandleReceive: hop source is not scheduled to transmit in this slot.");
+        mac_state->unexpected_transmitters++;
+    }
 
     if (received_destination != AT_CONF_NODE_ID)
     {
@@ -440,16 +2111,54 @@ void Airtight_HandleReceive(Airtight_MACState *mac_state, Airtight_Packet *packe
         {
             AT_DEBUG("Airtight_HandleReceive: fault active, dropping forward packet.");
         }
+#if (AT_CONF_DEDUP == 1 && AT_CONF_DEDUP_AT_FORWARDERS == 1)
+        else if (!Airtight_Dedup_Check(&mac_state->dedup, packet))
+        {
+            AT_DEBUG("Airtight_HandleReceive: duplicate, dropping forward packet.");
+        }
+#endif
         else
         {
             packet->meta.inject_time = Airtight_Time_GetSynchronisedTime(&mac_state->time);
+            packet->meta.forwarded = true;
+            packet->meta.cut_through = false;
+
+#if (AT_CONF_BEST_EFFORT == 1)
+            // Bulk packets never enter the PCQ, even when a node in
+            // best-effort mode sent them in its transmit slot.
+            if (packet->data.fields.flow_id & AIRTIGHT_BULK_FLOW_FLAG)
+            {
+                AT_DEBUG("Airtight_HandleReceive: queueing bulk packet to forward.");
+                Airtight_SendBulk(mac_state, packet);
+                return;
+            }
+#endif
+
+#if (AT_CONF_CUT_THROUGH == 1)
+            if (Airtight_TryCutThrough(mac_state, packet))
+            {
+                AT_DEBUG("Airtight_HandleReceive: staged forward packet for the next slot.");
+                return;
+            }
+#endif
+
             Airtight_Enqueue(mac_state, packet);
         }
     }
+#if (AT_CONF_DEDUP == 1)
+    else if (!Airtight_Dedup_Check(&mac_state->dedup, packet))
+    {
+        AT_DEBUG("Airtight_HandleReceive: duplicate, dropping packet.");
+    }
+#endif
     else
     {
         AT_DEBUG("Airtight_HandleReceive: passing packet to application layer.");
 
+#if (AT_CONF_BEST_EFFORT == 1)
+        packet->data.fields.flow_id &= (at_u8_t)~AIRTIGHT_BULK_FLOW_FLAG;
+#endif
+
         Airtight_RecordSuccessfullyReceivedPacket(mac_state, packet);
 
         if (NULL != mac_state->receive_callback)
@@ -462,7 +2171,7 @@ void Airtight_HandleReceive(Airtight_MACState *mac_state, Airtight_Packet *packe
 /**
  * Synchronise protocol state based on sync slot and time.
  */
-void Airtight_SynchroniseNow(Airtight_MACState *mac_state, at_u8_t sync_slot, at_time_t sync_time)
+void Airtight_SynchroniseNow(Airtight_MACState *mac_state, at_u16_t sync_slot, at_time_t sync_time)
 {
     AT_ENTER(Airtight_SynchroniseNow);
 
@@ -471,6 +2180,9 @@ void Airtight_SynchroniseNow(Airtight_MACState *mac_state, at_u8_t sync_slot, at
     mac_state->current_slot += slot_difference;
     mac_state->previous_slot += slot_difference;
     Airtight_Time_SetSynchronisationPoint(&mac_state->time, sync_time + AT_CONF_SYNC_TIME_OFFSET);
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+    mac_state->synchronised = true;
+#endif
 
     // More complex synchronisation may be performed here in later revisions.
 }
@@ -499,4 +2211,27 @@ void Airtight_HandleNotificationReceive(Airtight_MACState *mac_state, Airtight_N
         Airtight_SynchroniseNow(mac_state, notification->fields.sync_slot, notification->fields.sync_time);
 #endif
     }
+#if (AT_CONF_MODE_SCHEDULES == 1)
+    else if (notification->fields.fault_activity == FAULT_MODE_SWITCH && notification->fields.sync_time <= LOW_CRIT)
+    {
+        AT_DEBUG("Airtight_HandleNotificationReceive: received slot table switch");
+
+        // Each node passes a switch it has not heard of on once.
+        Airtight_HearModeSwitch(mac_state, (Airtight_Criticality)notification->fields.sync_time, notification->fields.sync_slot);
+    }
+#endif
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+    else if (notification->fields.fault_activity == FAULT_CRITICALITY)
+    {
+        AT_DEBUG("Airtight_HandleNotificationReceive: received criticality change");
+        Airtight_HandleCriticalityNotice(mac_state, notification);
+    }
+#endif
+#if (AT_CONF_SLOT_LENDING == 1)
+    else if (notification->fields.fault_activity == FAULT_SLOT_FREE)
+    {
+        AT_DEBUG("Airtight_HandleNotificationReceive: received free slot");
+        Airtight_HandleSlotFree(mac_state, notification);
+    }
+#endif
 }
@@ -14,11 +14,141 @@
 #include "airtight_radio.h"
 #include "airtight_time.h"
 #include "airtight_priority_critical_queue.h"
+#include "airtight_pcq_persist.h"
 #include "airtight_logging.h"
+#include "airtight_aggregate.h"
+#include "airtight_codec.h"
+#include "airtight_dedup.h"
+#include "airtight_bulk.h"
+
+#if (AT_CONF_CUT_THROUGH == 1 && AT_CONF_STAGED_TRANSMIT != 1)
+#error Cut-through relaying stages frames so needs AT_CONF_STAGED_TRANSMIT.
+#endif
 
 typedef void (*Airtight_ReceiveCallback)(Airtight_Packet *packet);
 typedef void (*Airtight_TransmitHandler)(Airtight_Packet *packet);
 typedef void (*Airtight_NotificationHandler)(Airtight_Notification *notification);
+typedef void (*Airtight_AggregateTransmitHandler)(Airtight_Aggregate *aggregate);
+typedef void (*Airtight_ChannelHandler)(at_u8_t channel);
+
+/**
+ * The most packets a transmit slot may carry.
+ */
+#if (AT_CONF_AGGREGATION == 1)
+#define AIRTIGHT_SLOT_MAX_PACKETS (AT_CONF_MAX_TRANSMITS_PER_SLOT * AIRTIGHT_AGGREGATE_MAX_PACKETS)
+#else
+#define AIRTIGHT_SLOT_MAX_PACKETS AT_CONF_MAX_TRANSMITS_PER_SLOT
+#endif
+
+/**
+ * A frame built ahead of this node's next transmit slot.
+ */
+typedef struct
+{
+    Airtight_Packet packet;
+    Airtight_Packet *source;
+    at_u16_t local_slot;
+    at_bool_t valid;
+    // The packet was received and staged without being queued
+    at_bool_t cut_through;
+#if (AT_CONF_CUT_THROUGH == 1)
+    // The received packet as it was before preparing, queued if the frame is dropped
+    Airtight_Packet original;
+#endif
+} Airtight_StagedTransmit;
+
+/**
+ * Position of the next packet to consider for a transmit slot.
+ */
+typedef struct
+{
+    Airtight_Priority priority;
+    Airtight_QueueIndex offset;
+    // Also visit packets for backed off next hops
+    at_bool_t all_hops;
+} Airtight_TransmitCursor;
+
+/**
+ * Recent ack results of a next hop.
+ *
+ * Once failures reaches the failure threshold the hop is skipped until
+ * local_slot reaches retry_slot, when retry_due is set and one more attempt
+ * is allowed. retry_due stays set however long the hop then stays idle.
+ */
+typedef struct
+{
+    at_u8_t failures;
+    at_u16_t retry_slot;
+    at_bool_t retry_due;
+} Airtight_HopHealth;
+
+/**
+ * A switch of slot table announced for a common future slot.
+ */
+typedef struct
+{
+    at_bool_t pending;
+    // The switch is still to be announced in this node's next transmit slot
+    at_bool_t announce;
+    Airtight_Criticality mode;
+    at_u16_t slot;
+} Airtight_ModeSwitch;
+
+/**
+ * Criticality change notices a node can hold for its next transmit slot.
+ */
+#define AIRTIGHT_CRITICALITY_RELAYS 4
+
+/**
+ * The last criticality announcement heard from a node.
+ */
+typedef struct
+{
+    at_u16_t epoch;
+    at_bool_t known;
+    Airtight_Criticality mode;
+    // This node's next hop towards the origin, less critical packets for it are shed
+    Airtight_NodeId via;
+    at_u16_t expiry_slot;
+} Airtight_CriticalityOrigin;
+
+/**
+ * This node's criticality announcements and those it has heard.
+ */
+typedef struct
+{
+    at_u16_t epoch;
+    Airtight_Criticality announced_mode;
+    at_u16_t announce_slot;
+    // When the mode last became less critical
+    at_u16_t relax_slot;
+    // The HIGH slot table is to be left once the mode has held since relax_slot
+    at_bool_t release_table;
+    Airtight_CriticalityOrigin origins[AT_CONF_CRITICALITY_TABLE_SIZE];
+    Airtight_Notification relays[AIRTIGHT_CRITICALITY_RELAYS];
+    at_u8_t relay_count;
+} Airtight_CriticalityPropagation;
+
+/**
+ * Best-effort contention state.
+ *
+ * backoff is the sub-slots of best-effort slots left to wait before the
+ * head of the bulk queue is sent, drawn below window.
+ */
+typedef struct
+{
+    Airtight_BulkQueue queue;
+    // Whether in best-effort mode
+    at_bool_t mode;
+    // Whether the current slot is a best-effort slot and its sub-slot
+    at_bool_t slot_active;
+    at_u8_t subslot;
+    at_bool_t in_flight;
+    at_u8_t backoff;
+    at_u8_t window;
+    at_u8_t retries;
+    at_u16_t random;
+} Airtight_BestEffort;
 
 /**
  * Full MAC State store.
@@ -37,29 +167,112 @@ typedef struct
 
     at_u8_t acknowledge_fails;
 
-    Airtight_PriorityCriticalQueue queue;
+    // Packets received from a node not scheduled to transmit in the slot
+    at_u16_t unexpected_transmitters;
+
+    // Smoothed airtime of a frame in microseconds, sets the per-slot budget
+    at_u32_t airtime_us;
+
+    // The PCQ in use, local_queue unless replaced with Airtight_SetQueue
+    Airtight_PriorityCriticalQueue *queue;
+    Airtight_PriorityCriticalQueue local_queue;
 
     Airtight_History send_history;
     Airtight_History receive_history;
 
+#if (AT_CONF_DEDUP == 1)
+    Airtight_DedupTable dedup;
+#endif
+
     Airtight_Time time;
     Airtight_Alarm fault_alarm;
 
     Airtight_ReceiveCallback receive_callback;
     Airtight_TransmitHandler transmit_handler;
     Airtight_NotificationHandler notification_handler;
+    Airtight_TransmitHandler stage_handler;
+    Airtight_TransmitHandler staged_transmit_handler;
+    Airtight_StagedTransmit staged;
+#if (AT_CONF_AGGREGATION == 1)
+    Airtight_AggregateTransmitHandler aggregate_transmit_handler;
+#endif
+#if (AT_CONF_CUT_THROUGH == 1)
+    at_bool_t cut_through_enabled;
+#endif
+#if (AT_CONF_MODE_SCHEDULES == 1)
+    // The slot table in use
+    Airtight_Criticality schedule_mode;
+    Airtight_ModeSwitch mode_switch;
+#endif
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+    Airtight_CriticalityPropagation propagation;
+#endif
+#if (AT_CONF_HOP_BACKOFF == 1)
+    at_u8_t hop_failure_threshold;
+    Airtight_HopHealth hop_health[AT_CONF_HOP_TABLE_SIZE];
+#endif
+#if (AT_CONF_SLOT_LENDING == 1)
+    // Whether the current slot was lent to this node and used
+    at_bool_t slot_borrowed;
+#endif
+#if (AT_CONF_BEST_EFFORT == 1)
+    Airtight_BestEffort best_effort;
+#endif
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+    Airtight_ChannelHandler queue_channel_handler;
+    Airtight_ChannelHandler apply_channel_handler;
+    // Whether a sync has been heard, until then the node stays on the sync channel
+    at_bool_t synchronised;
+#endif
     Airtight_Radio *radio;
 } Airtight_MACState;
 
 void Airtight_InitialiseMACState(Airtight_MACState *mac_state);
 void Airtight_SetReceiveCallback(Airtight_MACState *mac_state, Airtight_ReceiveCallback callback);
-void Airtight_Send(Airtight_MACState *mac_state, Airtight_Packet *packet);
+at_bool_t Airtight_Send(Airtight_MACState *mac_state, Airtight_Packet *packet);
+at_bool_t Airtight_SendAdmits(Airtight_MACState *mac_state, const Airtight_Packet *packet, size_t count);
+at_bool_t Airtight_Enqueue(Airtight_MACState *mac_state, Airtight_Packet *packet);
 void Airtight_DoSlot(Airtight_MACState *mac_state, at_u8_t slot);
+Airtight_Packet *Airtight_PeekTransmitPacket(Airtight_MACState *mac_state);
+void Airtight_PrepareTransmitPacket(Airtight_MACState *mac_state, Airtight_Packet *forward_packet, const Airtight_Packet *queued_packet, at_u16_t hop_send_slot);
+at_u8_t Airtight_SlotsUntilTransmit(Airtight_MACState *mac_state);
+Airtight_Packet *Airtight_NextTransmitPacket(Airtight_MACState *mac_state, Airtight_TransmitCursor *cursor);
+void Airtight_RegisterAirtime(Airtight_MACState *mac_state, at_u32_t airtime_us);
+at_u8_t Airtight_TransmitBudget(Airtight_MACState *mac_state);
+#if (AT_CONF_STAGED_TRANSMIT == 1)
+void Airtight_StageTransmit(Airtight_MACState *mac_state);
+#endif
 void Airtight_RegisterSendComplete(Airtight_MACState *mac_state, Airtight_Packet *packet, at_bool_t was_acked);
+#if (AT_CONF_AGGREGATION == 1)
+void Airtight_RegisterAggregateSendComplete(Airtight_MACState *mac_state, Airtight_Aggregate *aggregate, at_bool_t was_acked);
+void Airtight_SetAggregateTransmitHandler(Airtight_MACState *mac_state, Airtight_AggregateTransmitHandler handler);
+#endif
 void Airtight_SetTransmitHandler(Airtight_MACState *mac_state, Airtight_TransmitHandler handler);
 void Airtight_ClearFault(Airtight_MACState *mac_state);
 void Airtight_HandleReceive(Airtight_MACState *mac_state, Airtight_Packet *packet);
 void Airtight_HandleNotificationReceive(Airtight_MACState *mac_state, Airtight_Notification *notification);
 void Airtight_SetNotificationHandler(Airtight_MACState *mac_state, Airtight_NotificationHandler handler);
+void Airtight_SetStagingHandlers(Airtight_MACState *mac_state, Airtight_TransmitHandler stage_handler, Airtight_TransmitHandler staged_transmit_handler);
+void Airtight_SetQueue(Airtight_MACState *mac_state, Airtight_PriorityCriticalQueue *queue);
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+void Airtight_SetChannelHandlers(Airtight_MACState *mac_state, Airtight_ChannelHandler queue_handler, Airtight_ChannelHandler apply_handler);
+#endif
+#if (AT_CONF_CUT_THROUGH == 1)
+void Airtight_SetCutThrough(Airtight_MACState *mac_state, at_bool_t enabled);
+#endif
+#if (AT_CONF_MODE_SCHEDULES == 1)
+void Airtight_RequestModeSwitch(Airtight_MACState *mac_state, Airtight_Criticality mode);
+#endif
+#if (AT_CONF_CRITICALITY_PROPAGATION == 1)
+Airtight_Criticality Airtight_HopMode(Airtight_MACState *mac_state, Airtight_NodeId hop);
+#endif
+#if (AT_CONF_HOP_BACKOFF == 1)
+void Airtight_SetHopFailureThreshold(Airtight_MACState *mac_state, at_u8_t threshold);
+at_bool_t Airtight_HopEligible(Airtight_MACState *mac_state, Airtight_NodeId hop);
+#endif
+#if (AT_CONF_BEST_EFFORT == 1)
+at_bool_t Airtight_SendBulk(Airtight_MACState *mac_state, Airtight_Packet *packet);
+void Airtight_DoSubSlot(Airtight_MACState *mac_state, at_u8_t subslot);
+#endif
 
 #endif
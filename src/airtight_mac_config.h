@@ -7,6 +7,8 @@
 #ifndef __AIRTIGHT_MAC_CONFIG_H
 #define __AIRTIGHT_MAC_CONFIG_H
 
+#include "airtight_types.h"
+
 /**
  * Node ID of this node.
  */
@@ -34,23 +36,75 @@
  * Whether to remove all high criticality packets from the PCQ on entering
  * best-effort mode.
  *
- * @note Best-effort mode is not currently implemented.
+ * @note Best-effort mode needs AT_CONF_BEST_EFFORT.
  */
 #define AT_CONF_CLEAR_HIGH_PACKETS_ON_BEST_EFFORT 1
 
 /**
- * Whether to discard newly enqueued LOW criticality packets while in HIGH
- * mode.
+ * Whether to discard newly enqueued packets less critical than the current
+ * mode, e.g. LOW criticality packets while in HIGH mode.
  */
 #define AT_CONF_DISCARD_LOW_WHILE_HIGH 1
 
 /**
  * Whether to remove all packets from the PCQ on entering best-effort mode.
  *
- * @note Best-effort mode is not currently implemented.
+ * @note Best-effort mode needs AT_CONF_BEST_EFFORT.
  */
 #define AT_CONF_CLEAR_PACKETS_ON_BEST_EFFORT 1
 
+/**
+ * Whether best-effort service is used. Slots marked BEST_EFFORT in the slot
+ * table are shared by contention for bulk packets, queued apart from the
+ * PCQ with Airtight_SendBulk. A node whose acks keep failing in HIGH mode
+ * enters best-effort mode and sends all its traffic as bulk until an ack
+ * succeeds.
+ */
+#ifndef AT_CONF_BEST_EFFORT
+#define AT_CONF_BEST_EFFORT 0
+#endif
+
+/**
+ * Contention sub-slots each best-effort slot is divided into.
+ */
+#ifndef AT_CONF_BEST_EFFORT_SUBSLOTS
+#define AT_CONF_BEST_EFFORT_SUBSLOTS 4
+#endif
+
+/**
+ * Smallest and largest contention window in sub-slots. A node waits a
+ * random number of sub-slots below its window before sending, and the
+ * window doubles with each failed send.
+ */
+#ifndef AT_CONF_BEST_EFFORT_WINDOW_MIN
+#define AT_CONF_BEST_EFFORT_WINDOW_MIN 2
+#endif
+#ifndef AT_CONF_BEST_EFFORT_WINDOW_MAX
+#define AT_CONF_BEST_EFFORT_WINDOW_MAX 32
+#endif
+
+/**
+ * The number of times a bulk packet can re-attempt transmission.
+ */
+#ifndef AT_CONF_BEST_EFFORT_RETRIES
+#define AT_CONF_BEST_EFFORT_RETRIES 3
+#endif
+
+/**
+ * Failed acks in HIGH criticality mode before entering best-effort mode, at
+ * most AT_CONF_MAX_NODE_ACK_FAILS.
+ */
+#ifndef AT_CONF_BEST_EFFORT_THRESHOLD
+#define AT_CONF_BEST_EFFORT_THRESHOLD AT_CONF_MAX_NODE_ACK_FAILS
+#endif
+
+/**
+ * The number of bulk packets queued, further packets are dropped.
+ */
+#ifndef AT_CONF_BULK_QUEUE_SIZE
+#define AT_CONF_BULK_QUEUE_SIZE 8
+#endif
+
 /**
  * The number of times a LOW criticality packet can re-attempt transmission.
  */
@@ -86,6 +140,94 @@
  */
 #define AT_CONF_CRITICALITY_CHANGE_THRESHOLD 2
 
+/**
+ * The number of times a packet of each criticality level, most critical
+ * first, can re-attempt transmission. Must be given when there are more than
+ * two levels.
+ */
+#ifndef AT_CONF_RETRANSMISSION_LIMITS
+#if (AIRTIGHT_CRITICALITY_LEVELS == 2)
+#define AT_CONF_RETRANSMISSION_LIMITS \
+    {                                 \
+        AT_CONF_RETRANSMISSION_LIMIT_HIGH, AT_CONF_RETRANSMISSION_LIMIT_LOW \
+    }
+#else
+#error AT_CONF_RETRANSMISSION_LIMITS must give a limit for each criticality level.
+#endif
+#endif
+
+/**
+ * The failed acks in each criticality mode, most critical first, before a
+ * node moves to the next more critical mode. The most critical mode's entry
+ * is unused. Must be given when there are more than two levels.
+ */
+#ifndef AT_CONF_CRITICALITY_CHANGE_THRESHOLDS
+#if (AIRTIGHT_CRITICALITY_LEVELS == 2)
+#define AT_CONF_CRITICALITY_CHANGE_THRESHOLDS \
+    {                                         \
+        0, AT_CONF_CRITICALITY_CHANGE_THRESHOLD \
+    }
+#else
+#error AT_CONF_CRITICALITY_CHANGE_THRESHOLDS must give a threshold for each criticality level.
+#endif
+#endif
+
+/**
+ * The criticality levels whose packets are removed from the PCQ when the
+ * mode becomes more critical than them, as an Airtight_CriticalityMask.
+ */
+#ifndef AT_CONF_CRITICALITY_CLEAR_MASK
+#define AT_CONF_CRITICALITY_CLEAR_MASK (AT_CONF_CLEAR_LOW_PACKETS_ON_HIGH == 1 ? AIRTIGHT_CRITICALITY_ALL : 0)
+#endif
+
+/**
+ * Slot table cycles from announcing a schedule switch to it taking effect,
+ * leaving time for the announcement to cross the network.
+ */
+#ifndef AT_CONF_MODE_SWITCH_LEAD_CYCLES
+#define AT_CONF_MODE_SWITCH_LEAD_CYCLES 4
+#endif
+
+/**
+ * Whether nodes announce their criticality mode changes to their neighbours,
+ * which then shed LOW packets at the source rather than route them towards a
+ * node in HIGH mode.
+ */
+#ifndef AT_CONF_CRITICALITY_PROPAGATION
+#define AT_CONF_CRITICALITY_PROPAGATION 1
+#endif
+
+/**
+ * Hops a criticality change notice travels from the node which changed mode.
+ */
+#ifndef AT_CONF_CRITICALITY_PROPAGATION_HOPS
+#define AT_CONF_CRITICALITY_PROPAGATION_HOPS 2
+#endif
+
+/**
+ * Slots a node stays in a less critical mode before announcing it, so a node
+ * flapping between modes is not announced on every change. A node in a mode
+ * other than LOW also repeats its announcement this often.
+ */
+#ifndef AT_CONF_CRITICALITY_HOLD_SLOTS
+#define AT_CONF_CRITICALITY_HOLD_SLOTS 16
+#endif
+
+/**
+ * Slots an announcement of a mode other than LOW is trusted for without being
+ * repeated, bounding how long a lost announcement keeps traffic shed.
+ */
+#ifndef AT_CONF_CRITICALITY_LEASE_SLOTS
+#define AT_CONF_CRITICALITY_LEASE_SLOTS (3 * AT_CONF_CRITICALITY_HOLD_SLOTS)
+#endif
+
+/**
+ * Node IDs below this have their announcements tracked.
+ */
+#ifndef AT_CONF_CRITICALITY_TABLE_SIZE
+#define AT_CONF_CRITICALITY_TABLE_SIZE 16
+#endif
+
 /**
  * The ID of the node responsible for synchronisation.
  */
@@ -126,11 +268,331 @@
 #define AT_CONF_ZERO_PACKET_DATA 1
 
 /**
- * The criticalities of each priority queue in the PCQ.
+ * The criticalities of each priority queue in the PCQ. With more than two
+ * criticality levels the levels between HIGH_CRIT and LOW_CRIT are given by
+ * number.
  */
+#ifndef AT_CONF_CRITICALITIES
 #define AT_CONF_CRITICALITIES         \
     {                                 \
         LOW_CRIT, LOW_CRIT, HIGH_CRIT \
     }
+#endif
+
+/**
+ * The most packets sent back to back in one transmit slot, 1 sends a single
+ * packet per slot.
+ */
+#ifndef AT_CONF_MAX_TRANSMITS_PER_SLOT
+#define AT_CONF_MAX_TRANSMITS_PER_SLOT 4
+#endif
+
+/**
+ * Whether packets sharing a hop destination may be sent together in one
+ * radio frame when the integration sets an aggregate transmit handler.
+ *
+ * @see Airtight_SetAggregateTransmitHandler
+ */
+#ifndef AT_CONF_AGGREGATION
+#define AT_CONF_AGGREGATION 1
+#endif
+
+/**
+ * Whether packets are sent in the compact encoding, which bit-packs the
+ * header, omits fields known from addressing and sends only used data.
+ * Both encodings are always accepted on receive.
+ *
+ * @see airtight_codec.c
+ */
+#ifndef AT_CONF_COMPACT_ENCODING
+#define AT_CONF_COMPACT_ENCODING 1
+#endif
+
+/**
+ * The largest radio frame payload in bytes, bounding aggregate frames. 100
+ * bytes for unencrypted 802.15.4 XBee modules.
+ */
+#ifndef AT_CONF_AGGREGATE_MAX_PAYLOAD
+#define AT_CONF_AGGREGATE_MAX_PAYLOAD 100
+#endif
+
+/**
+ * Time in microseconds left unused at the end of a transmit slot so the last
+ * frame is on air before the next slot starts.
+ */
+#ifndef AT_CONF_SLOT_GUARD_US
+#define AT_CONF_SLOT_GUARD_US 20000
+#endif
+
+/**
+ * Airtime of a frame in microseconds assumed until one has been measured,
+ * including the serial transfer and acknowledgement.
+ */
+#ifndef AT_CONF_INITIAL_AIRTIME_US
+#define AT_CONF_INITIAL_AIRTIME_US 10000
+#endif
+
+/**
+ * The largest message in bytes which may be sent with Airtight_Fragment_Send.
+ */
+#ifndef AT_CONF_FRAGMENT_MAX_MESSAGE
+#define AT_CONF_FRAGMENT_MAX_MESSAGE 128
+#endif
+
+/**
+ * The number of messages which may be reassembled, or held by the
+ * application after delivery, at once.
+ */
+#ifndef AT_CONF_FRAGMENT_POOL_SIZE
+#define AT_CONF_FRAGMENT_POOL_SIZE 4
+#endif
+
+/**
+ * Time in milliseconds without a new fragment after which an incomplete
+ * message is evicted.
+ */
+#ifndef AT_CONF_FRAGMENT_TIMEOUT_MS
+#define AT_CONF_FRAGMENT_TIMEOUT_MS 5000
+#endif
+
+/**
+ * Whether flows listed with LATEST_VALUE in airtight_flows_config.txt keep
+ * only their newest packet queued.
+ */
+#ifndef AT_CONF_LATEST_VALUE
+#define AT_CONF_LATEST_VALUE 1
+#endif
+
+/**
+ * The number of entries per priority in the index of queued latest-value
+ * packets. Each (source, flow, burst copy) in use needs one, and collisions
+ * fall back to queueing normally.
+ */
+#ifndef AT_CONF_LATEST_VALUE_INDEX
+#define AT_CONF_LATEST_VALUE_INDEX 16
+#endif
+
+/**
+ * Whether packets of flows given a DEADLINE in airtight_flows_config.txt are
+ * ordered earliest deadline first within their priority, and dropped once
+ * the deadline has passed.
+ */
+#ifndef AT_CONF_EDF
+#define AT_CONF_EDF 1
+#endif
+
+/**
+ * Whether a packet to forward which is received just before this node's
+ * transmit slot, with nothing queued ahead of it, is staged as the outgoing
+ * frame directly rather than queued. Needs AT_CONF_STAGED_TRANSMIT.
+ */
+#ifndef AT_CONF_CUT_THROUGH
+#define AT_CONF_CUT_THROUGH 1
+#endif
+
+/**
+ * Whether next hops with consecutive failed acks are backed off, so packets
+ * for other next hops are sent ahead of them.
+ */
+#ifndef AT_CONF_HOP_BACKOFF
+#define AT_CONF_HOP_BACKOFF 1
+#endif
+
+/**
+ * The number of next hops tracked, by node ID. Hops with higher IDs are
+ * never backed off.
+ */
+#ifndef AT_CONF_HOP_TABLE_SIZE
+#define AT_CONF_HOP_TABLE_SIZE 16
+#endif
+
+/**
+ * Consecutive failed acks after which a next hop is backed off, 0 disables
+ * back off. May be changed at runtime with Airtight_SetHopFailureThreshold.
+ */
+#ifndef AT_CONF_HOP_FAILURE_THRESHOLD
+#define AT_CONF_HOP_FAILURE_THRESHOLD 2
+#endif
+
+/**
+ * Slots a next hop is first backed off for, doubled with each further
+ * failure up to AT_CONF_HOP_BACKOFF_MAX_SLOTS.
+ */
+#ifndef AT_CONF_HOP_BACKOFF_SLOTS
+#define AT_CONF_HOP_BACKOFF_SLOTS 16
+#endif
+
+/**
+ * The longest a next hop is backed off for in slots.
+ */
+#ifndef AT_CONF_HOP_BACKOFF_MAX_SLOTS
+#define AT_CONF_HOP_BACKOFF_MAX_SLOTS 256
+#endif
+
+/**
+ * Whether each priority's queue reserves entries for packets being
+ * forwarded, so local traffic cannot starve or evict multi-hop flows.
+ */
+#ifndef AT_CONF_FORWARD_QUOTAS
+#define AT_CONF_FORWARD_QUOTAS 1
+#endif
+
+/**
+ * The entries of each priority's queue reserved for forwarded packets. Local
+ * packets may hold at most the rest.
+ */
+#ifndef AT_CONF_FORWARD_RESERVED
+#define AT_CONF_FORWARD_RESERVED \
+    {                            \
+        3, 3, 3                  \
+    }
+#endif
+
+/**
+ * Whether duplicate packets, such as burst copies, are dropped on receive.
+ */
+#ifndef AT_CONF_DEDUP
+#define AT_CONF_DEDUP 1
+#endif
+
+/**
+ * Whether forwarding nodes also drop duplicates rather than relaying every
+ * copy they receive.
+ */
+#ifndef AT_CONF_DEDUP_AT_FORWARDERS
+#define AT_CONF_DEDUP_AT_FORWARDERS 1
+#endif
+
+/**
+ * The number of (source, flow) pairs tracked for duplicate suppression.
+ */
+#ifndef AT_CONF_DEDUP_FLOWS
+#define AT_CONF_DEDUP_FLOWS 16
+#endif
+
+/**
+ * Whether frames are built ahead of this node's transmit slot, during idle
+ * and listen slots, so the slot only re-validates and writes them.
+ *
+ * @see Airtight_SetStagingHandlers
+ */
+#ifndef AT_CONF_STAGED_TRANSMIT
+#define AT_CONF_STAGED_TRANSMIT 1
+#endif
+
+/**
+ * Whether the PCQ should be placed in a memory-mapped file so that queued
+ * packets survive a crash of the process.
+ *
+ * @see Airtight_PCQ_Persist_Open
+ */
+#ifndef AT_CONF_PCQ_PERSISTENT
+#define AT_CONF_PCQ_PERSISTENT 0
+#endif
+
+/**
+ * The file backing the PCQ when AT_CONF_PCQ_PERSISTENT is enabled.
+ */
+#ifndef AT_CONF_PCQ_PERSIST_PATH
+#define AT_CONF_PCQ_PERSIST_PATH "airtight_pcq.bin"
+#endif
+
+/**
+ * Whether the slotter runs in real-time mode.
+ *
+ * Disables debug output by default and defers logging to a ring buffer so
+ * slot processing never allocates or blocks on stdio.
+ *
+ * @see Airtight_Realtime_Enter
+ */
+#ifndef AT_CONF_REALTIME
+#define AT_CONF_REALTIME 0
+#endif
+
+/**
+ * The SCHED_FIFO priority of the slotter in real-time mode.
+ */
+#ifndef AT_CONF_REALTIME_PRIORITY
+#define AT_CONF_REALTIME_PRIORITY 80
+#endif
+
+/**
+ * The CPU the slotter is pinned to in real-time mode, -1 to not pin.
+ */
+#ifndef AT_CONF_REALTIME_CPU
+#define AT_CONF_REALTIME_CPU -1
+#endif
+
+/**
+ * The number of bytes of stack pre-faulted on entering real-time mode.
+ */
+#ifndef AT_CONF_REALTIME_STACK_PREFAULT
+#define AT_CONF_REALTIME_STACK_PREFAULT (64 * 1024)
+#endif
+
+/**
+ * The number of bytes of heap pre-faulted on entering real-time mode.
+ */
+#ifndef AT_CONF_REALTIME_HEAP_PREFAULT
+#define AT_CONF_REALTIME_HEAP_PREFAULT (256 * 1024)
+#endif
+
+/**
+ * Whether debug output is enabled.
+ */
+#ifndef AT_CONF_DEBUG
+#if (AT_CONF_REALTIME == 1)
+#define AT_CONF_DEBUG 0
+#else
+#define AT_CONF_DEBUG 1
+#endif
+#endif
+
+/**
+ * Whether data logging is enabled.
+ */
+#ifndef AT_CONF_LOGGING
+#define AT_CONF_LOGGING 1
+#endif
+
+/**
+ * Whether log entries are stored in a ring buffer and printed later by
+ * Airtight_Log_Flush rather than printed as they occur.
+ */
+#ifndef AT_CONF_LOG_DEFERRED
+#define AT_CONF_LOG_DEFERRED AT_CONF_REALTIME
+#endif
+
+/**
+ * The number of entries in the deferred log ring, must be a power of two.
+ */
+#ifndef AT_CONF_LOG_RING_SIZE
+#define AT_CONF_LOG_RING_SIZE 64
+#endif
+
+/**
+ * Period in milliseconds of the example integration's drain thread, which
+ * prints deferred log entries and processes profiler events away from the
+ * slotter.
+ */
+#ifndef AT_CONF_DRAIN_INTERVAL_MS
+#define AT_CONF_DRAIN_INTERVAL_MS 10
+#endif
+
+/**
+ * Whether slot timeline profiling is enabled.
+ *
+ * @see Airtight_Profiler_Process
+ */
+#ifndef AT_CONF_PROFILER
+#define AT_CONF_PROFILER 0
+#endif
+
+/**
+ * The number of entries in the profiler event ring, must be a power of two.
+ */
+#ifndef AT_CONF_PROFILER_RING_SIZE
+#define AT_CONF_PROFILER_RING_SIZE 1024
+#endif
 
 #endif
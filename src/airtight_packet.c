@@ -10,7 +10,7 @@
  * Initialise a Airtight_InitialisePacket.
  *
  * All values set to zero including priority, except criticality which is set
- * to LOW.
+ * to LOW and the data length which is set to the full data size.
  */
 void Airtight_InitialisePacket(Airtight_Packet *packet)
 {
@@ -30,8 +30,30 @@ void Airtight_InitialisePacket(Airtight_Packet *packet)
     packet->meta.inject_time = 0;
     packet->meta.local_retransmit_count = 0;
     packet->meta.send_time = 0;
+    packet->meta.data_length = AIRTIGHT_DATA;
+    packet->meta.forwarded = false;
+    packet->meta.cut_through = false;
+    packet->meta.bulk = false;
+    packet->meta.has_deadline = false;
+    packet->meta.deadline = 0;
 
 #if (AT_CONF_ZERO_PACKET_DATA == 1)
     memset(packet->data.fields.data, 0x00, AIRTIGHT_DATA);
 #endif
 }
+
+/**
+ * Check whether two packets are copies of the same transmission, ignoring
+ * hop specific fields and metadata.
+ *
+ * Burst copies of a local packet share its sequence number, so for local
+ * packets the burst number must match as well.
+ */
+at_bool_t Airtight_IsSamePacket(const Airtight_Packet *a, const Airtight_Packet *b)
+{
+    return a->data.fields.source == b->data.fields.source &&
+           a->data.fields.destination == b->data.fields.destination &&
+           a->data.fields.flow_id == b->data.fields.flow_id &&
+           a->data.fields.sequence_number == b->data.fields.sequence_number &&
+           (a->meta.forwarded || b->meta.forwarded || a->meta.burst_number == b->meta.burst_number);
+}
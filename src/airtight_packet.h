@@ -20,7 +20,7 @@
 /**
  * The size of the non-transmitted packet metadata in bytes.
  */
-#define AIRTIGHT_PACKET_META 9
+#define AIRTIGHT_PACKET_META 10
 
 /**
  * The size of a notification packet.
@@ -53,7 +53,7 @@ typedef struct PACKED
     Airtight_NodeId hop_source : 8;
     Airtight_NodeId hop_destination : 8;
     at_u8_t c_value : 8;
-    at_u8_t sequence_number : 8;
+    at_u16_t sequence_number : 16;
     at_u8_t data[AIRTIGHT_DATA];
 } Airtight_PacketDataInner;
 
@@ -69,6 +69,13 @@ typedef struct
     at_time_t inject_time;
     at_time_t send_time;
     at_u8_t failed_ack_status;
+    at_u8_t data_length;
+    at_bool_t forwarded;
+    at_bool_t cut_through;
+    // Queued for best-effort service rather than in the PCQ
+    at_bool_t bulk;
+    at_bool_t has_deadline;
+    at_time_t deadline;
 } Airtight_PacketMeta;
 
 /**
@@ -93,7 +100,13 @@ typedef struct
  */
 typedef enum
 {
-    FAULT_SYNC = 0x00
+    FAULT_SYNC = 0x00,
+    // sync_slot is the local slot the switch takes effect, sync_time the mode
+    FAULT_MODE_SWITCH = 0x01,
+    // A node's criticality mode, see Airtight_CriticalityNotice
+    FAULT_CRITICALITY = 0x02,
+    // root_id has nothing to send in its transmit slot at local slot sync_slot
+    FAULT_SLOT_FREE = 0x03
 } Airtight_Fault;
 
 /**
@@ -107,15 +120,33 @@ typedef struct PACKED
     at_time_t sync_time : 32;
 } Airtight_NotificationInner;
 
+/**
+ * Criticality change notification fields.
+ *
+ * The origin's epoch is bumped with each change so relayed copies can be
+ * recognised and ttl is the hops the notice may still travel.
+ */
+typedef struct PACKED
+{
+    Airtight_NodeId origin_id : 8;
+    Airtight_Fault fault_activity : 8;
+    at_u16_t epoch : 16;
+    Airtight_Criticality mode : 8;
+    at_u8_t ttl : 8;
+    at_u16_t reserved : 16;
+} Airtight_CriticalityNotice;
+
 /**
  * Notification packet data as either fields via Airtight_NotificationInner or
  * raw bytes.
  */
 typedef union {
     Airtight_NotificationInner fields;
+    Airtight_CriticalityNotice criticality;
     at_u8_t raw[AIRTIGHT_NOTIFICATION_PACKET];
 } Airtight_Notification;
 
 void Airtight_InitialisePacket(Airtight_Packet *packet);
+at_bool_t Airtight_IsSamePacket(const Airtight_Packet *a, const Airtight_Packet *b);
 
 #endif
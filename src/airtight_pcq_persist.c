@@ -0,0 +1,134 @@
+/**
+ * @addtogroup Airtight_PriorityCriticalQueue
+ * @{
+ * @file
+ * AirTight: memory-mapped persistence of the priority critical queue
+ * implementation.
+ *
+ * The PCQ is mapped MAP_SHARED so every store lands in the page cache as it
+ * is made and survives the death of the process without any fsync on the
+ * hot path. Consistency comes from the committed words of the PCQ, see
+ * Airtight_PCQ_Recover. Airtight_PCQ_Persist_Sync may be called off the hot
+ * path to also survive loss of power.
+ *
+ * PORT: POSIX specific, other platforms may place the PCQ in retained RAM.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "airtight_pcq_persist.h"
+
+#if (AT_CONF_PCQ_PERSISTENT == 1)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Check that an image was written by a build with the same PCQ layout.
+ */
+static at_bool_t Airtight_PCQ_Persist_ImageValid(const Airtight_PCQ_PersistImage *image)
+{
+    return image->magic == AIRTIGHT_PCQ_PERSIST_MAGIC &&
+           image->version == AIRTIGHT_PCQ_PERSIST_VERSION &&
+           image->image_size == sizeof(Airtight_PCQ_PersistImage) &&
+           image->priorities == PRIORITY_CRITICAL_QUEUE_PRIORITIES &&
+           image->queue_size == PRIORITY_CRITICAL_QUEUE_SIZE;
+}
+
+/**
+ * Open or create a persistent PCQ.
+ *
+ * If the file holds a valid image the PCQ is recovered from it, replaying
+ * exactly the packets which had not been dequeued, otherwise a fresh PCQ is
+ * initialised in the file.
+ *
+ * @return the mapped PCQ, or NULL on failure.
+ */
+Airtight_PriorityCriticalQueue *Airtight_PCQ_Persist_Open(Airtight_PCQ_Persist *persist, const char *path)
+{
+    struct stat file_stat;
+
+    persist->image = NULL;
+    persist->recovered = false;
+
+    persist->fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (persist->fd < 0)
+    {
+        return NULL;
+    }
+
+    if (fstat(persist->fd, &file_stat) != 0 ||
+        ((size_t)file_stat.st_size != sizeof(Airtight_PCQ_PersistImage) &&
+         ftruncate(persist->fd, sizeof(Airtight_PCQ_PersistImage)) != 0))
+    {
+        close(persist->fd);
+        return NULL;
+    }
+
+    void *mapping = mmap(NULL, sizeof(Airtight_PCQ_PersistImage), PROT_READ | PROT_WRITE, MAP_SHARED, persist->fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(persist->fd);
+        return NULL;
+    }
+    persist->image = mapping;
+
+    if (Airtight_PCQ_Persist_ImageValid(persist->image) && Airtight_PCQ_Recover(&persist->image->pcq))
+    {
+        persist->recovered = true;
+    }
+    else
+    {
+        // Invalidate first so a crash during initialisation is detected.
+        __atomic_store_n(&persist->image->magic, 0, __ATOMIC_RELEASE);
+
+        Airtight_PCQ_Init(&persist->image->pcq);
+
+        persist->image->version = AIRTIGHT_PCQ_PERSIST_VERSION;
+        persist->image->image_size = sizeof(Airtight_PCQ_PersistImage);
+        persist->image->priorities = PRIORITY_CRITICAL_QUEUE_PRIORITIES;
+        persist->image->queue_size = PRIORITY_CRITICAL_QUEUE_SIZE;
+        __atomic_store_n(&persist->image->magic, AIRTIGHT_PCQ_PERSIST_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    return &persist->image->pcq;
+}
+
+/**
+ * Schedule write back of the PCQ to storage.
+ *
+ * Not required to survive a crash of the process, only loss of power. This
+ * does not wait for the write back so may be called periodically.
+ *
+ * @return true on success, false otherwise
+ */
+at_bool_t Airtight_PCQ_Persist_Sync(Airtight_PCQ_Persist *persist)
+{
+    if (NULL == persist->image)
+    {
+        return false;
+    }
+
+    return msync(persist->image, sizeof(Airtight_PCQ_PersistImage), MS_ASYNC) == 0;
+}
+
+/**
+ * Unmap a persistent PCQ, the file retains its contents.
+ */
+void Airtight_PCQ_Persist_Close(Airtight_PCQ_Persist *persist)
+{
+    if (NULL != persist->image)
+    {
+        munmap(persist->image, sizeof(Airtight_PCQ_PersistImage));
+        persist->image = NULL;
+    }
+
+    if (persist->fd >= 0)
+    {
+        close(persist->fd);
+        persist->fd = -1;
+    }
+}
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @addtogroup Airtight_PriorityCriticalQueue
+ * @{
+ * @file
+ * AirTight: memory-mapped persistence of the priority critical queue header.
+ */
+#ifndef __AIRTIGHT_PCQ_PERSIST_H
+#define __AIRTIGHT_PCQ_PERSIST_H
+
+#include "airtight_types.h"
+#include "airtight_mac_config.h"
+#include "airtight_priority_critical_queue.h"
+
+#if (AT_CONF_PCQ_PERSISTENT == 1)
+
+/**
+ * Magic number identifying a PCQ image, "ATPQ".
+ */
+#define AIRTIGHT_PCQ_PERSIST_MAGIC 0x51505441
+
+/**
+ * Version of the PCQ image layout.
+ */
+#define AIRTIGHT_PCQ_PERSIST_VERSION 3
+
+/**
+ * Layout of the memory-mapped file.
+ *
+ * The header is only written once the PCQ has been initialised so an image
+ * with a valid header always holds valid committed words.
+ */
+typedef struct
+{
+    at_u32_t magic;
+    at_u32_t version;
+    at_u32_t image_size;
+    at_u32_t priorities;
+    at_u32_t queue_size;
+    Airtight_PriorityCriticalQueue pcq;
+} Airtight_PCQ_PersistImage;
+
+/**
+ * Handle for a persistent PCQ.
+ */
+typedef struct
+{
+    int fd;
+    Airtight_PCQ_PersistImage *image;
+    at_bool_t recovered;
+} Airtight_PCQ_Persist;
+
+Airtight_PriorityCriticalQueue *Airtight_PCQ_Persist_Open(Airtight_PCQ_Persist *persist, const char *path);
+at_bool_t Airtight_PCQ_Persist_Sync(Airtight_PCQ_Persist *persist);
+void Airtight_PCQ_Persist_Close(Airtight_PCQ_Persist *persist);
+
+#endif
+
+#endif
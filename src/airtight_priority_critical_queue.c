@@ -16,20 +16,385 @@
 
 static const Airtight_Criticality _CRITICALITIES[] = AT_CONF_CRITICALITIES;
 
+#if (AT_CONF_LATEST_VALUE == 1)
+// \cond DO_NOT_DOCUMENT
+#define FLOW_INDEX_NONE PRIORITY_CRITICAL_QUEUE_SIZE
+#define FLOW_HASH(packet) ((((packet)->data.fields.source * 31u + (packet)->data.fields.flow_id) * 7u + (packet)->meta.burst_number) % AT_CONF_LATEST_VALUE_INDEX)
+// \endcond
+
+/**
+ * Check whether a flow index entry still gives the position of a queued
+ * packet of the same source, flow and burst copy.
+ */
+static inline at_bool_t Airtight_PCQ_FlowIndexValid(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_QueueIndex index, const Airtight_Packet *packet)
+{
+    if (index == FLOW_INDEX_NONE ||
+        MOD_SIZE(index + PRIORITY_CRITICAL_QUEUE_SIZE - pcq->heads[priority]) >= pcq->sizes[priority])
+    {
+        return false;
+    }
+
+    const Airtight_Packet *queued = &pcq->queues[priority][index];
+
+    return queued->data.fields.source == packet->data.fields.source &&
+           queued->data.fields.flow_id == packet->data.fields.flow_id &&
+           queued->meta.burst_number == packet->meta.burst_number;
+}
+
+/**
+ * Follow a latest-value packet moved within its priority's ring.
+ */
+static inline void Airtight_PCQ_FlowIndexMoved(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_QueueIndex from, Airtight_QueueIndex to)
+{
+    const Airtight_Packet *packet = &pcq->queues[priority][to];
+    Airtight_QueueIndex *entry = &pcq->flow_index[priority][FLOW_HASH(packet)];
+
+    if (*entry == from && Airtight_FlowIsLatestValue(packet->data.fields.flow_id))
+    {
+        *entry = to;
+    }
+}
+#endif
+
+#if (AT_CONF_FORWARD_QUOTAS == 1)
+// \cond DO_NOT_DOCUMENT
+#define COUNT_IN(pcq, priority, packet) ((pcq)->forwarded[priority] += (packet)->meta.forwarded ? 1 : 0)
+#define COUNT_OUT(pcq, priority, packet) ((pcq)->forwarded[priority] -= (packet)->meta.forwarded ? 1 : 0)
+#define RESET_FORWARDED(pcq, priority) ((pcq)->forwarded[priority] = 0)
+// \endcond
+
+static const Airtight_QueueIndex _FORWARD_RESERVED[] = AT_CONF_FORWARD_RESERVED;
+#else
+// \cond DO_NOT_DOCUMENT
+#define COUNT_IN(pcq, priority, packet)
+#define COUNT_OUT(pcq, priority, packet)
+#define RESET_FORWARDED(pcq, priority)
+// \endcond
+#endif
+
+#if (AT_CONF_EDF == 1)
+// \cond DO_NOT_DOCUMENT
+#define EDF_ORDERED(packet) ((packet)->meta.has_deadline)
+// \endcond
+
+/**
+ * Count the queued packets of a priority, from its tail, which a packet must
+ * be inserted ahead of to keep earliest deadline order. Packets with equal
+ * deadlines stay in FIFO order and packets without a deadline are kept
+ * behind those with one.
+ */
+static Airtight_QueueIndex Airtight_PCQ_DeadlineSteps(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, const Airtight_Packet *packet)
+{
+    Airtight_QueueIndex index = MOD_SIZE(pcq->heads[priority] + pcq->sizes[priority]);
+    Airtight_QueueIndex steps = 0;
+
+    for (; steps < pcq->sizes[priority]; steps++)
+    {
+        index = DEC_INDEX(index);
+        const Airtight_Packet *before = &pcq->queues[priority][index];
+
+        if (before->meta.has_deadline && (at_timediff_t)(before->meta.deadline - packet->meta.deadline) <= 0)
+        {
+            break;
+        }
+    }
+
+    return steps;
+}
+#else
+// \cond DO_NOT_DOCUMENT
+#define EDF_ORDERED(packet) false
+// \endcond
+#endif
+
+// \cond DO_NOT_DOCUMENT
+#define JOURNAL_REMOVAL 0x80000000u
+#define JOURNAL_INSERTION 0xc0000000u
+#define JOURNAL_REPLACEMENT 0x40000000u
+// \endcond
+
+#if (AT_CONF_PCQ_PERSISTENT == 1)
+// \cond DO_NOT_DOCUMENT
+#define COMMIT_WORD(head, size) (((at_u32_t)(head) << 16) | (at_u32_t)(size))
+#define COMMIT_HEAD(word) ((word) >> 16)
+#define COMMIT_SIZE(word) ((word)&0xffff)
+#define JOURNAL_KIND(word) ((word)&0xc0000000u)
+#define JOURNAL_WORD(kind, base, index, steps) ((kind) | ((at_u32_t)(base) << 20) | ((at_u32_t)(index) << 10) | (at_u32_t)(steps))
+#define JOURNAL_BASE(word) (((word) >> 20) & 0x3ff)
+#define JOURNAL_INDEX(word) (((word) >> 10) & 0x3ff)
+#define JOURNAL_STEPS(word) ((word)&0x3ff)
+// \endcond
+
+/**
+ * Publish the head and size of a priority as a single word.
+ *
+ * The release store orders every earlier write to the queue, in particular
+ * the packet copy of an enqueue, before the new head and size. A crash
+ * therefore never exposes a slot whose copy had not completed.
+ *
+ * PORT: uses the GCC/Clang atomic builtins.
+ */
+static inline void Airtight_PCQ_Commit(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority)
+{
+    __atomic_store_n(&pcq->committed[priority], COMMIT_WORD(pcq->heads[priority], pcq->sizes[priority]), __ATOMIC_RELEASE);
+}
+
+/**
+ * Record the progress of a change which overwrites committed entries of a
+ * priority's queue: a removal from its middle, an insertion ahead of its
+ * tail or the replacement of a latest-value packet.
+ *
+ * The record of each step is stored before the next entry is overwritten,
+ * and the fence keeps that overwrite after it, so an interrupted change can
+ * be finished by repeating at most the one copy in progress. A word of 0
+ * means no change is in progress.
+ *
+ * PORT: uses the GCC/Clang atomic builtins.
+ */
+static inline void Airtight_PCQ_Journal(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, at_u32_t word)
+{
+    __atomic_store_n(&pcq->journal[priority], word, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * Copy a packet into a priority's staging entry, which survives a crash, so
+ * a journalled change can place it over a committed entry.
+ *
+ * @return the staged copy
+ */
+static inline const Airtight_Packet *Airtight_PCQ_Stage(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, const Airtight_Packet *packet)
+{
+    memcpy(&pcq->staged[priority], packet, sizeof(Airtight_Packet));
+
+    return &pcq->staged[priority];
+}
+
+// \cond DO_NOT_DOCUMENT
+#define COMMIT(pcq, priority) Airtight_PCQ_Commit((pcq), (priority))
+#define JOURNAL(pcq, priority, word) Airtight_PCQ_Journal((pcq), (priority), (word))
+#define STAGE(pcq, priority, packet) Airtight_PCQ_Stage((pcq), (priority), (packet))
+// \endcond
+#else
+// \cond DO_NOT_DOCUMENT
+#define COMMIT(pcq, priority)
+#define JOURNAL(pcq, priority, word)
+#define STAGE(pcq, priority, packet) (packet)
+// \endcond
+#endif
+
+/**
+ * Move the entries ahead of index back a place, over the entry at index.
+ *
+ * steps entries are moved. With AT_CONF_PCQ_PERSISTENT each move is
+ * journalled as a change of the given kind against base, the head before a
+ * removal or the tail before an insertion.
+ *
+ * @return the index left free, holding a copy of the entry after it
+ */
+static Airtight_QueueIndex Airtight_PCQ_ShiftBack(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, at_u32_t kind, Airtight_QueueIndex base, Airtight_QueueIndex index, Airtight_QueueIndex steps)
+{
+    (void)kind;
+    (void)base;
+
+    for (; steps > 0; steps--)
+    {
+        const Airtight_QueueIndex previous = DEC_INDEX(index);
+        memcpy(&pcq->queues[priority][index], &pcq->queues[priority][previous], sizeof(Airtight_Packet));
+#if (AT_CONF_LATEST_VALUE == 1)
+        Airtight_PCQ_FlowIndexMoved(pcq, priority, previous, index);
+#endif
+        index = previous;
+        JOURNAL(pcq, priority, JOURNAL_WORD(kind, base, index, steps - 1));
+    }
+
+    return index;
+}
+
+#if (AT_CONF_EDF == 1)
+/**
+ * Place a packet in earliest deadline order, moving the queued packets it
+ * goes ahead of back a place into the free entry at tail.
+ *
+ * With AT_CONF_PCQ_PERSISTENT the packet is staged and the moves journalled,
+ * so a crash never tears a committed entry; see Airtight_PCQ_Recover. The
+ * caller commits the new size and then clears the journal.
+ *
+ * @return the index the packet is placed at
+ */
+static Airtight_QueueIndex Airtight_PCQ_InsertByDeadline(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_QueueIndex tail, const Airtight_Packet *packet)
+{
+    const Airtight_QueueIndex steps = Airtight_PCQ_DeadlineSteps(pcq, priority, packet);
+    const Airtight_Packet *placed = packet;
+
+    if (steps > 0)
+    {
+        placed = STAGE(pcq, priority, packet);
+        JOURNAL(pcq, priority, JOURNAL_WORD(JOURNAL_INSERTION, tail, tail, steps));
+    }
+
+    const Airtight_QueueIndex index = Airtight_PCQ_ShiftBack(pcq, priority, JOURNAL_INSERTION, tail, tail, steps);
+    memcpy(&pcq->queues[priority][index], placed, sizeof(Airtight_Packet));
+
+    return index;
+}
+#endif
+
+// \cond DO_NOT_DOCUMENT
+#define PRIORITY_BIT(priority) ((Airtight_PriorityMask)1u << (priority))
+// \endcond
+
+/**
+ * Note a change to a priority's size in the occupied mask and, with
+ * AT_CONF_PCQ_PERSISTENT, publish it.
+ */
+static inline void Airtight_PCQ_Changed(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority)
+{
+    if (pcq->sizes[priority] > 0)
+    {
+        pcq->occupied |= PRIORITY_BIT(priority);
+    }
+    else
+    {
+        pcq->occupied &= ~PRIORITY_BIT(priority);
+    }
+
+    COMMIT(pcq, priority);
+}
+
+/**
+ * The most urgent priority of a non-empty set.
+ *
+ * PORT: uses the GCC/Clang count trailing zeros builtin.
+ */
+static inline Airtight_Priority Airtight_PCQ_FirstPriority(Airtight_PriorityMask priorities)
+{
+    return (Airtight_Priority)__builtin_ctzl(priorities);
+}
+
+/**
+ * Fill in each priority's criticality and the priorities of each level.
+ */
+static void Airtight_PCQ_InitCriticalities(Airtight_PriorityCriticalQueue *pcq)
+{
+    memset(pcq->criticality_priorities, 0x00, sizeof(pcq->criticality_priorities));
+
+    for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
+    {
+        pcq->criticalities[i] = _CRITICALITIES[i];
+        pcq->criticality_priorities[_CRITICALITIES[i]] |= PRIORITY_BIT(i);
+    }
+}
+
 /**
  * Initialise a Airtight_PriorityCriticalQueue struct.
  */
 void Airtight_PCQ_Init(Airtight_PriorityCriticalQueue *pcq)
 {
+    Airtight_PCQ_InitCriticalities(pcq);
+
     // PORT: consider specifying that this loop should be unrolled.
     for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
     {
         pcq->heads[i] = 0;
         pcq->sizes[i] = 0;
-        pcq->criticalities[i] = _CRITICALITIES[i];
+        RESET_FORWARDED(pcq, i);
+        Airtight_PCQ_Changed(pcq, i);
+        JOURNAL(pcq, i, 0);
+
+#if (AT_CONF_EDF == 1)
+        pcq->expired[i] = 0;
+#endif
+
+#if (AT_CONF_LATEST_VALUE == 1)
+        for (size_t j = 0; j < AT_CONF_LATEST_VALUE_INDEX; j++)
+        {
+            pcq->flow_index[i][j] = FLOW_INDEX_NONE;
+        }
+#endif
     }
 }
 
+#if (AT_CONF_PCQ_PERSISTENT == 1)
+/**
+ * Rebuild heads and sizes of a PCQ from its committed words, e.g. after the
+ * PCQ has been mapped back in from a file following a crash.
+ *
+ * A journalled change which was interrupted is finished first: its remaining
+ * entries are moved and, if its new head and size had not been committed
+ * yet, a removed entry is dropped or an inserted one is added. An inserted
+ * or replacing packet is placed again from its staging entry.
+ *
+ * @return true if every committed word was valid, false otherwise in which
+ * case the PCQ should be re-initialised.
+ */
+at_bool_t Airtight_PCQ_Recover(Airtight_PriorityCriticalQueue *pcq)
+{
+    Airtight_PCQ_InitCriticalities(pcq);
+    pcq->occupied = 0;
+
+    for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
+    {
+        const at_u32_t word = __atomic_load_n(&pcq->committed[i], __ATOMIC_ACQUIRE);
+
+        if (COMMIT_HEAD(word) >= PRIORITY_CRITICAL_QUEUE_SIZE || COMMIT_SIZE(word) > PRIORITY_CRITICAL_QUEUE_SIZE)
+        {
+            return false;
+        }
+
+        pcq->heads[i] = COMMIT_HEAD(word);
+        pcq->sizes[i] = COMMIT_SIZE(word);
+        pcq->occupied |= pcq->sizes[i] > 0 ? PRIORITY_BIT(i) : 0;
+
+        const at_u32_t journal = __atomic_load_n(&pcq->journal[i], __ATOMIC_ACQUIRE);
+
+        if (journal != 0)
+        {
+            const at_u32_t kind = JOURNAL_KIND(journal);
+
+            if (JOURNAL_BASE(journal) >= PRIORITY_CRITICAL_QUEUE_SIZE || JOURNAL_INDEX(journal) >= PRIORITY_CRITICAL_QUEUE_SIZE ||
+                JOURNAL_STEPS(journal) >= PRIORITY_CRITICAL_QUEUE_SIZE || kind == 0 ||
+                (kind == JOURNAL_REPLACEMENT && JOURNAL_STEPS(journal) != 0))
+            {
+                return false;
+            }
+
+            const Airtight_QueueIndex index = Airtight_PCQ_ShiftBack(pcq, i, kind, JOURNAL_BASE(journal), JOURNAL_INDEX(journal), JOURNAL_STEPS(journal));
+
+            if (kind == JOURNAL_REMOVAL && pcq->heads[i] == JOURNAL_BASE(journal) && pcq->sizes[i] > 0)
+            {
+                pcq->sizes[i] = DEC_COUNT(pcq->sizes[i]);
+                pcq->heads[i] = INC_INDEX(pcq->heads[i]);
+            }
+            else if (kind != JOURNAL_REMOVAL)
+            {
+                memcpy(&pcq->queues[i][index], &pcq->staged[i], sizeof(Airtight_Packet));
+
+                if (kind == JOURNAL_INSERTION && MOD_SIZE(pcq->heads[i] + pcq->sizes[i]) == JOURNAL_BASE(journal) &&
+                    pcq->sizes[i] < PRIORITY_CRITICAL_QUEUE_SIZE)
+                {
+                    pcq->sizes[i] = INC_COUNT(pcq->sizes[i]);
+                }
+            }
+
+            Airtight_PCQ_Changed(pcq, i);
+            JOURNAL(pcq, i, 0);
+        }
+
+#if (AT_CONF_FORWARD_QUOTAS == 1)
+        pcq->forwarded[i] = 0;
+
+        for (Airtight_QueueIndex offset = 0; offset < pcq->sizes[i]; offset++)
+        {
+            COUNT_IN(pcq, i, &pcq->queues[i][MOD_SIZE(pcq->heads[i] + offset)]);
+        }
+#endif
+    }
+
+    return true;
+}
+#endif
+
 /**
  * Get the head of the queue.
  *
@@ -78,15 +443,16 @@ at_bool_t Airtight_PCQ_HeadPriority(Airtight_PriorityCriticalQueue *pcq, Airtigh
  */
 at_bool_t Airtight_PCQ_HeadCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit, Airtight_Packet *packet_out)
 {
-    for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
+    const Airtight_Packet *head = Airtight_PCQ_HeadCriticalityP(pcq, crit);
+
+    if (NULL == head)
     {
-        if (pcq->sizes[i] > 0 && pcq->criticalities[i] == crit)
-        {
-            memcpy(packet_out, &pcq->queues[i][pcq->heads[i]], sizeof(Airtight_Packet));
-        }
+        return false;
     }
 
-    return false;
+    memcpy(packet_out, head, sizeof(Airtight_Packet));
+
+    return true;
 }
 
 /**
@@ -150,15 +516,27 @@ Airtight_Packet *Airtight_PCQ_HeadPriorityP(Airtight_PriorityCriticalQueue *pcq,
  */
 Airtight_Packet *Airtight_PCQ_HeadCriticalityP(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit)
 {
-    for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
+    return Airtight_PCQ_HeadMaskP(pcq, pcq->criticality_priorities[crit]);
+}
+
+/**
+ * Get a pointer to the head of the most urgent non-empty priority of a set.
+ *
+ * @return a pointer to the stored packet if found, NULL otherwise
+ * @note This allows modification of queue items in place.
+ */
+Airtight_Packet *Airtight_PCQ_HeadMaskP(Airtight_PriorityCriticalQueue *pcq, Airtight_PriorityMask priorities)
+{
+    const Airtight_PriorityMask queued = pcq->occupied & priorities;
+
+    if (queued == 0)
     {
-        if (pcq->sizes[i] > 0 && pcq->criticalities[i] == crit)
-        {
-            return &pcq->queues[i][pcq->heads[i]];
-        }
+        return NULL;
     }
 
-    return NULL;
+    const Airtight_Priority i = Airtight_PCQ_FirstPriority(queued);
+
+    return &pcq->queues[i][pcq->heads[i]];
 }
 
 /**
@@ -177,29 +555,261 @@ Airtight_Packet *Airtight_PCQ_HeadPriorityCriticalityP(Airtight_PriorityCritical
     return NULL;
 }
 
+/**
+ * Get a pointer to an entry of a priority's queue by its offset from the head.
+ *
+ * @return a pointer to the stored packet if found, NULL otherwise
+ * @note This allows modification of queue items in place.
+ */
+Airtight_Packet *Airtight_PCQ_PeekPriorityP(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_QueueIndex offset)
+{
+    if (offset < pcq->sizes[priority])
+    {
+        return &pcq->queues[priority][MOD_SIZE(pcq->heads[priority] + offset)];
+    }
+
+    return NULL;
+}
+
+/**
+ * Remove an entry of a priority's queue by its offset from the head, keeping
+ * the order of the remaining entries.
+ *
+ * Entries ahead of the removed one are moved back a place and the head is
+ * advanced, so removing near the head, the common case, is cheap. With
+ * AT_CONF_PCQ_PERSISTENT the moves are journalled, see Airtight_PCQ_Recover.
+ *
+ * @return true if an item to remove is found, false otherwise
+ */
+at_bool_t Airtight_PCQ_RemovePriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_QueueIndex offset, Airtight_Packet *packet_out)
+{
+    if (offset >= pcq->sizes[priority])
+    {
+        return false;
+    }
+
+    Airtight_QueueIndex index = MOD_SIZE(pcq->heads[priority] + offset);
+
+    if (NULL != packet_out)
+        memcpy(packet_out, &pcq->queues[priority][index], sizeof(Airtight_Packet));
+    COUNT_OUT(pcq, priority, &pcq->queues[priority][index]);
+
+    JOURNAL(pcq, priority, JOURNAL_WORD(JOURNAL_REMOVAL, pcq->heads[priority], index, offset));
+    Airtight_PCQ_ShiftBack(pcq, priority, JOURNAL_REMOVAL, pcq->heads[priority], index, offset);
+
+    pcq->sizes[priority] = DEC_COUNT(pcq->sizes[priority]);
+    pcq->heads[priority] = INC_INDEX(pcq->heads[priority]);
+    Airtight_PCQ_Changed(pcq, priority);
+    JOURNAL(pcq, priority, 0);
+
+    return true;
+}
+
+#if (AT_CONF_FORWARD_QUOTAS == 1)
+/**
+ * Make room in a priority's queue for a local or forwarded packet.
+ *
+ * Each class is guaranteed its share of the queue: the reserved entries for
+ * forwarded packets and the rest for local ones. Local packets may never
+ * take the reserved entries. When the arriving class is at its share its
+ * own oldest packet is evicted, otherwise the other class's oldest is, so
+ * neither class can evict the other below its share.
+ *
+ * @return true if there is room for the packet, false if it is rejected
+ */
+static at_bool_t Airtight_PCQ_MakeRoom(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, at_bool_t forwarded)
+{
+    const Airtight_QueueIndex reserved = _FORWARD_RESERVED[priority];
+    const Airtight_QueueIndex forwarded_count = pcq->forwarded[priority];
+    const Airtight_QueueIndex local_count = pcq->sizes[priority] - forwarded_count;
+    at_bool_t evict_forwarded;
+
+    if (!forwarded && local_count >= PRIORITY_CRITICAL_QUEUE_SIZE - reserved)
+    {
+        evict_forwarded = false;
+    }
+    else if (pcq->sizes[priority] < PRIORITY_CRITICAL_QUEUE_SIZE)
+    {
+        return true;
+    }
+    else
+    {
+        evict_forwarded = !forwarded || forwarded_count >= reserved;
+    }
+
+#if (REJECT_WHEN_BUFFER_FULL == 1)
+    return false;
+#else
+    for (Airtight_QueueIndex offset = 0; offset < pcq->sizes[priority]; offset++)
+    {
+        if (pcq->queues[priority][MOD_SIZE(pcq->heads[priority] + offset)].meta.forwarded == evict_forwarded)
+        {
+            return Airtight_PCQ_RemovePriority(pcq, priority, offset, NULL);
+        }
+    }
+
+    return false;
+#endif
+}
+
+/**
+ * Get the number of forwarded packets queued at a priority.
+ *
+ * @return the number of items
+ */
+size_t Airtight_PCQ_SizeForwardedPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority)
+{
+    return pcq->forwarded[priority];
+}
+#endif
+
 /**
  * Enqueue a packet. The packet's priority/criticality will be inspected to enqueue it.
  *
+ * A packet of a latest-value flow replaces the queued packet of the same
+ * source, flow and burst copy in place, keeping its position, rather than
+ * queueing behind it. Flows which share a flow index entry fall back to
+ * being appended.
+ *
+ * With AT_CONF_EDF a packet with a deadline is inserted in earliest deadline
+ * order, and a latest-value replacement is moved to its new deadline's place.
+ *
  * @note The packet will be copied into the PCQ.
+ * With AT_CONF_FORWARD_QUOTAS, room is made as described for
+ * Airtight_PCQ_MakeRoom rather than by overwriting the oldest entry.
+ *
+ * @note With AT_CONF_PCQ_PERSISTENT a deadline insertion is journalled like
+ * a removal, see Airtight_PCQ_InsertByDeadline, and a latest-value
+ * replacement is staged and journalled before it overwrites the queued
+ * packet.
+ *
+ * @return true if the packet was queued, false if it was rejected
  */
-void Airtight_PCQ_Enqueue(Airtight_PriorityCriticalQueue *pcq, Airtight_Packet *packet)
+at_bool_t Airtight_PCQ_Enqueue(Airtight_PriorityCriticalQueue *pcq, Airtight_Packet *packet)
 {
     const Airtight_Priority priority = packet->data.fields.priority;
     Airtight_QueueIndex insertion_index = MOD_SIZE(pcq->heads[priority] + pcq->sizes[priority]);
 
+#if (AT_CONF_LATEST_VALUE == 1)
+    Airtight_QueueIndex *flow_entry = NULL;
+
+    if (Airtight_FlowIsLatestValue(packet->data.fields.flow_id))
+    {
+        flow_entry = &pcq->flow_index[priority][FLOW_HASH(packet)];
+
+        const at_bool_t queued = Airtight_PCQ_FlowIndexValid(pcq, priority, *flow_entry, packet);
+
+        if (queued && !EDF_ORDERED(packet))
+        {
+            const Airtight_Packet *placed = STAGE(pcq, priority, packet);
+            JOURNAL(pcq, priority, JOURNAL_WORD(JOURNAL_REPLACEMENT, 0, *flow_entry, 0));
+
+            COUNT_OUT(pcq, priority, &pcq->queues[priority][*flow_entry]);
+            COUNT_IN(pcq, priority, packet);
+            memcpy(&pcq->queues[priority][*flow_entry], placed, sizeof(Airtight_Packet));
+            Airtight_PCQ_Changed(pcq, priority);
+            JOURNAL(pcq, priority, 0);
+            return true;
+        }
+
+        if (queued)
+        {
+            Airtight_PCQ_RemovePriority(pcq, priority, MOD_SIZE(*flow_entry + PRIORITY_CRITICAL_QUEUE_SIZE - pcq->heads[priority]), NULL);
+            insertion_index = MOD_SIZE(pcq->heads[priority] + pcq->sizes[priority]);
+        }
+    }
+#endif
+
+#if (AT_CONF_FORWARD_QUOTAS == 1)
+    if (!Airtight_PCQ_MakeRoom(pcq, priority, packet->meta.forwarded))
+    {
+        return false;
+    }
+
+    insertion_index = MOD_SIZE(pcq->heads[priority] + pcq->sizes[priority]);
+#else
     if (pcq->sizes[priority] == PRIORITY_CRITICAL_QUEUE_SIZE)
     {
 #if (REJECT_WHEN_BUFFER_FULL == 1)
-        return;
+        return false;
 #else
+        // The oldest entry is dropped before it is overwritten so a crash
+        // during the copy never exposes a half written packet.
         pcq->heads[priority] = INC_INDEX(pcq->heads[priority]);
+        pcq->sizes[priority] = DEC_COUNT(pcq->sizes[priority]);
+        Airtight_PCQ_Changed(pcq, priority);
 #endif
     }
+#endif
+
+#if (AT_CONF_EDF == 1)
+    if (EDF_ORDERED(packet))
+    {
+        insertion_index = Airtight_PCQ_InsertByDeadline(pcq, priority, insertion_index, packet);
+    }
+    else
+#endif
+    {
+        memcpy(&pcq->queues[priority][insertion_index], packet, sizeof(Airtight_Packet));
+    }
 
-    memcpy(&pcq->queues[priority][insertion_index], packet, sizeof(Airtight_Packet));
     pcq->sizes[priority] = INC_COUNT(pcq->sizes[priority]);
+    COUNT_IN(pcq, priority, packet);
+    Airtight_PCQ_Changed(pcq, priority);
+
+    if (EDF_ORDERED(packet))
+    {
+        JOURNAL(pcq, priority, 0);
+    }
+
+#if (AT_CONF_LATEST_VALUE == 1)
+    if (NULL != flow_entry)
+    {
+        *flow_entry = insertion_index;
+    }
+#endif
+
+    return true;
 }
 
+#if (AT_CONF_EDF == 1)
+/**
+ * Drop packets at the head of a priority whose deadline has passed.
+ *
+ * Packets with deadlines are kept in deadline order ahead of those without,
+ * so every expired packet is at the head.
+ *
+ * @return the number of packets dropped
+ */
+Airtight_QueueIndex Airtight_PCQ_DropExpiredPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, at_time_t now)
+{
+    Airtight_QueueIndex dropped = 0;
+
+    while (pcq->sizes[priority] > 0)
+    {
+        const Airtight_Packet *head = &pcq->queues[priority][pcq->heads[priority]];
+
+        if (!head->meta.has_deadline || (at_timediff_t)(head->meta.deadline - now) >= 0)
+        {
+            break;
+        }
+
+        COUNT_OUT(pcq, priority, &pcq->queues[priority][pcq->heads[priority]]);
+        pcq->sizes[priority] = DEC_COUNT(pcq->sizes[priority]);
+        pcq->heads[priority] = INC_INDEX(pcq->heads[priority]);
+        dropped++;
+    }
+
+    if (dropped > 0)
+    {
+        pcq->expired[priority] += dropped;
+        Airtight_PCQ_Changed(pcq, priority);
+    }
+
+    return dropped;
+}
+#endif
+
 /**
  * Dequeue any item.
  *
@@ -213,8 +823,10 @@ at_bool_t Airtight_PCQ_Dequeue(Airtight_PriorityCriticalQueue *pcq, Airtight_Pac
         {
             if (NULL != packet_out)
                 memcpy(packet_out, &pcq->queues[i][pcq->heads[i]], sizeof(Airtight_Packet));
+            COUNT_OUT(pcq, i, &pcq->queues[i][pcq->heads[i]]);
             pcq->sizes[i] = DEC_COUNT(pcq->sizes[i]);
             pcq->heads[i] = INC_INDEX(pcq->heads[i]);
+            Airtight_PCQ_Changed(pcq, i);
 
             return true;
         }
@@ -234,8 +846,10 @@ at_bool_t Airtight_PCQ_DequeuePriority(Airtight_PriorityCriticalQueue *pcq, Airt
     {
         if (NULL != packet_out)
             memcpy(packet_out, &pcq->queues[priority][pcq->heads[priority]], sizeof(Airtight_Packet));
+        COUNT_OUT(pcq, priority, &pcq->queues[priority][pcq->heads[priority]]);
         pcq->sizes[priority] = DEC_COUNT(pcq->sizes[priority]);
         pcq->heads[priority] = INC_INDEX(pcq->heads[priority]);
+        Airtight_PCQ_Changed(pcq, priority);
 
         return true;
     }
@@ -250,19 +864,14 @@ at_bool_t Airtight_PCQ_DequeuePriority(Airtight_PriorityCriticalQueue *pcq, Airt
  */
 at_bool_t Airtight_PCQ_DequeueCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit, Airtight_Packet *packet_out)
 {
-    for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
+    const Airtight_PriorityMask queued = pcq->occupied & pcq->criticality_priorities[crit];
+
+    if (queued == 0)
     {
-        if (pcq->sizes[i] > 0 && pcq->criticalities[i] == crit)
-        {
-            if (NULL != packet_out)
-                memcpy(packet_out, &pcq->queues[i][pcq->heads[i]], sizeof(Airtight_Packet));
-            pcq->sizes[i] = DEC_COUNT(pcq->sizes[i]);
-            pcq->heads[i] = INC_INDEX(pcq->heads[i]);
-            return true;
-        }
+        return false;
     }
 
-    return false;
+    return Airtight_PCQ_DequeuePriority(pcq, Airtight_PCQ_FirstPriority(queued), packet_out);
 }
 
 /**
@@ -276,8 +885,10 @@ at_bool_t Airtight_PCQ_DequeuePriorityCriticality(Airtight_PriorityCriticalQueue
     {
         if (NULL != packet_out)
             memcpy(packet_out, &pcq->queues[priority][pcq->heads[priority]], sizeof(Airtight_Packet));
+        COUNT_OUT(pcq, priority, &pcq->queues[priority][pcq->heads[priority]]);
         pcq->sizes[priority] = DEC_COUNT(pcq->sizes[priority]);
         pcq->heads[priority] = INC_INDEX(pcq->heads[priority]);
+        Airtight_PCQ_Changed(pcq, priority);
 
         return true;
     }
@@ -312,21 +923,51 @@ size_t Airtight_PCQ_SizePriority(Airtight_PriorityCriticalQueue *pcq, Airtight_P
     return pcq->sizes[priority];
 }
 
+/**
+ * Get the number of local packets that can still be queued at a priority
+ * without evicting another local packet.
+ *
+ * Entries reserved for forwarded packets are not counted, since local packets
+ * may never take them.
+ *
+ * @return the number of free entries
+ */
+size_t Airtight_PCQ_FreeLocalPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority)
+{
+#if (AT_CONF_FORWARD_QUOTAS == 1)
+    const size_t local_count = pcq->sizes[priority] - pcq->forwarded[priority];
+    const size_t share = PRIORITY_CRITICAL_QUEUE_SIZE - _FORWARD_RESERVED[priority];
+
+    return local_count >= share ? 0 : share - local_count;
+#else
+    return PRIORITY_CRITICAL_QUEUE_SIZE - pcq->sizes[priority];
+#endif
+}
+
 /**
  * Get the number of items which match the specified criticality.
  *
  * @return the number of items
  */
 size_t Airtight_PCQ_SizeCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit)
+{
+    return Airtight_PCQ_SizeMask(pcq, pcq->criticality_priorities[crit]);
+}
+
+/**
+ * Get the number of items queued at a set of priorities.
+ *
+ * Only the non-empty priorities of the set are visited.
+ *
+ * @return the number of items
+ */
+size_t Airtight_PCQ_SizeMask(Airtight_PriorityCriticalQueue *pcq, Airtight_PriorityMask priorities)
 {
     size_t count = 0;
 
-    for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
+    for (Airtight_PriorityMask queued = pcq->occupied & priorities; queued != 0; queued &= queued - 1)
     {
-        if (pcq->criticalities[i] == crit)
-        {
-            count += pcq->sizes[i];
-        }
+        count += pcq->sizes[Airtight_PCQ_FirstPriority(queued)];
     }
 
     return count;
@@ -357,6 +998,8 @@ void Airtight_PCQ_Clear(Airtight_PriorityCriticalQueue *pcq)
     for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
     {
         pcq->sizes[i] = 0;
+        RESET_FORWARDED(pcq, i);
+        Airtight_PCQ_Changed(pcq, i);
     }
 }
 
@@ -366,6 +1009,8 @@ void Airtight_PCQ_Clear(Airtight_PriorityCriticalQueue *pcq)
 void Airtight_PCQ_ClearPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority)
 {
     pcq->sizes[priority] = 0;
+    RESET_FORWARDED(pcq, priority);
+    Airtight_PCQ_Changed(pcq, priority);
 }
 
 /**
@@ -373,13 +1018,38 @@ void Airtight_PCQ_ClearPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Pr
  */
 void Airtight_PCQ_ClearCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit)
 {
-    for (Airtight_Priority i = 0; i < PRIORITY_CRITICAL_QUEUE_PRIORITIES; i++)
+    Airtight_PCQ_ClearMask(pcq, pcq->criticality_priorities[crit]);
+}
+
+/**
+ * Clear a set of priorities, only visiting the non-empty ones.
+ */
+void Airtight_PCQ_ClearMask(Airtight_PriorityCriticalQueue *pcq, Airtight_PriorityMask priorities)
+{
+    for (Airtight_PriorityMask queued = pcq->occupied & priorities; queued != 0; queued &= queued - 1)
     {
-        if (pcq->criticalities[i] == crit)
+        Airtight_PCQ_ClearPriority(pcq, Airtight_PCQ_FirstPriority(queued));
+    }
+}
+
+/**
+ * Get the priorities belonging to a set of criticality levels.
+ *
+ * @return the set of priorities
+ */
+Airtight_PriorityMask Airtight_PCQ_PrioritiesOf(Airtight_PriorityCriticalQueue *pcq, Airtight_CriticalityMask levels)
+{
+    Airtight_PriorityMask priorities = 0;
+
+    for (at_u8_t level = 0; level < AIRTIGHT_CRITICALITY_LEVELS; level++)
+    {
+        if (levels & AIRTIGHT_CRITICALITY_BIT(level))
         {
-            pcq->sizes[i] = 0;
+            priorities |= pcq->criticality_priorities[level];
         }
     }
+
+    return priorities;
 }
 
 /**
@@ -390,5 +1060,7 @@ void Airtight_PCQ_ClearPriorityCriticality(Airtight_PriorityCriticalQueue *pcq,
     if (pcq->criticalities[priority] == crit)
     {
         pcq->sizes[priority] = 0;
+        RESET_FORWARDED(pcq, priority);
+        Airtight_PCQ_Changed(pcq, priority);
     }
 }
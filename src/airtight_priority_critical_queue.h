@@ -14,6 +14,7 @@
 #include "airtight_types.h"
 #include "airtight_packet.h"
 #include "airtight_mac_config.h"
+#include "airtight_flows.h"
 
 #ifndef PRIORITY_CRITICAL_QUEUE_SIZE
 /**
@@ -26,6 +27,10 @@
 #error C value cannot be greater than PCQ size as this would lead to saturation of the PCQ.
 #endif
 
+#if (AT_CONF_PCQ_PERSISTENT == 1 && PRIORITY_CRITICAL_QUEUE_SIZE > 1024)
+#error The persistent PCQ journal supports queues of at most 1024 entries.
+#endif
+
 /**
  * Index type for queues.
  */
@@ -42,6 +47,15 @@ typedef at_u16_t Airtight_QueueIndex;
 #define PRIORITY_CRITICAL_QUEUE_PRIORITIES AIRTIGHT_PRIORITIES
 #endif
 
+#if (PRIORITY_CRITICAL_QUEUE_PRIORITIES > 32)
+#error Priority masks hold at most 32 priorities.
+#endif
+
+/**
+ * A set of priorities, bit n for priority n.
+ */
+typedef at_u32_t Airtight_PriorityMask;
+
 /**
  * Whether new packets should be rejected when a queue is full. If not then the
  * oldest entry in the buffer will be overwritten when a new packet is added to
@@ -58,6 +72,31 @@ typedef at_u16_t Airtight_QueueIndex;
  * criticality (always should be handled, but not necessarily needing fast
  * handling). This allows low-criticality items to be ignored during fault
  * conditions to ensure the most critical tasks are still completed.
+ *
+ * When AT_CONF_PCQ_PERSISTENT is enabled each priority also has a committed
+ * word which packs its head and size. It is written with release ordering
+ * after every change to that priority and is the only state trusted after a
+ * crash, as heads and sizes may be torn. A removal from the middle of a
+ * queue, a deadline insertion or a latest-value replacement overwrites
+ * committed entries, so its progress is also journalled in a journal word, a
+ * new packet is first copied to a staging entry, and an interrupted change is
+ * finished on recovery.
+ *
+ * When AT_CONF_LATEST_VALUE is enabled each priority also has a flow index,
+ * hashed by source, flow and burst copy, giving the position of the queued
+ * packet of each latest-value flow. Entries are hints validated on use, so
+ * dequeues and clears need not maintain them.
+ *
+ * When AT_CONF_EDF is enabled packets with a deadline are kept in earliest
+ * deadline order within their priority, ahead of packets without one, and
+ * expired packets are counted per priority as they are dropped.
+ *
+ * When AT_CONF_FORWARD_QUOTAS is enabled the number of forwarded packets in
+ * each priority is counted separately, for the forwarding reserve.
+ *
+ * The priorities of each criticality level, and those with packets queued,
+ * are also kept as masks so operations on criticalities only visit the
+ * priorities concerned.
  */
 typedef struct
 {
@@ -65,9 +104,29 @@ typedef struct
     Airtight_QueueIndex heads[PRIORITY_CRITICAL_QUEUE_PRIORITIES];
     Airtight_QueueIndex sizes[PRIORITY_CRITICAL_QUEUE_PRIORITIES];
     Airtight_Criticality criticalities[PRIORITY_CRITICAL_QUEUE_PRIORITIES];
+    Airtight_PriorityMask criticality_priorities[AIRTIGHT_CRITICALITY_LEVELS];
+    // Priorities with packets queued
+    Airtight_PriorityMask occupied;
+#if (AT_CONF_FORWARD_QUOTAS == 1)
+    Airtight_QueueIndex forwarded[PRIORITY_CRITICAL_QUEUE_PRIORITIES];
+#endif
+#if (AT_CONF_EDF == 1)
+    at_u32_t expired[PRIORITY_CRITICAL_QUEUE_PRIORITIES];
+#endif
+#if (AT_CONF_LATEST_VALUE == 1)
+    Airtight_QueueIndex flow_index[PRIORITY_CRITICAL_QUEUE_PRIORITIES][AT_CONF_LATEST_VALUE_INDEX];
+#endif
+#if (AT_CONF_PCQ_PERSISTENT == 1)
+    at_u32_t committed[PRIORITY_CRITICAL_QUEUE_PRIORITIES];
+    at_u32_t journal[PRIORITY_CRITICAL_QUEUE_PRIORITIES];
+    Airtight_Packet staged[PRIORITY_CRITICAL_QUEUE_PRIORITIES];
+#endif
 } Airtight_PriorityCriticalQueue;
 
 void Airtight_PCQ_Init(Airtight_PriorityCriticalQueue *pcq);
+#if (AT_CONF_PCQ_PERSISTENT == 1)
+at_bool_t Airtight_PCQ_Recover(Airtight_PriorityCriticalQueue *pcq);
+#endif
 
 at_bool_t Airtight_PCQ_Head(Airtight_PriorityCriticalQueue *pcq, Airtight_Packet *packet_out);
 at_bool_t Airtight_PCQ_HeadPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_Packet *packet_out);
@@ -78,22 +137,36 @@ Airtight_Packet *Airtight_PCQ_HeadP(Airtight_PriorityCriticalQueue *pcq);
 Airtight_Packet *Airtight_PCQ_HeadPriorityP(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority);
 Airtight_Packet *Airtight_PCQ_HeadCriticalityP(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit);
 Airtight_Packet *Airtight_PCQ_HeadPriorityCriticalityP(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_Criticality crit);
+Airtight_Packet *Airtight_PCQ_HeadMaskP(Airtight_PriorityCriticalQueue *pcq, Airtight_PriorityMask priorities);
+Airtight_Packet *Airtight_PCQ_PeekPriorityP(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_QueueIndex offset);
 
-void Airtight_PCQ_Enqueue(Airtight_PriorityCriticalQueue *pcq, Airtight_Packet *packet);
+at_bool_t Airtight_PCQ_Enqueue(Airtight_PriorityCriticalQueue *pcq, Airtight_Packet *packet);
 
 at_bool_t Airtight_PCQ_Dequeue(Airtight_PriorityCriticalQueue *pcq, Airtight_Packet *packet_out);
 at_bool_t Airtight_PCQ_DequeuePriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_Packet *packet_out);
 at_bool_t Airtight_PCQ_DequeueCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit, Airtight_Packet *packet_out);
 at_bool_t Airtight_PCQ_DequeuePriorityCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_Criticality crit, Airtight_Packet *packet_out);
+at_bool_t Airtight_PCQ_RemovePriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_QueueIndex offset, Airtight_Packet *packet_out);
+#if (AT_CONF_EDF == 1)
+Airtight_QueueIndex Airtight_PCQ_DropExpiredPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, at_time_t now);
+#endif
 
 size_t Airtight_PCQ_Size(Airtight_PriorityCriticalQueue *pcq);
 size_t Airtight_PCQ_SizePriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority);
 size_t Airtight_PCQ_SizeCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit);
+size_t Airtight_PCQ_SizeMask(Airtight_PriorityCriticalQueue *pcq, Airtight_PriorityMask priorities);
+size_t Airtight_PCQ_FreeLocalPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority);
+#if (AT_CONF_FORWARD_QUOTAS == 1)
+size_t Airtight_PCQ_SizeForwardedPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority);
+#endif
 size_t Airtight_PCQ_SizePriorityCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_Criticality crit);
 
 void Airtight_PCQ_Clear(Airtight_PriorityCriticalQueue *pcq);
 void Airtight_PCQ_ClearPriority(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority);
 void Airtight_PCQ_ClearCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Criticality crit);
+void Airtight_PCQ_ClearMask(Airtight_PriorityCriticalQueue *pcq, Airtight_PriorityMask priorities);
+
+Airtight_PriorityMask Airtight_PCQ_PrioritiesOf(Airtight_PriorityCriticalQueue *pcq, Airtight_CriticalityMask levels);
 void Airtight_PCQ_ClearPriorityCriticality(Airtight_PriorityCriticalQueue *pcq, Airtight_Priority priority, Airtight_Criticality crit);
 
 #endif
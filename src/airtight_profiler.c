@@ -0,0 +1,244 @@
+/**
+ * @addtogroup Airtight_Profiler
+ * @{
+ * @file
+ * AirTight: slot timeline profiler implementation.
+ *
+ * Events are timestamped into a single producer single consumer ring on the
+ * slot path and turned into histograms by Airtight_Profiler_Process, which
+ * may run on another thread. The accounting functions are also used by the
+ * offline report tool on raw event dumps.
+ *
+ * PORT: uses the GCC/Clang atomic builtins.
+ */
+#include <string.h>
+
+#include "airtight_profiler.h"
+#include "airtight_time.h"
+
+static const char *const _PHASE_NAMES[AIRTIGHT_PROFILE_PHASES] = {
+    "App_Tick",
+    "Radio_DeviceTick",
+    "DoSlot",
+    "SerialWrite",
+    "SlotLateness",
+    "SlotToWire",
+};
+
+/**
+ * Initialise an Airtight_ProfileStats struct.
+ */
+void Airtight_Profiler_InitStats(Airtight_ProfileStats *stats)
+{
+    memset(stats, 0, sizeof(Airtight_ProfileStats));
+}
+
+/**
+ * Add a duration to the histogram of a phase.
+ */
+static void Airtight_Profiler_AddSample(Airtight_ProfileHistogram *histogram, at_u32_t duration_us)
+{
+    at_u8_t bucket = 0;
+
+    while (bucket < AIRTIGHT_PROFILE_BUCKETS - 1 && (duration_us >> bucket) != 0)
+    {
+        bucket++;
+    }
+
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->total_us += duration_us;
+    if (duration_us > histogram->max_us)
+    {
+        histogram->max_us = duration_us;
+    }
+}
+
+/**
+ * Account for a single event.
+ *
+ * A slot overruns when its DoSlot phase ends more than a slot length after
+ * the slot should have started.
+ */
+void Airtight_Profiler_Account(Airtight_ProfileStats *stats, const Airtight_ProfileEvent *event)
+{
+    if (event->phase >= AIRTIGHT_PROFILE_PHASES)
+    {
+        return;
+    }
+
+    switch (event->type)
+    {
+    case PROFILE_ENTER:
+        stats->enter_time_us[event->phase] = event->time_us;
+        stats->entered[event->phase] = true;
+        break;
+    case PROFILE_EXIT:
+        if (stats->entered[event->phase])
+        {
+            Airtight_Profiler_AddSample(&stats->phases[event->phase], event->time_us - stats->enter_time_us[event->phase]);
+            stats->entered[event->phase] = false;
+        }
+        if (event->phase == PHASE_DO_SLOT && stats->in_slot)
+        {
+            if (event->time_us - stats->ideal_slot_start_us > AT_CONF_SLOT_LENGTH_MS * 1000u)
+            {
+                stats->overruns++;
+            }
+            stats->in_slot = false;
+        }
+        break;
+    case PROFILE_SLOT_START:
+        Airtight_Profiler_AddSample(&stats->phases[PHASE_SLOT_LATENESS], event->value);
+        stats->ideal_slot_start_us = event->time_us - event->value;
+        stats->in_slot = true;
+        stats->awaiting_wire = true;
+        stats->slots++;
+        break;
+    case PROFILE_MISSED_SLOTS:
+        stats->missed_slots += event->value;
+        break;
+    case PROFILE_FRAME_ON_WIRE:
+        // Only the first frame of a slot is attributed to it.
+        if (stats->awaiting_wire)
+        {
+            Airtight_Profiler_AddSample(&stats->phases[PHASE_SLOT_TO_WIRE], event->time_us - stats->ideal_slot_start_us);
+            stats->awaiting_wire = false;
+        }
+        break;
+    }
+}
+
+/**
+ * Print accumulated statistics with a histogram per phase.
+ *
+ * Percentiles are reported as the upper bound of the bucket they fall in.
+ */
+void Airtight_Profiler_DumpStats(const Airtight_ProfileStats *stats, FILE *stream)
+{
+    fprintf(stream, "PROFILE slots=%u overruns=%u missed=%u dropped=%u\n",
+            stats->slots, stats->overruns, stats->missed_slots, stats->dropped_events);
+
+    for (at_u8_t phase = 0; phase < AIRTIGHT_PROFILE_PHASES; phase++)
+    {
+        const Airtight_ProfileHistogram *histogram = &stats->phases[phase];
+        at_u32_t p99_us = 0;
+        at_u32_t seen = 0;
+
+        for (at_u8_t bucket = 0; bucket < AIRTIGHT_PROFILE_BUCKETS; bucket++)
+        {
+            seen += histogram->buckets[bucket];
+            if ((at_u64_t)seen * 100 >= (at_u64_t)histogram->count * 99)
+            {
+                p99_us = bucket == 0 ? 0 : (1u << bucket) - 1;
+                break;
+            }
+        }
+
+        fprintf(stream, "PROFILE %-16s count=%u mean_us=%u p99_us<=%u max_us=%u\n",
+                _PHASE_NAMES[phase],
+                histogram->count,
+                histogram->count == 0 ? 0 : (at_u32_t)(histogram->total_us / histogram->count),
+                p99_us,
+                histogram->max_us);
+
+        for (at_u8_t bucket = 0; bucket < AIRTIGHT_PROFILE_BUCKETS; bucket++)
+        {
+            if (histogram->buckets[bucket] != 0)
+            {
+                fprintf(stream, "PROFILE %-16s   <%uus %u\n", "", 1u << bucket, histogram->buckets[bucket]);
+            }
+        }
+    }
+}
+
+#if (AT_CONF_PROFILER == 1)
+
+#if (AT_CONF_PROFILER_RING_SIZE & (AT_CONF_PROFILER_RING_SIZE - 1)) != 0
+#error AT_CONF_PROFILER_RING_SIZE must be a power of two.
+#endif
+
+static Airtight_ProfileEvent _ring[AT_CONF_PROFILER_RING_SIZE];
+static at_u32_t _write_index = 0;
+static at_u32_t _read_index = 0;
+static at_u32_t _dropped = 0;
+static Airtight_ProfileStats _stats;
+
+/**
+ * Timestamp an event into the ring, dropping it if the ring is full.
+ *
+ * @note Use the AT_PROFILE_* macros which compile out when profiling is
+ * disabled.
+ */
+void Airtight_Profiler_Record(Airtight_ProfileEventType type, Airtight_ProfilePhase phase, at_u16_t slot, at_u32_t value)
+{
+    const at_u32_t write_index = _write_index;
+
+    if (write_index - __atomic_load_n(&_read_index, __ATOMIC_ACQUIRE) >= AT_CONF_PROFILER_RING_SIZE)
+    {
+        _dropped++;
+        return;
+    }
+
+    Airtight_ProfileEvent *event = &_ring[write_index & (AT_CONF_PROFILER_RING_SIZE - 1)];
+    event->time_us = Airtight_Time_MonotonicUS();
+    event->value = value;
+    event->type = type;
+    event->phase = phase;
+    event->slot = slot;
+
+    __atomic_store_n(&_write_index, write_index + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Drain the event ring into the profiler statistics.
+ *
+ * If raw_stream is not NULL the drained events are also written to it for
+ * the offline report tool.
+ *
+ * @return the number of events drained
+ */
+size_t Airtight_Profiler_Process(FILE *raw_stream)
+{
+    const at_u32_t write_index = __atomic_load_n(&_write_index, __ATOMIC_ACQUIRE);
+    at_u32_t read_index = _read_index;
+    size_t count = 0;
+
+    while (read_index != write_index)
+    {
+        const Airtight_ProfileEvent *event = &_ring[read_index & (AT_CONF_PROFILER_RING_SIZE - 1)];
+
+        Airtight_Profiler_Account(&_stats, event);
+        if (NULL != raw_stream)
+        {
+            fwrite(event, sizeof(Airtight_ProfileEvent), 1, raw_stream);
+        }
+
+        read_index++;
+        count++;
+        __atomic_store_n(&_read_index, read_index, __ATOMIC_RELEASE);
+    }
+
+    _stats.dropped_events = _dropped;
+
+    return count;
+}
+
+/**
+ * Get the statistics accumulated by Airtight_Profiler_Process.
+ */
+const Airtight_ProfileStats *Airtight_Profiler_Stats(void)
+{
+    return &_stats;
+}
+
+/**
+ * Process outstanding events and print the statistics.
+ */
+void Airtight_Profiler_Dump(FILE *stream)
+{
+    Airtight_Profiler_Process(NULL);
+    Airtight_Profiler_DumpStats(&_stats, stream);
+}
+
+#endif
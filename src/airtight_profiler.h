@@ -0,0 +1,138 @@
+/**
+ * @addtogroup Airtight_Profiler
+ * @{
+ * @file
+ * AirTight: slot timeline profiler header.
+ */
+#ifndef __AIRTIGHT_PROFILER_H
+#define __AIRTIGHT_PROFILER_H
+
+#include <stdio.h>
+
+#include "airtight_types.h"
+#include "airtight_mac_config.h"
+
+/**
+ * The number of histogram buckets, bucket i counts durations in
+ * [2^(i-1), 2^i) microseconds with bucket 0 counting durations under 1us.
+ */
+#define AIRTIGHT_PROFILE_BUCKETS 24
+
+/**
+ * Measured phases of the slot timeline.
+ */
+typedef enum
+{
+    PHASE_APP_TICK,
+    PHASE_RADIO_TICK,
+    PHASE_DO_SLOT,
+    PHASE_SERIAL_WRITE,
+    PHASE_SLOT_LATENESS,
+    PHASE_SLOT_TO_WIRE,
+    AIRTIGHT_PROFILE_PHASES
+} Airtight_ProfilePhase;
+
+/**
+ * Profiler event types.
+ */
+typedef enum
+{
+    PROFILE_ENTER,
+    PROFILE_EXIT,
+    PROFILE_SLOT_START,
+    PROFILE_MISSED_SLOTS,
+    PROFILE_FRAME_ON_WIRE
+} Airtight_ProfileEventType;
+
+/**
+ * A timestamped profiler event.
+ *
+ * Value holds the lateness in microseconds for PROFILE_SLOT_START and the
+ * number of skipped slots for PROFILE_MISSED_SLOTS.
+ */
+typedef struct
+{
+    at_u32_t time_us;
+    at_u32_t value;
+    at_u8_t type;
+    at_u8_t phase;
+    at_u16_t slot;
+} Airtight_ProfileEvent;
+
+/**
+ * Latency histogram of a phase.
+ */
+typedef struct
+{
+    at_u32_t buckets[AIRTIGHT_PROFILE_BUCKETS];
+    at_u32_t count;
+    at_u32_t max_us;
+    at_u64_t total_us;
+} Airtight_ProfileHistogram;
+
+/**
+ * Statistics accumulated from profiler events.
+ */
+typedef struct
+{
+    Airtight_ProfileHistogram phases[AIRTIGHT_PROFILE_PHASES];
+    at_u32_t enter_time_us[AIRTIGHT_PROFILE_PHASES];
+    at_bool_t entered[AIRTIGHT_PROFILE_PHASES];
+    at_u32_t ideal_slot_start_us;
+    at_bool_t in_slot;
+    at_bool_t awaiting_wire;
+    at_u32_t slots;
+    at_u32_t overruns;
+    at_u32_t missed_slots;
+    at_u32_t dropped_events;
+} Airtight_ProfileStats;
+
+void Airtight_Profiler_InitStats(Airtight_ProfileStats *stats);
+void Airtight_Profiler_Account(Airtight_ProfileStats *stats, const Airtight_ProfileEvent *event);
+void Airtight_Profiler_DumpStats(const Airtight_ProfileStats *stats, FILE *stream);
+
+#if (AT_CONF_PROFILER == 1)
+
+void Airtight_Profiler_Record(Airtight_ProfileEventType type, Airtight_ProfilePhase phase, at_u16_t slot, at_u32_t value);
+size_t Airtight_Profiler_Process(FILE *raw_stream);
+const Airtight_ProfileStats *Airtight_Profiler_Stats(void);
+void Airtight_Profiler_Dump(FILE *stream);
+
+/**
+ * Mark entry to a phase.
+ */
+#define AT_PROFILE_ENTER(phase) Airtight_Profiler_Record(PROFILE_ENTER, phase, 0, 0)
+
+/**
+ * Mark exit from a phase.
+ */
+#define AT_PROFILE_EXIT(phase) Airtight_Profiler_Record(PROFILE_EXIT, phase, 0, 0)
+
+/**
+ * Mark the start of a slot and how late it started.
+ */
+#define AT_PROFILE_SLOT_START(slot, lateness_us) Airtight_Profiler_Record(PROFILE_SLOT_START, PHASE_SLOT_LATENESS, slot, lateness_us)
+
+/**
+ * Mark slots which were skipped entirely.
+ */
+#define AT_PROFILE_MISSED_SLOTS(slot, count) Airtight_Profiler_Record(PROFILE_MISSED_SLOTS, PHASE_SLOT_LATENESS, slot, count)
+
+/**
+ * Mark a frame as written to the radio's serial port.
+ */
+#define AT_PROFILE_FRAME_ON_WIRE() Airtight_Profiler_Record(PROFILE_FRAME_ON_WIRE, PHASE_SLOT_TO_WIRE, 0, 0)
+
+#else
+
+// \cond DO_NOT_DOCUMENT
+#define AT_PROFILE_ENTER(phase)
+#define AT_PROFILE_EXIT(phase)
+#define AT_PROFILE_SLOT_START(slot, lateness_us)
+#define AT_PROFILE_MISSED_SLOTS(slot, count)
+#define AT_PROFILE_FRAME_ON_WIRE()
+// \endcond
+
+#endif
+
+#endif
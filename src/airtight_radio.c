@@ -8,6 +8,8 @@
 
 // Not listed in devices.h but is listed in official documentation
 #define XBEE_FRAME_RECEIVE_16 0x81
+#define XBEE_RX_OPT_ADDRESS_BROADCAST 0x02
+#define XBEE_RX_OPT_PAN_BROADCAST 0x04
 
 typedef XBEE_PACKED(xbee_frame_receive_16_t, {
     uint8_t frame_type; ///< 16-bit Receive Packet - 0x81
@@ -32,8 +34,14 @@ int Airtight_Radio_InternalReceiveHandler(struct xbee_dev_t *xbee, const void FA
     if (NULL != _receive_handler && length >= offsetof(xbee_frame_receive_16_t, payload))
     {
         // We don't perform address-based filtering as the xbee does this.
+        const at_u8_t *source = (const at_u8_t *)&rx_frame->ieee_address;
+        Airtight_Radio_FrameInfo info;
 
-        _receive_handler((at_u8_t *)rx_frame->payload, length - offsetof(xbee_frame_receive_16_t, payload));
+        info.source = (source[0] << 8) | source[1];
+        info.rssi = rx_frame->rssi;
+        info.broadcast = (rx_frame->options & (XBEE_RX_OPT_ADDRESS_BROADCAST | XBEE_RX_OPT_PAN_BROADCAST)) != 0;
+
+        _receive_handler((at_u8_t *)rx_frame->payload, length - offsetof(xbee_frame_receive_16_t, payload), &info);
     }
 
     return 0;
@@ -103,6 +111,19 @@ at_bool_t Airtight_Radio_Init(Airtight_Radio *radio)
     if (!Airtight_Radio_CmdWait(&radio->device))
         return false;
 
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+    // The first slot sets the channel with an immediate CH.
+    radio->channel = 0;
+    radio->queued_channel = 0;
+    radio->channel_command = xbee_cmd_create(&radio->device, "CH");
+    if (radio->channel_command < 0)
+    {
+        printf("Failed to create channel command. %d\n", radio->channel_command);
+        return false;
+    }
+    xbee_cmd_set_flags(radio->channel_command, XBEE_CMD_FLAG_QUEUE_CHANGE | XBEE_CMD_FLAG_REUSE_HANDLE);
+#endif
+
     // report on the settings
     xbee_dev_dump_settings(&radio->device, XBEE_DEV_DUMP_FLAG_DEFAULT);
     return true;
@@ -123,3 +144,55 @@ void Airtight_Radio_AttachTransmitStatusHandler(Airtight_Radio_TransmitStatusHan
 {
     _transmit_status_handler = handler;
 }
+
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+/**
+ * Send the radio a channel change to be held until
+ * Airtight_Radio_ApplyChannel, so the retune at the start of a slot is a
+ * short AC command rather than a CH which waits behind this slot's frames.
+ */
+void Airtight_Radio_QueueChannel(Airtight_Radio *radio, at_u8_t channel)
+{
+    AT_ENTER(Airtight_Radio_QueueChannel);
+
+    if (channel == radio->queued_channel)
+    {
+        return;
+    }
+
+    xbee_cmd_set_param(radio->channel_command, channel);
+    if (xbee_cmd_send(radio->channel_command) == 0)
+    {
+        radio->queued_channel = channel;
+    }
+}
+
+/**
+ * Tune the radio to a slot's channel, applying the queued change if it was
+ * for this channel and otherwise changing immediately.
+ */
+void Airtight_Radio_ApplyChannel(Airtight_Radio *radio, at_u8_t channel)
+{
+    AT_ENTER(Airtight_Radio_ApplyChannel);
+
+    if (channel == radio->channel)
+    {
+        // Overwrite a change queued for a slot that was missed
+        Airtight_Radio_QueueChannel(radio, channel);
+        return;
+    }
+
+    if (channel == radio->queued_channel)
+    {
+        xbee_cmd_execute(&radio->device, "AC", NULL, 0);
+    }
+    else
+    {
+        AT_DEBUG("Airtight_Radio_ApplyChannel: channel not queued, changing immediately.");
+        xbee_cmd_simple(&radio->device, "CH", channel);
+    }
+
+    radio->channel = channel;
+    radio->queued_channel = channel;
+}
+#endif
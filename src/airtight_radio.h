@@ -12,6 +12,7 @@
 #include "airtight_utilities.h"
 #include "airtight_types.h"
 #include "airtight_mac_config.h"
+#include "airtight_slots_config.h"
 
 #include "xbee/platform.h"
 #include "xbee/device.h"
@@ -21,18 +22,38 @@
 #include "xbee/serial.h"
 #include "xbee/wpan.h"
 
-typedef void (*Airtight_Radio_ReceiveHandler)(at_u8_t *data, at_u16_t datalen);
+/**
+ * Details of a received frame from the 802.15.4 header.
+ */
+typedef struct
+{
+    at_u16_t source;
+    at_u8_t rssi;
+    at_bool_t broadcast;
+} Airtight_Radio_FrameInfo;
+
+typedef void (*Airtight_Radio_ReceiveHandler)(at_u8_t *data, at_u16_t datalen, const Airtight_Radio_FrameInfo *info);
 typedef void (*Airtight_Radio_TransmitStatusHandler)(at_u8_t packet_id, at_u8_t status);
 
 typedef struct
 {
     xbee_dev_t device;
     xbee_serial_t serial;
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+    // CH request reused for every queued change
+    int16_t channel_command;
+    at_u8_t channel;
+    at_u8_t queued_channel;
+#endif
 } Airtight_Radio;
 
 at_bool_t Airtight_Radio_Init(Airtight_Radio *radio);
 void Airtight_Radio_DeviceTick(Airtight_Radio *radio);
 void Airtight_Radio_AttachReceiveHandler(Airtight_Radio_ReceiveHandler handler);
 void Airtight_Radio_AttachTransmitStatusHandler(Airtight_Radio_TransmitStatusHandler handler);
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+void Airtight_Radio_QueueChannel(Airtight_Radio *radio, at_u8_t channel);
+void Airtight_Radio_ApplyChannel(Airtight_Radio *radio, at_u8_t channel);
+#endif
 
 #endif
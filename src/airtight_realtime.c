@@ -0,0 +1,126 @@
+/**
+ * @addtogroup Airtight_Slotter
+ * @{
+ * @file
+ * AirTight: real-time execution mode for the slotter implementation.
+ *
+ * PORT: Linux specific, bare-metal ports are already real-time.
+ */
+#define _GNU_SOURCE
+
+#include "airtight_realtime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+/**
+ * Fill in an Airtight_RealtimeConfig from the AT_CONF_REALTIME_* macros.
+ */
+void Airtight_Realtime_DefaultConfig(Airtight_RealtimeConfig *config)
+{
+    config->priority = AT_CONF_REALTIME_PRIORITY;
+    config->cpu = AT_CONF_REALTIME_CPU;
+    config->stack_prefault = AT_CONF_REALTIME_STACK_PREFAULT;
+    config->heap_prefault = AT_CONF_REALTIME_HEAP_PREFAULT;
+}
+
+/**
+ * Touch the stack below the caller so later slot processing never takes a
+ * page fault growing it.
+ *
+ * Not inlined so the frame is really allocated below the caller's.
+ */
+static void __attribute__((noinline)) Airtight_Realtime_PrefaultStack(size_t size)
+{
+    volatile unsigned char stack[size];
+
+    for (size_t i = 0; i < size; i += 256)
+    {
+        stack[i] = 0;
+    }
+
+    // Keep the frame alive until the loop has completed.
+    __asm__ volatile("" : : "r"(stack) : "memory");
+}
+
+/**
+ * Touch heap memory and stop the allocator handing it back, so allocations
+ * made by the integration, e.g. the XBee library, after entering are served
+ * from locked, resident pages.
+ */
+static at_bool_t Airtight_Realtime_PrefaultHeap(size_t size)
+{
+    if (!mallopt(M_TRIM_THRESHOLD, -1) || !mallopt(M_MMAP_MAX, 0))
+    {
+        return false;
+    }
+
+    unsigned char *heap = malloc(size);
+    if (NULL == heap)
+    {
+        return false;
+    }
+
+    memset(heap, 0, size);
+    free(heap);
+
+    return true;
+}
+
+/**
+ * Put the calling thread, which must run the slotter, into real-time mode.
+ *
+ * In order:
+ *  - locks all current and future pages in memory,
+ *  - pre-faults the stack and heap,
+ *  - pins the thread to a CPU if one is configured,
+ *  - sets SCHED_FIFO scheduling at the configured priority.
+ *
+ * Every step is attempted even if an earlier one fails.
+ *
+ * @return true if every step succeeded, false otherwise
+ * @note SCHED_FIFO and mlockall usually need CAP_SYS_NICE and CAP_IPC_LOCK.
+ */
+at_bool_t Airtight_Realtime_Enter(const Airtight_RealtimeConfig *config)
+{
+    at_bool_t success = true;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        puts("Realtime: failed to lock memory.");
+        success = false;
+    }
+
+    Airtight_Realtime_PrefaultStack(config->stack_prefault);
+
+    if (!Airtight_Realtime_PrefaultHeap(config->heap_prefault))
+    {
+        puts("Realtime: failed to pre-fault heap.");
+        success = false;
+    }
+
+    if (config->cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config->cpu, &cpus);
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+        {
+            printf("Realtime: failed to pin to CPU %d.\n", config->cpu);
+            success = false;
+        }
+    }
+
+    struct sched_param param = {.sched_priority = config->priority};
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0)
+    {
+        printf("Realtime: failed to set SCHED_FIFO priority %d.\n", config->priority);
+        success = false;
+    }
+
+    return success;
+}
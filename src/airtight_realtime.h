@@ -0,0 +1,29 @@
+/**
+ * @addtogroup Airtight_Slotter
+ * @{
+ * @file
+ * AirTight: real-time execution mode for the slotter header.
+ */
+#ifndef __AIRTIGHT_REALTIME_H
+#define __AIRTIGHT_REALTIME_H
+
+#include <stddef.h>
+
+#include "airtight_types.h"
+#include "airtight_mac_config.h"
+
+/**
+ * Parameters of real-time mode, see Airtight_Realtime_DefaultConfig.
+ */
+typedef struct
+{
+    int priority;
+    int cpu;
+    size_t stack_prefault;
+    size_t heap_prefault;
+} Airtight_RealtimeConfig;
+
+void Airtight_Realtime_DefaultConfig(Airtight_RealtimeConfig *config);
+at_bool_t Airtight_Realtime_Enter(const Airtight_RealtimeConfig *config);
+
+#endif
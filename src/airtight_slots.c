@@ -7,20 +7,134 @@
 #include "airtight_slots.h"
 
 // \cond DO_NOT_DOCUMENT
-#define SLOT_TABLE const Airtight_SlotTable slot_table[AT_CONF_SLOT_TABLE_COLUMNS]
 #define IDLE ACTION_IDLE
 #define LISTEN ACTION_LISTEN
 #define TRANSMIT ACTION_TRANSMIT
+#define SECONDARY ACTION_SECONDARY
+#define BEST_EFFORT ACTION_BEST_EFFORT
+// \endcond
+
+#if (AT_CONF_SLOT_SUBFRAMES > 1)
+// \cond DO_NOT_DOCUMENT
+#define SLOT_TABLE const Airtight_SlotTable slot_table[AT_CONF_SLOT_SUBFRAMES][AT_CONF_SLOT_TABLE_COLUMNS]
+// \endcond
+
+#include "airtight_slot_subframes.txt"
+
+/**
+ * The sub-frame of a slot.
+ *
+ * local_slot and the slot's row advance together, so their difference only
+ * grows by a cycle's rows when the row wraps and counts cycles. Nodes share
+ * both once synchronised and so agree on the sub-frame. The sequence
+ * restarts when local_slot wraps.
+ */
+static inline const Airtight_SlotTable *Airtight_SlotSubframe(at_u16_t local_slot, at_u8_t slot)
+{
+    const at_u16_t cycle = (at_u16_t)(local_slot - slot) / AT_CONF_SLOT_TABLE_ROWS;
+
+    return slot_table[cycle % AT_CONF_SLOT_SUBFRAMES];
+}
+#else
+// \cond DO_NOT_DOCUMENT
+#define SLOT_TABLE const Airtight_SlotTable slot_table[AT_CONF_SLOT_TABLE_COLUMNS]
+#define Airtight_SlotSubframe(local_slot, slot) ((void)(local_slot), (void)(slot), slot_table)
 // \endcond
 
 #include "airtight_slot_table.txt"
+#endif
+
+#if (AT_CONF_MODE_SCHEDULES == 1)
+// \cond DO_NOT_DOCUMENT
+#undef SLOT_TABLE
+#define SLOT_TABLE const Airtight_SlotTable high_slot_table[AT_CONF_SLOT_TABLE_COLUMNS]
+// \endcond
 
-at_bool_t Airtight_SlotShouldReceive(at_u8_t slot)
+#include "airtight_slot_table_high.txt"
+
+/**
+ * The slot table of a schedule mode, HIGH mode has a single cycle.
+ */
+static inline const Airtight_SlotTable *Airtight_SlotSchedule(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot)
 {
-    return slot_table[AT_CONF_NODE_ID].slots[slot] == LISTEN;
+    return mode == HIGH_CRIT ? high_slot_table : Airtight_SlotSubframe(local_slot, slot);
+}
+#else
+// \cond DO_NOT_DOCUMENT
+#define Airtight_SlotSchedule(mode, local_slot, slot) ((void)(mode), Airtight_SlotSubframe(local_slot, slot))
+// \endcond
+#endif
+
+at_bool_t Airtight_SlotShouldReceive(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot)
+{
+    const Airtight_SlotAction action = Airtight_SlotSchedule(mode, local_slot, slot)[AT_CONF_NODE_ID].slots[slot];
+
+    return action == LISTEN || action == SECONDARY || action == BEST_EFFORT;
 }
 
-Airtight_SlotAction Airtight_GetSlotAction(at_u8_t slot)
+Airtight_SlotAction Airtight_GetSlotAction(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot)
 {
-    return slot_table[AT_CONF_NODE_ID].slots[slot];
+    return Airtight_SlotSchedule(mode, local_slot, slot)[AT_CONF_NODE_ID].slots[slot];
+}
+
+/**
+ * Whether a node may transmit in a slot, as its owner, its secondary owner
+ * or by contention. Nodes without a column never transmit.
+ */
+at_bool_t Airtight_SlotTransmitter(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot, Airtight_NodeId node)
+{
+    if (node >= AT_CONF_SLOT_TABLE_COLUMNS)
+    {
+        return false;
+    }
+
+    const Airtight_SlotAction action = Airtight_SlotSchedule(mode, local_slot, slot)[node].slots[slot];
+
+    return action == TRANSMIT || action == SECONDARY || action == BEST_EFFORT;
+}
+
+/**
+ * Whether any node is the secondary owner of a slot.
+ */
+at_bool_t Airtight_SlotHasSecondary(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot)
+{
+    const Airtight_SlotTable *table = Airtight_SlotSchedule(mode, local_slot, slot);
+
+    for (at_u16_t node = 0; node < AT_CONF_SLOT_TABLE_COLUMNS; node++)
+    {
+        if (table[node].slots[slot] == SECONDARY)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+// \cond DO_NOT_DOCUMENT
+#define CHANNEL_OFFSETS const Airtight_ChannelOffsets channel_offsets[AT_CONF_SLOT_TABLE_COLUMNS]
+// \endcond
+
+#include "airtight_slot_channels.txt"
+
+static const at_u8_t channel_sequence[] = AT_CONF_CHANNEL_SEQUENCE;
+
+/**
+ * The channel of a slot, TSCH style.
+ *
+ * Adding local_slot moves every link along the sequence each slot, so a
+ * link that loses a slot to interference on one channel retries on
+ * another. Links with different offsets in the same row are on different
+ * channels and can transmit in parallel.
+ */
+at_u8_t Airtight_GetSlotChannel(at_u16_t local_slot, at_u8_t slot)
+{
+    if (slot == AT_CONF_SYNC_SLOT_INDEX)
+    {
+        return channel_sequence[0];
+    }
+
+    return channel_sequence[(local_slot + channel_offsets[AT_CONF_NODE_ID].offsets[slot]) % sizeof(channel_sequence)];
 }
+#endif
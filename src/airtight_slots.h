@@ -16,7 +16,11 @@ typedef enum
 {
     ACTION_IDLE,
     ACTION_LISTEN,
-    ACTION_TRANSMIT
+    ACTION_TRANSMIT,
+    // Listens, and transmits when the slot's owner lends it
+    ACTION_SECONDARY,
+    // Listens, and contends for the slot with bulk packets
+    ACTION_BEST_EFFORT
 } Airtight_SlotAction;
 
 typedef struct
@@ -24,8 +28,32 @@ typedef struct
     Airtight_SlotAction slots[AT_CONF_SLOT_TABLE_ROWS];
 } Airtight_SlotTable;
 
-at_bool_t Airtight_SlotShouldReceive(at_u8_t slot);
-Airtight_SlotAction Airtight_GetSlotAction(at_u8_t slot);
+/**
+ * A node's channel offset for each slot table row.
+ */
+typedef struct
+{
+    at_u8_t offsets[AT_CONF_SLOT_TABLE_ROWS];
+} Airtight_ChannelOffsets;
+
+/**
+ * Number of slots in the hyperperiod, after which the schedule repeats.
+ */
+#define AIRTIGHT_HYPERPERIOD_SLOTS (AT_CONF_SLOT_SUBFRAMES * AT_CONF_SLOT_TABLE_ROWS)
+
+// Distances within the hyperperiod, such as Airtight_SlotsUntilTransmit's,
+// are returned in 8 bits, so a hyperperiod of exactly 255 slots is allowed.
+#if (AIRTIGHT_HYPERPERIOD_SLOTS > 255)
+#error The hyperperiod must fit in 255 slots.
+#endif
+
+at_bool_t Airtight_SlotShouldReceive(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot);
+Airtight_SlotAction Airtight_GetSlotAction(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot);
+at_bool_t Airtight_SlotTransmitter(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot, Airtight_NodeId node);
+at_bool_t Airtight_SlotHasSecondary(Airtight_Criticality mode, at_u16_t local_slot, at_u8_t slot);
+#if (AT_CONF_CHANNEL_HOPPING == 1)
+at_u8_t Airtight_GetSlotChannel(at_u16_t local_slot, at_u8_t slot);
+#endif
 
 
 #endif
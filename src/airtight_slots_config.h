@@ -17,4 +17,50 @@
  */
 #define AT_CONF_SLOT_TABLE_COLUMNS 3
 
+/**
+ * Number of sub-frames in the hyperperiod, each a full cycle of the slot
+ * table rows with its own actions. With more than 1 the table is read from
+ * airtight_slot_subframes.txt.
+ */
+#ifndef AT_CONF_SLOT_SUBFRAMES
+#define AT_CONF_SLOT_SUBFRAMES 1
+#endif
+
+/**
+ * Whether HIGH criticality mode uses its own slot table, read from
+ * airtight_slot_table_high.txt. Nodes announce switches between the tables
+ * with notifications.
+ */
+#ifndef AT_CONF_MODE_SCHEDULES
+#define AT_CONF_MODE_SCHEDULES 0
+#endif
+
+/**
+ * Whether a node with nothing to send in its transmit slot lends it to the
+ * slot's secondary owner, marked SECONDARY in the slot table.
+ */
+#ifndef AT_CONF_SLOT_LENDING
+#define AT_CONF_SLOT_LENDING 1
+#endif
+
+/**
+ * Whether slots hop across 802.15.4 channels. Each node's channel offset per
+ * row is read from airtight_slot_channels.txt and a slot's channel is the
+ * entry of AT_CONF_CHANNEL_SEQUENCE at its offset plus local_slot. A link
+ * uses its transmitter's offset, so a listener must share it, which
+ * airtight_analyse -c checks.
+ */
+#ifndef AT_CONF_CHANNEL_HOPPING
+#define AT_CONF_CHANNEL_HOPPING 0
+#endif
+
+/**
+ * Channels hopped across, 0x0C to 0x17 are usable by both the XBee and
+ * XBee-PRO. The sync slot always uses the first, and nodes which have not
+ * heard a sync yet stay on it so they hear the next one.
+ */
+#ifndef AT_CONF_CHANNEL_SEQUENCE
+#define AT_CONF_CHANNEL_SEQUENCE {0x0C, 0x11, 0x16, 0x0E, 0x13, 0x0F, 0x14, 0x17}
+#endif
+
 #endif
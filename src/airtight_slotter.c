@@ -30,10 +30,23 @@ void Airtight_Slotter_SingleThreadedSlotterTick(Airtight_MACState *mac_state,
         (*slot)++;
         if (*slot >= AT_CONF_SLOT_TABLE_ROWS)
             *slot = 0;
+
+        if (*counter != 0 && (current_time / AT_CONF_SLOT_LENGTH_MS) - *counter > 1)
+        {
+            AT_PROFILE_MISSED_SLOTS(*slot, (current_time / AT_CONF_SLOT_LENGTH_MS) - *counter - 1);
+        }
+        AT_PROFILE_SLOT_START(*slot, (current_time % AT_CONF_SLOT_LENGTH_MS) * 1000);
+
+        AT_PROFILE_ENTER(PHASE_DO_SLOT);
         Airtight_DoSlot(mac_state, *slot);
+        AT_PROFILE_EXIT(PHASE_DO_SLOT);
         *counter = current_time / AT_CONF_SLOT_LENGTH_MS;
     }
 
+#if (AT_CONF_BEST_EFFORT == 1)
+    Airtight_DoSubSlot(mac_state, (current_time % AT_CONF_SLOT_LENGTH_MS) * AT_CONF_BEST_EFFORT_SUBSLOTS / AT_CONF_SLOT_LENGTH_MS);
+#endif
+
     // We make sure a full ms has passed as our time is monotonic and could be artificially
     // inflated if the slotter loop runs too quickly!
     Airtight_Time_1ms();
@@ -10,6 +10,7 @@
 #include "airtight_types.h"
 #include "airtight_mac.h"
 #include "airtight_time.h"
+#include "airtight_profiler.h"
 
 void Airtight_Slotter_SingleThreadedSlotterTick(Airtight_MACState *mac_state,
                                                 at_u8_t *slot,
@@ -4,6 +4,8 @@
  * @file
  * AirTight: time related functions including alarms and clock implementations.
  */
+#define _POSIX_C_SOURCE 199309L
+
 #include "airtight_time.h"
 
 /**
@@ -83,6 +85,19 @@ void Airtight_Time_1ms()
     }
 }
 
+/**
+ * Get a monotonic clock in microseconds for measurements.
+ *
+ * Wraps roughly every 71 minutes so only differences should be used.
+ */
+at_u32_t Airtight_Time_MonotonicUS()
+{
+    // PORT: some platforms may use a hardware timer or cycle counter.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (at_u32_t)now.tv_sec * 1000000u + (at_u32_t)(now.tv_nsec / 1000);
+}
+
 // PORT: Alarms may be implemented in hardware on platforms which support this.
 
 /**
@@ -33,6 +33,7 @@ void Airtight_Time_Init(Airtight_Time *time);
 at_time_t Airtight_Time_GetSynchronisedTime(Airtight_Time *time);
 void Airtight_Time_SetSynchronisationPoint(Airtight_Time *time, at_time_t sync_time);
 void Airtight_Time_1ms();
+at_u32_t Airtight_Time_MonotonicUS();
 
 void Airtight_Time_SetAlarm(Airtight_Alarm *alarm, at_time_t in);
 void Airtight_Time_ClearAlarm(Airtight_Alarm *alarm);
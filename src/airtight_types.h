@@ -32,6 +32,11 @@ typedef uint16_t at_u16_t;
  */
 typedef uint32_t at_u32_t;
 
+/**
+ * 64-bit unsigned type.
+ */
+typedef uint64_t at_u64_t;
+
 /**
  * 16-bit signed type.
  */
@@ -67,14 +72,46 @@ typedef at_u16_t Airtight_Priority;
 #endif
 
 /**
- * Criticality levels, typically HIGH and LOW.
+ * Number of criticality levels.
+ */
+#ifndef AIRTIGHT_CRITICALITY_LEVELS
+#define AIRTIGHT_CRITICALITY_LEVELS 2
+#endif
+
+#if (AIRTIGHT_CRITICALITY_LEVELS < 2 || AIRTIGHT_CRITICALITY_LEVELS > 8)
+#error AIRTIGHT_CRITICALITY_LEVELS must be from 2 to 8.
+#endif
+
+/**
+ * Criticality levels, from HIGH, level 0, to LOW, the last level. Any levels
+ * in between are referred to by number.
  */
 typedef enum
 {
-    HIGH_CRIT,
-    LOW_CRIT
+    HIGH_CRIT = 0,
+    LOW_CRIT = AIRTIGHT_CRITICALITY_LEVELS - 1
 } Airtight_Criticality;
 
+/**
+ * A set of criticality levels, bit n for level n.
+ */
+typedef at_u8_t Airtight_CriticalityMask;
+
+/**
+ * The set holding only a level.
+ */
+#define AIRTIGHT_CRITICALITY_BIT(level) ((Airtight_CriticalityMask)(1u << (level)))
+
+/**
+ * The set of levels at least as critical as a level.
+ */
+#define AIRTIGHT_CRITICALITY_AT_LEAST(level) ((Airtight_CriticalityMask)((2u << (level)) - 1u))
+
+/**
+ * The set of every level.
+ */
+#define AIRTIGHT_CRITICALITY_ALL AIRTIGHT_CRITICALITY_AT_LEAST(LOW_CRIT)
+
 /**
  * Node ID type.
  */
@@ -10,8 +10,11 @@
 #include <stdio.h>
 
 #include "airtight_packet.h"
+#include "airtight_mac_config.h"
 
+#if (AT_CONF_DEBUG == 1)
 #define AIRTIGHT_DEBUG
+#endif
 
 void Airtight_PrintPacket(Airtight_Packet *packet);
 
@@ -0,0 +1,180 @@
+/**
+ * @file
+ * AirTight: offline schedulability report for a slot table, routes and flows.
+ *
+ * Prints each flow's worst-case end-to-end response time and slack in LOW
+ * and HIGH criticality mode, see airtight_rta.c for the analysis, and
+ * whether every flow meets its deadline. Flows are read as for
+ * airtight_schedule with an optional deadline and priority.
+ *
+ * Rows with several transmitters are checked against the interference
+ * graph, as INTERFERES(a, b) lines, and every hop receiver that hears more
+ * than its sender is listed as a conflict. Given channel offsets with -c,
+ * only transmitters on a receiver's channel count against it, and every
+ * hop receiver not listening on its sender's channel is listed.
+ *
+ * Usage: airtight_analyse [-v] [-s slot_ms] [-c channels.txt] <slot_table>
+ *                         <routes.txt> <flows.txt> [interference.txt]
+ *
+ * Only flows missing a deadline are listed unless -v is given. Exits with 1
+ * if any flow misses its deadline, any row has a conflict or any receiver
+ * is on the wrong channel.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "airtight_rta.h"
+
+static Airtight_RtaNetwork network;
+static Airtight_RtaResult results[AT_RTA_MAX_FLOWS];
+
+/**
+ * Most conflicts listed.
+ */
+#define ANALYSE_MAX_CONFLICTS 64
+
+static Airtight_RtaConflict conflicts[ANALYSE_MAX_CONFLICTS];
+static Airtight_RtaChannelMismatch mismatches[ANALYSE_MAX_CONFLICTS];
+
+static void Analyse_PrintMode(const Airtight_RtaResult *result, Airtight_Criticality mode)
+{
+    const char *name = mode == HIGH_CRIT ? "HIGH" : "LOW";
+
+    if (!result->analysed[mode])
+    {
+        printf(" %s shed", name);
+    }
+    else if (!result->bounded[mode])
+    {
+        printf(" %s unbounded", name);
+    }
+    else
+    {
+        printf(" %s response=%lums slack=%ldms", name, (unsigned long)result->response_ms[mode], (long)result->slack_ms[mode]);
+    }
+}
+
+/**
+ * Print a mode's worst slack, unbounded if any of its flows is.
+ */
+static void Analyse_PrintWorstSlack(Airtight_Criticality mode, at_bool_t unbounded, at_i32_t slack_ms)
+{
+    const char *name = mode == HIGH_CRIT ? "HIGH" : "LOW";
+
+    if (unbounded)
+    {
+        printf(" %s=unbounded", name);
+    }
+    else
+    {
+        printf(" %s=%ldms", name, (long)(slack_ms == INT32_MAX ? 0 : slack_ms));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *paths[4] = {NULL, NULL, NULL, NULL};
+    const char *channels_path = NULL;
+    at_bool_t verbose = false;
+    at_u32_t slot_ms = 0;
+    int path_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            slot_ms = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            channels_path = argv[++i];
+        }
+        else if (path_count < 4)
+        {
+            paths[path_count++] = argv[i];
+        }
+    }
+
+    if (path_count < 3)
+    {
+        fprintf(stderr, "Usage: %s [-v] [-s slot_ms] [-c channels.txt] <slot_table> <routes.txt> <flows.txt> [interference.txt]\n", argv[0]);
+        return 2;
+    }
+
+    Airtight_Rta_InitNetwork(&network);
+    if (slot_ms > 0)
+    {
+        network.slot_ms = slot_ms;
+    }
+
+    if (Airtight_Rta_ReadSlotTable(&network, paths[0]) || Airtight_Rta_ReadRoutes(&network, paths[1]) ||
+        Airtight_Rta_ReadFlows(&network, paths[2]) || (NULL != paths[3] && Airtight_Rta_ReadInterference(&network, paths[3])) ||
+        (NULL != channels_path && Airtight_Rta_ReadChannelOffsets(&network, channels_path)))
+    {
+        return 2;
+    }
+
+    const at_u32_t conflict_count = Airtight_Rta_CheckReuse(&network, conflicts, ANALYSE_MAX_CONFLICTS);
+    for (at_u32_t c = 0; c < conflict_count && c < ANALYSE_MAX_CONFLICTS; c++)
+    {
+        printf("CONFLICT row=%u %u->%u hears %u\n", conflicts[c].row, conflicts[c].transmitter, conflicts[c].receiver, conflicts[c].interferer);
+    }
+
+    const at_u32_t mismatch_count = Airtight_Rta_CheckChannels(&network, mismatches, ANALYSE_MAX_CONFLICTS);
+    for (at_u32_t m = 0; m < mismatch_count && m < ANALYSE_MAX_CONFLICTS; m++)
+    {
+        printf("CHANNEL row=%u %u->%u offsets %u and %u\n", mismatches[m].row, mismatches[m].transmitter, mismatches[m].receiver,
+               network.channel_offsets[mismatches[m].transmitter][mismatches[m].row],
+               network.channel_offsets[mismatches[m].receiver][mismatches[m].row]);
+    }
+
+    const clock_t start = clock();
+    const at_bool_t schedulable = Airtight_Rta_Analyse(&network, results);
+    const double elapsed_ms = 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    at_i32_t worst_slack[AT_RTA_MODES] = {INT32_MAX, INT32_MAX};
+    at_bool_t unbounded[AT_RTA_MODES] = {false, false};
+    for (at_u16_t f = 0; f < network.flow_count; f++)
+    {
+        const Airtight_RtaFlow *flow = &network.flows[f];
+        const Airtight_RtaResult *result = &results[f];
+        at_bool_t missed = false;
+
+        for (at_u8_t mode = 0; mode < AT_RTA_MODES; mode++)
+        {
+            if (!result->analysed[mode])
+            {
+                continue;
+            }
+
+            missed = missed || !result->bounded[mode] || result->slack_ms[mode] < 0;
+            unbounded[mode] = unbounded[mode] || !result->bounded[mode];
+            if (result->bounded[mode] && result->slack_ms[mode] < worst_slack[mode])
+            {
+                worst_slack[mode] = result->slack_ms[mode];
+            }
+        }
+
+        if (verbose || missed)
+        {
+            printf("FLOW %u %u->%u hops=%u priority=%u %s deadline=%lums", f, flow->source, flow->destination, flow->hops,
+                   flow->priority, flow->criticality == HIGH_CRIT ? "HIGH" : "LOW", (unsigned long)flow->deadline_ms);
+            Analyse_PrintMode(result, LOW_CRIT);
+            Analyse_PrintMode(result, HIGH_CRIT);
+            printf("%s\n", missed ? " MISS" : "");
+        }
+    }
+
+    printf("RTA flows=%u rows=%u conflicts=%lu channel_mismatches=%lu schedulable=%s worst_slack", network.flow_count, network.rows,
+           (unsigned long)conflict_count, (unsigned long)mismatch_count, schedulable ? "yes" : "no");
+    Analyse_PrintWorstSlack(LOW_CRIT, unbounded[LOW_CRIT], worst_slack[LOW_CRIT]);
+    Analyse_PrintWorstSlack(HIGH_CRIT, unbounded[HIGH_CRIT], worst_slack[HIGH_CRIT]);
+    printf(" analysis=%.1fms\n", elapsed_ms);
+
+    return schedulable && conflict_count == 0 && mismatch_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file
+ * AirTight: offline report tool for slot timeline profiles.
+ *
+ * Reads the raw events written by Airtight_Profiler_Process, as saved to
+ * airtight_profile.bin by the example integration, and prints per phase
+ * latency histograms along with slot overrun and missed slot counts.
+ *
+ * Usage: airtight_profile_report [-v] <airtight_profile.bin>
+ *
+ * With -v every slot whose DoSlot phase overran is also listed.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "airtight_profiler.h"
+
+int main(int argc, char **argv)
+{
+    at_bool_t verbose = false;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    if (NULL == path)
+    {
+        fprintf(stderr, "Usage: %s [-v] <airtight_profile.bin>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *raw = fopen(path, "rb");
+    if (NULL == raw)
+    {
+        perror(path);
+        return 1;
+    }
+
+    Airtight_ProfileStats stats;
+    Airtight_ProfileEvent event;
+    Airtight_Profiler_InitStats(&stats);
+
+    at_u32_t events = 0;
+    at_u16_t slot = 0;
+    while (fread(&event, sizeof(event), 1, raw) == 1)
+    {
+        const at_u32_t overruns = stats.overruns;
+
+        if (event.type == PROFILE_SLOT_START)
+        {
+            slot = event.slot;
+        }
+
+        Airtight_Profiler_Account(&stats, &event);
+        events++;
+
+        if (verbose && stats.overruns != overruns)
+        {
+            printf("OVERRUN slot=%u start_us=%u end_us=%u\n", slot, stats.ideal_slot_start_us, event.time_us);
+        }
+    }
+    fclose(raw);
+
+    printf("PROFILE events=%u\n", events);
+    Airtight_Profiler_DumpStats(&stats, stdout);
+
+    return 0;
+}
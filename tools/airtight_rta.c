@@ -0,0 +1,984 @@
+/**
+ * @file
+ * AirTight: offline response time analysis implementation.
+ *
+ * Each hop of a flow is analysed as a fixed priority queue served by the
+ * transmitting node's slots, one frame per slot. A hop's response is the
+ * shortest window in which the node's guaranteed transmit slots cover the
+ * frames of flows through it at the same or more urgent priority released
+ * in the window, plus one frame of blocking by a less urgent frame already
+ * handed to the radio. Release jitter at each hop is the sum of the
+ * responses at the hops before it, less the slot each takes at best, and is
+ * propagated until it settles. Every flow through a node is taken to
+ * release together, so the bounds can be far above the latency of a lone
+ * packet, see airtight_schedule.
+ *
+ * A flow's packet is sent as its c_value burst copies. In LOW mode links
+ * are taken as fault free, so each copy is sent once per hop. In HIGH mode
+ * LOW flows are shed, each copy may use its retransmission limit, and each
+ * fault interval loses the node's slots in one fault length. Response
+ * times are until every copy has crossed every hop.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "airtight_rta.h"
+
+/**
+ * Largest text slot table read.
+ */
+#define RTA_MAX_TABLE_TEXT (1024 * 1024)
+
+#define RTA_BINARY_VERSION 1
+#define RTA_BINARY_HEADER 10
+
+typedef struct
+{
+    at_u16_t flow;
+    at_u8_t hop;
+} Airtight_RtaVisit;
+
+static at_u16_t supply[AT_RTA_MAX_NODES][AT_RTA_MAX_ROWS + 1];
+static at_u16_t supply_per_cycle[AT_RTA_MAX_NODES];
+static at_u16_t fault_slots[AT_RTA_MAX_NODES];
+static at_bool_t sends[AT_RTA_MAX_NODES];
+static at_u32_t visit_start[AT_RTA_MAX_NODES + 1];
+static Airtight_RtaVisit visits[AT_RTA_MAX_FLOWS * AT_RTA_MAX_HOPS];
+static at_u32_t jitter[AT_RTA_MAX_FLOWS][AT_RTA_MAX_HOPS];
+static at_bool_t routed[AT_RTA_MAX_FLOWS];
+static at_bool_t widened[AT_RTA_MAX_FLOWS];
+static at_bool_t sends_to[AT_RTA_MAX_NODES][AT_RTA_MAX_NODES];
+static Airtight_NodeId row_transmitters[AT_RTA_MAX_NODES];
+static const at_u8_t channel_sequence[] = AT_CONF_CHANNEL_SEQUENCE;
+
+void Airtight_Rta_InitNetwork(Airtight_RtaNetwork *network)
+{
+    memset(network, 0, sizeof(Airtight_RtaNetwork));
+    memset(network->next_hop, 0xFF, sizeof(network->next_hop));
+    network->slot_ms = AT_CONF_SLOT_LENGTH_MS;
+    network->fault_interval_slots = AT_CONF_FAULT_PERIOD_INTERVAL_SLOTS;
+    network->fault_length_slots = AT_CONF_FAULT_LENGTH_SLOTS;
+    network->retransmission_limits[HIGH_CRIT] = AT_CONF_RETRANSMISSION_LIMIT_HIGH;
+    network->retransmission_limits[LOW_CRIT] = AT_CONF_RETRANSMISSION_LIMIT_LOW;
+    network->max_c_value = AT_CONF_MAX_C_VALUE;
+}
+
+at_bool_t Airtight_Rta_StripComment(char *line)
+{
+    char *comment = strstr(line, "/*");
+    if (NULL == comment)
+    {
+        comment = strstr(line, "//");
+    }
+    if (NULL != comment)
+    {
+        *comment = '\0';
+    }
+
+    return strspn(line, " \t\r\n") != strlen(line);
+}
+
+static int Airtight_Rta_ReadBinaryTable(Airtight_RtaNetwork *network, FILE *file, const char *path)
+{
+    at_u8_t header[RTA_BINARY_HEADER];
+
+    if (fread(header, sizeof(header), 1, file) != 1 || memcmp(header, "ATST", 4) != 0 || header[4] != RTA_BINARY_VERSION)
+    {
+        fprintf(stderr, "%s: not a version %u ATST slot table\n", path, RTA_BINARY_VERSION);
+        return 1;
+    }
+
+    network->rows = header[6] | (header[7] << 8);
+    network->columns = header[8] | (header[9] << 8);
+    if (network->rows == 0 || network->rows > AT_RTA_MAX_ROWS || network->columns > AT_RTA_MAX_NODES)
+    {
+        fprintf(stderr, "%s: %u rows by %u columns is too large\n", path, network->rows, network->columns);
+        return 1;
+    }
+
+    for (at_u16_t n = 0; n < network->columns; n++)
+    {
+        for (at_u16_t row = 0; row < network->rows; row++)
+        {
+            const int action = fgetc(file);
+            if (action < ACTION_IDLE || action > ACTION_BEST_EFFORT)
+            {
+                fprintf(stderr, "%s: truncated or invalid action\n", path);
+                return 1;
+            }
+            network->actions[n][row] = (Airtight_SlotAction)action;
+        }
+    }
+
+    return 0;
+}
+
+static int Airtight_Rta_ReadTextTable(Airtight_RtaNetwork *network, FILE *file, const char *path)
+{
+    char *text = malloc(RTA_MAX_TABLE_TEXT + 1);
+    if (NULL == text)
+    {
+        return 1;
+    }
+
+    const size_t length = fread(text, 1, RTA_MAX_TABLE_TEXT, file);
+    text[length] = '\0';
+
+    at_u16_t row = 0;
+    at_bool_t in_column = false;
+    int result = 0;
+    network->rows = 0;
+    network->columns = 0;
+
+    for (char *c = text; *c != '\0' && result == 0;)
+    {
+        if (strncmp(c, "/*", 2) == 0)
+        {
+            char *end = strstr(c + 2, "*/");
+            c = NULL == end ? c + strlen(c) : end + 2;
+        }
+        else if (strncmp(c, "{{", 2) == 0)
+        {
+            if (network->columns == AT_RTA_MAX_NODES)
+            {
+                fprintf(stderr, "%s: more than %u columns\n", path, AT_RTA_MAX_NODES);
+                result = 1;
+            }
+            in_column = true;
+            row = 0;
+            c += 2;
+        }
+        else if (strncmp(c, "}}", 2) == 0)
+        {
+            if (network->columns == 0)
+            {
+                network->rows = row;
+            }
+            if (!in_column || row == 0 || row != network->rows)
+            {
+                fprintf(stderr, "%s: column %u has %u rows, expected %u\n", path, network->columns, row, network->rows);
+                result = 1;
+            }
+            in_column = false;
+            network->columns++;
+            c += 2;
+        }
+        else if (in_column && (strncmp(c, "IDLE", 4) == 0 || strncmp(c, "LISTEN", 6) == 0 || strncmp(c, "TRANSMIT", 8) == 0 ||
+                               strncmp(c, "SECONDARY", 9) == 0 || strncmp(c, "BEST_EFFORT", 11) == 0))
+        {
+            if (row == AT_RTA_MAX_ROWS)
+            {
+                fprintf(stderr, "%s: more than %u rows\n", path, AT_RTA_MAX_ROWS);
+                result = 1;
+                break;
+            }
+
+            if (*c == 'I')
+            {
+                network->actions[network->columns][row++] = ACTION_IDLE;
+                c += 4;
+            }
+            else if (*c == 'L')
+            {
+                network->actions[network->columns][row++] = ACTION_LISTEN;
+                c += 6;
+            }
+            else if (*c == 'B')
+            {
+                network->actions[network->columns][row++] = ACTION_BEST_EFFORT;
+                c += 11;
+            }
+            else if (*c == 'S')
+            {
+                network->actions[network->columns][row++] = ACTION_SECONDARY;
+                c += 9;
+            }
+            else
+            {
+                network->actions[network->columns][row++] = ACTION_TRANSMIT;
+                c += 8;
+            }
+        }
+        else
+        {
+            c++;
+        }
+    }
+
+    free(text);
+
+    if (result == 0 && network->columns == 0)
+    {
+        fprintf(stderr, "%s: no slot table found\n", path);
+        result = 1;
+    }
+
+    return result;
+}
+
+int Airtight_Rta_ReadSlotTable(Airtight_RtaNetwork *network, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    const int first = fgetc(file);
+    rewind(file);
+
+    const int result = first == 'A' ? Airtight_Rta_ReadBinaryTable(network, file, path) : Airtight_Rta_ReadTextTable(network, file, path);
+    fclose(file);
+
+    return result;
+}
+
+int Airtight_Rta_ReadRoutes(Airtight_RtaNetwork *network, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    char line[256];
+    unsigned line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned id, destination, hop;
+        line_number++;
+
+        if (!Airtight_Rta_StripComment(line))
+        {
+            continue;
+        }
+
+        if (sscanf(line, " HOP ( %u , %u , %u )", &id, &destination, &hop) != 3 ||
+            id >= AT_RTA_MAX_NODES || destination >= AT_RTA_MAX_NODES || hop >= AT_RTA_MAX_NODES)
+        {
+            fprintf(stderr, "%s:%u: expected HOP(id, destination, next_hop)\n", path, line_number);
+            fclose(file);
+            return 1;
+        }
+
+        network->next_hop[id][destination] = hop;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+int Airtight_Rta_ReadInterference(Airtight_RtaNetwork *network, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    char line[256];
+    unsigned line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned a, b;
+        line_number++;
+
+        if (!Airtight_Rta_StripComment(line))
+        {
+            continue;
+        }
+
+        if (sscanf(line, " INTERFERES ( %u , %u )", &a, &b) != 2 || a >= AT_RTA_MAX_NODES || b >= AT_RTA_MAX_NODES)
+        {
+            fprintf(stderr, "%s:%u: expected INTERFERES(a, b)\n", path, line_number);
+            fclose(file);
+            return 1;
+        }
+
+        network->hears[a][b] = true;
+        network->hears[b][a] = true;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+int Airtight_Rta_ReadChannelOffsets(Airtight_RtaNetwork *network, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    char *text = malloc(RTA_MAX_TABLE_TEXT + 1);
+    if (NULL == text)
+    {
+        fclose(file);
+        return 1;
+    }
+
+    const size_t length = fread(text, 1, RTA_MAX_TABLE_TEXT, file);
+    text[length] = '\0';
+    fclose(file);
+
+    at_u16_t column = 0;
+    at_u16_t row = 0;
+    at_bool_t in_column = false;
+    int result = 0;
+
+    for (char *c = text; *c != '\0' && result == 0;)
+    {
+        if (strncmp(c, "/*", 2) == 0)
+        {
+            char *end = strstr(c + 2, "*/");
+            c = NULL == end ? c + strlen(c) : end + 2;
+        }
+        else if (strncmp(c, "{{", 2) == 0)
+        {
+            if (column == network->columns)
+            {
+                fprintf(stderr, "%s: more than the slot table's %u columns\n", path, network->columns);
+                result = 1;
+            }
+            in_column = true;
+            row = 0;
+            c += 2;
+        }
+        else if (strncmp(c, "}}", 2) == 0)
+        {
+            if (!in_column || row != network->rows)
+            {
+                fprintf(stderr, "%s: column %u has %u rows, expected %u\n", path, column, row, network->rows);
+                result = 1;
+            }
+            in_column = false;
+            column++;
+            c += 2;
+        }
+        else if (in_column && *c >= '0' && *c <= '9')
+        {
+            char *end;
+            const unsigned long offset = strtoul(c, &end, 0);
+
+            if (row == network->rows || offset > 0xFF)
+            {
+                fprintf(stderr, "%s: column %u has too many rows or an offset above 255\n", path, column);
+                result = 1;
+                break;
+            }
+
+            network->channel_offsets[column][row++] = (at_u8_t)offset;
+            c = end;
+        }
+        else
+        {
+            c++;
+        }
+    }
+
+    free(text);
+
+    if (result == 0 && column != network->columns)
+    {
+        fprintf(stderr, "%s: %u columns, expected %u\n", path, column, network->columns);
+        result = 1;
+    }
+
+    network->channels = result == 0;
+    return result;
+}
+
+int Airtight_Rta_ReadFlows(Airtight_RtaNetwork *network, const char *path)
+{
+    static const Airtight_Criticality criticalities[AIRTIGHT_PRIORITIES] = AT_CONF_CRITICALITIES;
+
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    char line[256];
+    unsigned line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned source, destination, c_value, priority = AIRTIGHT_PRIORITIES;
+        unsigned long period_ms, deadline_ms = 0;
+        char criticality_name[8];
+        char close = '\0';
+        int consumed = 0;
+        line_number++;
+
+        if (!Airtight_Rta_StripComment(line))
+        {
+            continue;
+        }
+
+        at_bool_t valid = sscanf(line, " FLOW ( %u , %u , %lu , %7[A-Z] , %u%n", &source, &destination, &period_ms, criticality_name, &c_value, &consumed) == 5;
+        if (valid)
+        {
+            const char *rest = line + consumed;
+
+            valid = sscanf(rest, " , %lu , %u %c", &deadline_ms, &priority, &close) == 3 ||
+                    sscanf(rest, " , %lu %c", &deadline_ms, &close) == 2 ||
+                    sscanf(rest, " %c", &close) == 1;
+            valid = valid && close == ')';
+        }
+
+        const Airtight_Criticality criticality = strcmp(criticality_name, "HIGH") == 0 ? HIGH_CRIT : LOW_CRIT;
+        valid = valid && source < AT_RTA_MAX_NODES && destination < AT_RTA_MAX_NODES && period_ms > 0 && c_value > 0 && c_value <= 0xFF &&
+                (strcmp(criticality_name, "HIGH") == 0 || strcmp(criticality_name, "LOW") == 0);
+
+        if (!valid)
+        {
+            fprintf(stderr, "%s:%u: expected FLOW(source, destination, period_ms, HIGH|LOW, c_value[, deadline_ms[, priority]])\n", path, line_number);
+            fclose(file);
+            return 1;
+        }
+
+        if (priority == AIRTIGHT_PRIORITIES)
+        {
+            for (priority = 0; priority < AIRTIGHT_PRIORITIES && criticalities[priority] != criticality; priority++)
+                ;
+        }
+
+        if (priority >= AIRTIGHT_PRIORITIES || criticalities[priority] != criticality)
+        {
+            fprintf(stderr, "%s:%u: no priority queue of %s criticality\n", path, line_number, criticality_name);
+            fclose(file);
+            return 1;
+        }
+
+        if (network->flow_count == AT_RTA_MAX_FLOWS)
+        {
+            fprintf(stderr, "%s:%u: more than %u flows\n", path, line_number, AT_RTA_MAX_FLOWS);
+            fclose(file);
+            return 1;
+        }
+
+        Airtight_RtaFlow *flow = &network->flows[network->flow_count++];
+        flow->source = source;
+        flow->destination = destination;
+        flow->criticality = criticality;
+        flow->priority = priority;
+        flow->c_value = c_value;
+        flow->period_ms = period_ms;
+        flow->deadline_ms = deadline_ms > 0 ? deadline_ms : period_ms;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+/**
+ * Follow the routes of a flow, as Airtight_NextHop would on each node.
+ */
+static at_bool_t Airtight_Rta_Route(const Airtight_RtaNetwork *network, Airtight_RtaFlow *flow)
+{
+    Airtight_NodeId node = flow->source;
+
+    flow->hops = 0;
+    flow->path[0] = node;
+
+    while (node != flow->destination)
+    {
+        const at_u16_t hop = network->next_hop[node][flow->destination];
+
+        if (flow->hops == AT_RTA_MAX_HOPS)
+        {
+            return false;
+        }
+
+        node = hop == AT_RTA_NO_HOP ? flow->destination : (Airtight_NodeId)hop;
+        flow->path[++flow->hops] = node;
+    }
+
+    return true;
+}
+
+/**
+ * Least transmit slots of a node in any window of each length up to a
+ * cycle, and most in any window of a fault's length.
+ */
+static void Airtight_Rta_BuildSupply(const Airtight_RtaNetwork *network, Airtight_NodeId node)
+{
+    const at_u16_t rows = network->rows;
+    at_u16_t prefix[2 * AT_RTA_MAX_ROWS + 1];
+
+    prefix[0] = 0;
+    for (at_u16_t i = 0; i < 2 * rows; i++)
+    {
+        const at_u16_t row = i % rows;
+        prefix[i + 1] = prefix[i] + (row != AT_CONF_SYNC_SLOT_INDEX && network->actions[node][row] == ACTION_TRANSMIT);
+    }
+
+    supply_per_cycle[node] = prefix[rows];
+
+    for (at_u16_t w = 0; w <= rows; w++)
+    {
+        at_u16_t least = w;
+
+        for (at_u16_t start = 0; start < rows; start++)
+        {
+            const at_u16_t count = prefix[start + w] - prefix[start];
+            if (count < least)
+            {
+                least = count;
+            }
+        }
+
+        supply[node][w] = least;
+    }
+
+    const at_u16_t cycles = network->fault_length_slots / rows;
+    const at_u16_t remainder = network->fault_length_slots % rows;
+    at_u16_t most = 0;
+
+    for (at_u16_t start = 0; start < rows; start++)
+    {
+        const at_u16_t count = prefix[start + remainder] - prefix[start];
+        if (count > most)
+        {
+            most = count;
+        }
+    }
+
+    fault_slots[node] = cycles * supply_per_cycle[node] + most;
+}
+
+/**
+ * Transmit slots a node is guaranteed in any window of w slots.
+ */
+static at_u32_t Airtight_Rta_Available(const Airtight_RtaNetwork *network, Airtight_NodeId node, at_u32_t w, Airtight_Criticality mode)
+{
+    const at_u32_t guaranteed = (w / network->rows) * supply_per_cycle[node] + supply[node][w % network->rows];
+    at_u32_t lost = 0;
+
+    if (mode == HIGH_CRIT && network->fault_interval_slots > 0)
+    {
+        lost = ((w + network->fault_interval_slots - 1) / network->fault_interval_slots) * fault_slots[node];
+    }
+
+    return guaranteed > lost ? guaranteed - lost : 0;
+}
+
+static at_bool_t Airtight_Rta_Runs(const Airtight_RtaFlow *flow, Airtight_Criticality mode)
+{
+    return mode == LOW_CRIT || flow->criticality == HIGH_CRIT;
+}
+
+/**
+ * Frames per packet of a flow at each hop.
+ */
+static at_u32_t Airtight_Rta_Cost(const Airtight_RtaNetwork *network, const Airtight_RtaFlow *flow, Airtight_Criticality mode)
+{
+    const at_u32_t copies = flow->c_value > network->max_c_value ? network->max_c_value : flow->c_value;
+
+    return mode == HIGH_CRIT ? copies * (network->retransmission_limits[flow->criticality] + 1u) : copies;
+}
+
+/**
+ * Frames a node must send in a window of w slots before a flow's packet
+ * has crossed the hop.
+ */
+static at_u64_t Airtight_Rta_Demand(const Airtight_RtaNetwork *network, Airtight_NodeId node, const Airtight_RtaFlow *flow, at_u32_t w, Airtight_Criticality mode)
+{
+    at_u64_t demand = 0;
+    at_bool_t blocked = false;
+
+    for (at_u32_t v = visit_start[node]; v < visit_start[node + 1]; v++)
+    {
+        const Airtight_RtaFlow *other = &network->flows[visits[v].flow];
+
+        if (!Airtight_Rta_Runs(other, mode))
+        {
+            continue;
+        }
+
+        if (other->priority > flow->priority)
+        {
+            blocked = true;
+            continue;
+        }
+
+        const at_u64_t window_ms = (at_u64_t)(w + jitter[visits[v].flow][visits[v].hop]) * network->slot_ms;
+        const at_u64_t releases = (window_ms + other->period_ms - 1) / other->period_ms;
+
+        demand += releases * Airtight_Rta_Cost(network, other, mode);
+    }
+
+    return demand + blocked;
+}
+
+/**
+ * Response of a flow's hop in slots, 0 if unbounded.
+ */
+static at_u32_t Airtight_Rta_HopResponse(const Airtight_RtaNetwork *network, const Airtight_RtaFlow *flow, at_u8_t hop, Airtight_Criticality mode)
+{
+    const Airtight_NodeId node = flow->path[hop];
+    at_u32_t w = 1;
+
+    if (supply_per_cycle[node] == 0)
+    {
+        return 0;
+    }
+
+    for (;;)
+    {
+        const at_u64_t demand = Airtight_Rta_Demand(network, node, flow, w, mode);
+
+        // Each slot adds at most one available slot, so skip the shortfall.
+        for (at_u32_t available = Airtight_Rta_Available(network, node, w, mode); available < demand;
+             available = Airtight_Rta_Available(network, node, w, mode))
+        {
+            w += (at_u32_t)(demand - available);
+            if (w > AT_RTA_HORIZON_SLOTS)
+            {
+                return 0;
+            }
+        }
+
+        if (Airtight_Rta_Demand(network, node, flow, w, mode) <= demand)
+        {
+            return w;
+        }
+    }
+}
+
+static void Airtight_Rta_BuildVisits(const Airtight_RtaNetwork *network)
+{
+    memset(visit_start, 0, sizeof(visit_start));
+    memset(sends, 0, sizeof(sends));
+
+    for (at_u16_t f = 0; f < network->flow_count; f++)
+    {
+        const Airtight_RtaFlow *flow = &network->flows[f];
+        for (at_u8_t h = 0; routed[f] && h < flow->hops; h++)
+        {
+            visit_start[flow->path[h] + 1]++;
+            sends[flow->path[h]] = true;
+        }
+    }
+
+    for (at_u16_t n = 0; n < AT_RTA_MAX_NODES; n++)
+    {
+        visit_start[n + 1] += visit_start[n];
+    }
+
+    static at_u32_t filled[AT_RTA_MAX_NODES];
+    memcpy(filled, visit_start, sizeof(filled));
+
+    for (at_u16_t f = 0; f < network->flow_count; f++)
+    {
+        const Airtight_RtaFlow *flow = &network->flows[f];
+        for (at_u8_t h = 0; routed[f] && h < flow->hops; h++)
+        {
+            Airtight_RtaVisit *visit = &visits[filled[flow->path[h]]++];
+            visit->flow = f;
+            visit->hop = h;
+        }
+    }
+}
+
+/**
+ * Analyse all flows running in a mode until their release jitter settles.
+ *
+ * Jitter only grows, so the analysis reaches a fixed point, but it may take
+ * many rounds. A flow whose jitter still changes after AT_RTA_ITERATIONS
+ * rounds is widened: it is taken as unbounded, so the other flows see it at
+ * any time. Each later round either settles or widens another flow, and the
+ * bounds reported are always those of a fixed point.
+ */
+static void Airtight_Rta_AnalyseMode(const Airtight_RtaNetwork *network, Airtight_RtaResult *results, Airtight_Criticality mode)
+{
+    memset(jitter, 0, sizeof(jitter));
+    memset(widened, 0, sizeof(widened));
+
+    for (at_u32_t iteration = 0;; iteration++)
+    {
+        at_bool_t changed = false;
+
+        for (at_u16_t f = 0; f < network->flow_count; f++)
+        {
+            const Airtight_RtaFlow *flow = &network->flows[f];
+            Airtight_RtaResult *result = &results[f];
+
+            result->analysed[mode] = Airtight_Rta_Runs(flow, mode);
+            result->bounded[mode] = routed[f] && !widened[f];
+            if (!result->analysed[mode] || !routed[f])
+            {
+                continue;
+            }
+
+            at_u32_t total = 0;
+            for (at_u8_t h = 0; h < flow->hops; h++)
+            {
+                // Each earlier hop takes at least a slot, which is not jitter.
+                const at_u32_t release_jitter = total - h;
+
+                if (jitter[f][h] != release_jitter)
+                {
+                    jitter[f][h] = release_jitter;
+                    changed = true;
+                    widened[f] = widened[f] || iteration >= AT_RTA_ITERATIONS;
+                }
+
+                const at_u32_t response = result->bounded[mode] ? Airtight_Rta_HopResponse(network, flow, h, mode) : 0;
+
+                // Later hops of an unbounded flow see it at any time.
+                result->bounded[mode] = result->bounded[mode] && response > 0;
+                total = result->bounded[mode] ? total + response : AT_RTA_HORIZON_SLOTS;
+            }
+
+            result->response_ms[mode] = total * network->slot_ms;
+            result->slack_ms[mode] = (at_i32_t)flow->deadline_ms - (at_i32_t)result->response_ms[mode];
+        }
+
+        if (!changed)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * Whether two nodes use the same channel in a row, always so without
+ * channel offsets.
+ */
+static at_bool_t Airtight_Rta_SameChannel(const Airtight_RtaNetwork *network, Airtight_NodeId a, Airtight_NodeId b, at_u16_t row)
+{
+    return !network->channels ||
+           network->channel_offsets[a][row] % sizeof(channel_sequence) == network->channel_offsets[b][row] % sizeof(channel_sequence);
+}
+
+/**
+ * Whether a receiver hears a transmitter, as in airtight_schedule.
+ */
+static at_bool_t Airtight_Rta_Interferes(const Airtight_RtaNetwork *network, Airtight_NodeId transmitter, Airtight_NodeId receiver)
+{
+    return transmitter == receiver || network->hears[transmitter][receiver] ||
+           sends_to[transmitter][receiver] || sends_to[receiver][transmitter];
+}
+
+/**
+ * Whether a node sends or lends in a row.
+ */
+static at_bool_t Airtight_Rta_Transmits(const Airtight_RtaNetwork *network, Airtight_NodeId node, at_u16_t row)
+{
+    return network->actions[node][row] == ACTION_TRANSMIT || network->actions[node][row] == ACTION_SECONDARY;
+}
+
+/**
+ * Mark the hops of the routed flows in sends_to.
+ */
+static void Airtight_Rta_BuildLinks(Airtight_RtaNetwork *network)
+{
+    memset(sends_to, 0, sizeof(sends_to));
+
+    for (at_u16_t f = 0; f < network->flow_count; f++)
+    {
+        Airtight_RtaFlow *flow = &network->flows[f];
+        if (Airtight_Rta_Route(network, flow))
+        {
+            for (at_u8_t h = 0; h < flow->hops; h++)
+            {
+                sends_to[flow->path[h]][flow->path[h + 1]] = true;
+            }
+        }
+    }
+}
+
+at_u32_t Airtight_Rta_CheckReuse(Airtight_RtaNetwork *network, Airtight_RtaConflict *conflicts, at_u32_t max_conflicts)
+{
+    at_u32_t count = 0;
+
+    Airtight_Rta_BuildLinks(network);
+
+    for (at_u16_t row = 0; row < network->rows; row++)
+    {
+        at_u16_t transmitter_count = 0;
+        at_u16_t owner_count = 0;
+
+        if (row == AT_CONF_SYNC_SLOT_INDEX)
+        {
+            continue;
+        }
+
+        for (at_u16_t n = 0; n < network->columns; n++)
+        {
+            if (Airtight_Rta_Transmits(network, n, row))
+            {
+                row_transmitters[transmitter_count++] = n;
+                owner_count += network->actions[n][row] == ACTION_TRANSMIT;
+            }
+        }
+
+        for (at_u16_t i = 0; i < transmitter_count && transmitter_count > 1; i++)
+        {
+            const Airtight_NodeId transmitter = row_transmitters[i];
+
+            for (at_u16_t receiver = 0; receiver < AT_RTA_MAX_NODES; receiver++)
+            {
+                if (!sends_to[transmitter][receiver])
+                {
+                    continue;
+                }
+
+                for (at_u16_t j = 0; j < transmitter_count; j++)
+                {
+                    // A lone owner and its secondary owners never send together.
+                    const at_bool_t lent = owner_count == 1 &&
+                                           (network->actions[transmitter][row] == ACTION_TRANSMIT) != (network->actions[row_transmitters[j]][row] == ACTION_TRANSMIT);
+
+                    if (j != i && !lent && Airtight_Rta_SameChannel(network, row_transmitters[j], receiver, row) &&
+                        Airtight_Rta_Interferes(network, row_transmitters[j], receiver))
+                    {
+                        if (count < max_conflicts)
+                        {
+                            conflicts[count] = (Airtight_RtaConflict){
+                                .row = row,
+                                .transmitter = transmitter,
+                                .receiver = receiver,
+                                .interferer = row_transmitters[j],
+                            };
+                        }
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Whether a receiver is on the channel of one of its senders transmitting
+ * in a row.
+ */
+static at_bool_t Airtight_Rta_HearsSender(const Airtight_RtaNetwork *network, Airtight_NodeId receiver, at_u16_t row)
+{
+    for (at_u16_t n = 0; n < network->columns; n++)
+    {
+        if (sends_to[n][receiver] && Airtight_Rta_Transmits(network, n, row) && Airtight_Rta_SameChannel(network, n, receiver, row))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+at_u32_t Airtight_Rta_CheckChannels(Airtight_RtaNetwork *network, Airtight_RtaChannelMismatch *mismatches, at_u32_t max_mismatches)
+{
+    at_u32_t count = 0;
+
+    if (!network->channels)
+    {
+        return 0;
+    }
+
+    Airtight_Rta_BuildLinks(network);
+
+    for (at_u16_t row = 0; row < network->rows; row++)
+    {
+        at_u16_t owner_count = 0;
+        Airtight_NodeId owner = 0;
+
+        if (row == AT_CONF_SYNC_SLOT_INDEX)
+        {
+            continue;
+        }
+
+        for (at_u16_t n = 0; n < network->columns; n++)
+        {
+            if (network->actions[n][row] == ACTION_TRANSMIT)
+            {
+                owner = n;
+                owner_count++;
+            }
+        }
+
+        for (at_u16_t transmitter = 0; transmitter < network->columns; transmitter++)
+        {
+            if (!Airtight_Rta_Transmits(network, transmitter, row))
+            {
+                continue;
+            }
+
+            for (at_u16_t receiver = 0; receiver < network->columns; receiver++)
+            {
+                const at_bool_t listens = network->actions[receiver][row] == ACTION_LISTEN || network->actions[receiver][row] == ACTION_SECONDARY;
+                const at_bool_t must_hear = (sends_to[transmitter][receiver] && !Airtight_Rta_HearsSender(network, receiver, row)) ||
+                                            (owner_count == 1 && transmitter == owner && network->actions[receiver][row] == ACTION_SECONDARY);
+
+                if (listens && must_hear && !Airtight_Rta_SameChannel(network, transmitter, receiver, row))
+                {
+                    if (count < max_mismatches)
+                    {
+                        mismatches[count] = (Airtight_RtaChannelMismatch){
+                            .row = row,
+                            .transmitter = transmitter,
+                            .receiver = receiver,
+                        };
+                    }
+                    count++;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+at_bool_t Airtight_Rta_Analyse(Airtight_RtaNetwork *network, Airtight_RtaResult *results)
+{
+    at_bool_t schedulable = true;
+
+    memset(results, 0, network->flow_count * sizeof(Airtight_RtaResult));
+
+    if (network->rows == 0)
+    {
+        return false;
+    }
+
+    for (at_u16_t f = 0; f < network->flow_count; f++)
+    {
+        routed[f] = Airtight_Rta_Route(network, &network->flows[f]);
+    }
+
+    Airtight_Rta_BuildVisits(network);
+
+    // Nodes without a column never transmit.
+    memset(supply_per_cycle, 0, sizeof(supply_per_cycle));
+
+    for (at_u16_t n = 0; n < network->columns; n++)
+    {
+        if (sends[n])
+        {
+            Airtight_Rta_BuildSupply(network, n);
+        }
+    }
+
+    Airtight_Rta_AnalyseMode(network, results, LOW_CRIT);
+    Airtight_Rta_AnalyseMode(network, results, HIGH_CRIT);
+
+    for (at_u16_t f = 0; f < network->flow_count; f++)
+    {
+        for (at_u8_t mode = 0; mode < AT_RTA_MODES; mode++)
+        {
+            if (results[f].analysed[mode] && (!results[f].bounded[mode] || results[f].slack_ms[mode] < 0))
+            {
+                schedulable = false;
+            }
+        }
+    }
+
+    return schedulable;
+}
@@ -0,0 +1,193 @@
+/**
+ * @file
+ * AirTight: offline response time analysis header.
+ *
+ * Computes per-flow worst-case end-to-end response times for a slot table,
+ * routes and flow set, in LOW and HIGH criticality mode, and their slack
+ * against each flow's deadline. The network is kept in memory so that a
+ * schedule optimiser can change the table and analyse it again without
+ * reading files.
+ */
+#ifndef __AIRTIGHT_RTA_H
+#define __AIRTIGHT_RTA_H
+
+#include <stdio.h>
+
+#include "airtight_slots.h"
+
+#if (AIRTIGHT_CRITICALITY_LEVELS != 2)
+#error The response time analysis models the HIGH and LOW criticality levels only.
+#endif
+
+/**
+ * Node IDs are a byte.
+ */
+#define AT_RTA_MAX_NODES 256
+
+#define AT_RTA_MAX_FLOWS 4096
+#define AT_RTA_MAX_HOPS 32
+
+/**
+ * Slots are addressed with a byte.
+ */
+#define AT_RTA_MAX_ROWS 255
+
+/**
+ * Longest per hop response in slots before a flow is taken as unbounded.
+ */
+#define AT_RTA_HORIZON_SLOTS 65535
+
+/**
+ * Rounds of propagating release jitter along the flows' paths before flows
+ * whose jitter has not settled are taken as unbounded.
+ */
+#define AT_RTA_ITERATIONS 32
+
+#define AT_RTA_NO_HOP 0xFFFF
+
+/**
+ * Criticality modes analysed, indexed by Airtight_Criticality.
+ */
+#define AT_RTA_MODES 2
+
+typedef struct
+{
+    Airtight_NodeId source;
+    Airtight_NodeId destination;
+    Airtight_Criticality criticality;
+    Airtight_Priority priority;
+    at_u8_t c_value;
+    at_u32_t period_ms;
+    at_u32_t deadline_ms;
+    at_u8_t hops;
+    Airtight_NodeId path[AT_RTA_MAX_HOPS + 1];
+} Airtight_RtaFlow;
+
+typedef struct
+{
+    at_u16_t rows;
+    at_u16_t columns;
+    Airtight_SlotAction actions[AT_RTA_MAX_NODES][AT_RTA_MAX_ROWS];
+    at_u16_t next_hop[AT_RTA_MAX_NODES][AT_RTA_MAX_NODES];
+    /**
+     * Pairs of nodes that hear each other, from INTERFERES lines.
+     */
+    at_bool_t hears[AT_RTA_MAX_NODES][AT_RTA_MAX_NODES];
+    /**
+     * Channel offsets by node and row, from an airtight_slot_channels.txt
+     * file, when channels is set.
+     */
+    at_u8_t channel_offsets[AT_RTA_MAX_NODES][AT_RTA_MAX_ROWS];
+    at_bool_t channels;
+    Airtight_RtaFlow flows[AT_RTA_MAX_FLOWS];
+    at_u16_t flow_count;
+    at_u32_t slot_ms;
+    at_u16_t fault_interval_slots;
+    at_u16_t fault_length_slots;
+    at_u8_t retransmission_limits[AT_RTA_MODES];
+    at_u8_t max_c_value;
+} Airtight_RtaNetwork;
+
+typedef struct
+{
+    /**
+     * Whether the flow runs in a mode, LOW flows are shed in HIGH mode.
+     */
+    at_bool_t analysed[AT_RTA_MODES];
+    at_bool_t bounded[AT_RTA_MODES];
+    at_u32_t response_ms[AT_RTA_MODES];
+    at_i32_t slack_ms[AT_RTA_MODES];
+} Airtight_RtaResult;
+
+/**
+ * A receiver that hears another transmitter in the slot its sender uses.
+ */
+typedef struct
+{
+    at_u16_t row;
+    Airtight_NodeId transmitter;
+    Airtight_NodeId receiver;
+    Airtight_NodeId interferer;
+} Airtight_RtaConflict;
+
+/**
+ * A hop receiver, or a secondary owner, listening on another channel than
+ * the transmitter it must hear.
+ */
+typedef struct
+{
+    at_u16_t row;
+    Airtight_NodeId transmitter;
+    Airtight_NodeId receiver;
+} Airtight_RtaChannelMismatch;
+
+/**
+ * Remove a comment from a line, return false if nothing else is left.
+ * Shared by the tools reading line based input.
+ */
+at_bool_t Airtight_Rta_StripComment(char *line);
+
+/**
+ * Clear a network and take the slot length, fault model and retransmission
+ * limits from the MAC configuration.
+ */
+void Airtight_Rta_InitNetwork(Airtight_RtaNetwork *network);
+
+/**
+ * Read a slot table in the airtight_slot_table.txt format or the binary
+ * "ATST" format written by airtight_schedule.
+ */
+int Airtight_Rta_ReadSlotTable(Airtight_RtaNetwork *network, const char *path);
+
+/**
+ * Read HOP(id, destination, next_hop) rules.
+ */
+int Airtight_Rta_ReadRoutes(Airtight_RtaNetwork *network, const char *path);
+
+/**
+ * Read FLOW(source, destination, period_ms, HIGH|LOW, c_value[, deadline_ms
+ * [, priority]]) lines. The deadline defaults to the period and the
+ * priority to the most urgent one of the flow's criticality.
+ */
+int Airtight_Rta_ReadFlows(Airtight_RtaNetwork *network, const char *path);
+
+/**
+ * Read INTERFERES(a, b) lines, meaning a transmission from either node is
+ * heard by the other. Nodes on a route hop are taken to hear each other.
+ */
+int Airtight_Rta_ReadInterference(Airtight_RtaNetwork *network, const char *path);
+
+/**
+ * Read per node, per row channel offsets in the airtight_slot_channels.txt
+ * format. The slot table must be read first, the offsets must have its
+ * shape.
+ */
+int Airtight_Rta_ReadChannelOffsets(Airtight_RtaNetwork *network, const char *path);
+
+/**
+ * Check that rows with several transmitters are collision free, i.e. each
+ * receiver of a flow hop hears only its sender among the row's
+ * transmitters. Secondary owners count as transmitters, except against the
+ * owner of a row with a single one, which lends them the slot. With channel
+ * offsets read, only transmitters on the receiver's channel are heard.
+ * Returns the number of conflicts and stores up to max_conflicts of them.
+ */
+at_u32_t Airtight_Rta_CheckReuse(Airtight_RtaNetwork *network, Airtight_RtaConflict *conflicts, at_u32_t max_conflicts);
+
+/**
+ * Check that each hop receiver listening in a row where its sender
+ * transmits is on its sender's channel, unless it is on the channel of
+ * another of its senders in the row, and that the secondary owners of a row
+ * with a single owner are on the owner's channel to hear it lend the slot.
+ * Returns the number of mismatches and stores up to max_mismatches of them,
+ * none if no channel offsets were read.
+ */
+at_u32_t Airtight_Rta_CheckChannels(Airtight_RtaNetwork *network, Airtight_RtaChannelMismatch *mismatches, at_u32_t max_mismatches);
+
+/**
+ * Analyse every flow in both modes, return true if all meet their deadlines.
+ * Not reentrant, working state is kept statically.
+ */
+at_bool_t Airtight_Rta_Analyse(Airtight_RtaNetwork *network, Airtight_RtaResult *results);
+
+#endif
@@ -0,0 +1,966 @@
+/**
+ * @file
+ * AirTight: offline slot table synthesizer.
+ *
+ * Reads the route file, a flow set and an interference graph, and writes a
+ * collision-free slot table in the format of airtight_slot_table.txt and,
+ * optionally, in a binary format.
+ *
+ * Flows are given one per line as FLOW(source, destination, period_ms,
+ * HIGH|LOW, c_value), optionally followed by a deadline and priority, and
+ * interference as INTERFERES(a, b), meaning a transmission from either node
+ * is heard by the other. Nodes on a route hop are taken to interfere with
+ * each other.
+ *
+ * Each node that transmits for a flow is given enough transmit slots per
+ * slot table cycle for the rate of frames routed through it, assuming one
+ * frame per slot. Two transmitters may share a slot unless either one's
+ * receiver is the other or hears the other. Slots are assigned by greedy
+ * colouring, once in flow path order, HIGH and longer flows first, so that
+ * each hop transmits soon after the previous one, and once in order of
+ * conflict degree. The table with fewer slots is kept, and on a tie the one
+ * with the lower flow latency. The synchronisation slot is left idle.
+ *
+ * The latency reported and compared is that of a lone packet: the slots
+ * from its release to the last hop's transmit slot when no other flow is
+ * queued ahead of it, with no retransmissions or faults. The table is then
+ * checked with the response time analysis of airtight_analyse, which bounds
+ * the worst case, when every flow through a node releases at once, HIGH
+ * mode retransmissions and faults included. Nodes on the paths of flows it
+ * finds late get another transmit slot while that leaves fewer flows late,
+ * for up to SCHEDULE_ANALYSIS_ROUNDS. Where every transmitter conflicts with
+ * many others, extra slots lengthen the cycle as much as they add capacity
+ * and the rate based table is kept.
+ *
+ * The binary format is the magic "ATST", a version byte, a reserved byte,
+ * little-endian 16 bit row and column counts, then each column's row
+ * actions as one Airtight_SlotAction byte each.
+ *
+ * Usage: airtight_schedule [-i] [-s slot_ms] [-t table.txt] [-b table.bin]
+ *                          <routes.txt> <flows.txt> [interference.txt]
+ *
+ * With -i nodes idle rather than listen in slots where no neighbour sends
+ * to them. Without -t the table is written to stdout. Exits with 1 if no
+ * table carries the flows' rates, or if the table written is not
+ * schedulable in the analysis.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "airtight_rta.h"
+#include "airtight_slots.h"
+
+/**
+ * Node IDs are a byte.
+ */
+#define SCHEDULE_MAX_NODES 256
+
+#define SCHEDULE_MAX_FLOWS 4096
+#define SCHEDULE_MAX_HOPS 32
+
+/**
+ * Most transmit slots given to one node per cycle.
+ */
+#define SCHEDULE_MAX_SHARES 16
+
+/**
+ * Slots are addressed with a byte.
+ */
+#define SCHEDULE_MAX_ROWS 255
+
+/**
+ * Rounds of growing the shares of nodes to meet their demand.
+ */
+#define SCHEDULE_ITERATIONS 16
+
+/**
+ * Rounds of growing the shares of nodes on flows late in the analysis.
+ */
+#define SCHEDULE_ANALYSIS_ROUNDS 16
+
+#define SCHEDULE_VERSION 1
+#define SCHEDULE_NO_HOP 0xFFFF
+
+typedef struct
+{
+    at_u8_t source;
+    at_u8_t destination;
+    at_u32_t period_ms;
+    at_bool_t high;
+    at_u8_t c_value;
+    at_u8_t hops;
+    at_u8_t path[SCHEDULE_MAX_HOPS + 1];
+} Schedule_Flow;
+
+typedef struct
+{
+    at_u16_t colours;
+    at_u8_t slots[SCHEDULE_MAX_NODES][SCHEDULE_MAX_SHARES];
+    at_u32_t worst_latency;
+    double mean_latency;
+} Schedule_Assignment;
+
+static at_u16_t next_hop[SCHEDULE_MAX_NODES][SCHEDULE_MAX_NODES];
+static at_bool_t hears[SCHEDULE_MAX_NODES][SCHEDULE_MAX_NODES];
+static at_bool_t sends_to[SCHEDULE_MAX_NODES][SCHEDULE_MAX_NODES];
+static at_bool_t conflicts[SCHEDULE_MAX_NODES][SCHEDULE_MAX_NODES];
+static at_u8_t shares[SCHEDULE_MAX_NODES];
+static at_u16_t upstream[SCHEDULE_MAX_NODES];
+static Schedule_Flow flows[SCHEDULE_MAX_FLOWS];
+static at_u16_t flow_count;
+static at_u16_t node_count;
+static at_u8_t transmitters[SCHEDULE_MAX_NODES];
+static at_u16_t transmitter_count;
+static Schedule_Assignment candidates[2];
+static Airtight_SlotAction actions[SCHEDULE_MAX_NODES][SCHEDULE_MAX_ROWS];
+static Airtight_RtaNetwork network;
+static Airtight_RtaResult results[AT_RTA_MAX_FLOWS];
+
+static void Schedule_SeeNode(unsigned node)
+{
+    if (node + 1 > node_count)
+    {
+        node_count = node + 1;
+    }
+}
+
+static int Schedule_ReadRoutes(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    char line[256];
+    unsigned line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned id, destination, hop;
+        line_number++;
+
+        if (!Airtight_Rta_StripComment(line))
+        {
+            continue;
+        }
+
+        if (sscanf(line, " HOP ( %u , %u , %u )", &id, &destination, &hop) != 3 ||
+            id >= SCHEDULE_MAX_NODES || destination >= SCHEDULE_MAX_NODES || hop >= SCHEDULE_MAX_NODES)
+        {
+            fprintf(stderr, "%s:%u: expected HOP(id, destination, next_hop)\n", path, line_number);
+            fclose(file);
+            return 1;
+        }
+
+        next_hop[id][destination] = hop;
+        Schedule_SeeNode(id);
+        Schedule_SeeNode(destination);
+        Schedule_SeeNode(hop);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+static int Schedule_ReadFlows(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    char line[256];
+    unsigned line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned source, destination, c_value;
+        unsigned long period_ms;
+        char criticality[8];
+        int consumed = 0;
+        line_number++;
+
+        if (!Airtight_Rta_StripComment(line))
+        {
+            continue;
+        }
+
+        // Any deadline and priority after the c_value are for airtight_analyse.
+        if (sscanf(line, " FLOW ( %u , %u , %lu , %7[A-Z] , %u%n", &source, &destination, &period_ms, criticality, &c_value, &consumed) != 5 ||
+            strchr(line + consumed, ')') == NULL || source >= SCHEDULE_MAX_NODES || destination >= SCHEDULE_MAX_NODES || period_ms == 0 || c_value == 0 || c_value > 0xFF ||
+            (strcmp(criticality, "HIGH") != 0 && strcmp(criticality, "LOW") != 0))
+        {
+            fprintf(stderr, "%s:%u: expected FLOW(source, destination, period_ms, HIGH|LOW, c_value)\n", path, line_number);
+            fclose(file);
+            return 1;
+        }
+
+        if (flow_count == SCHEDULE_MAX_FLOWS)
+        {
+            fprintf(stderr, "%s:%u: more than %u flows\n", path, line_number, SCHEDULE_MAX_FLOWS);
+            fclose(file);
+            return 1;
+        }
+
+        Schedule_Flow *flow = &flows[flow_count++];
+        flow->source = source;
+        flow->destination = destination;
+        flow->period_ms = period_ms;
+        flow->high = strcmp(criticality, "HIGH") == 0;
+        flow->c_value = c_value;
+        Schedule_SeeNode(source);
+        Schedule_SeeNode(destination);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+static int Schedule_ReadInterference(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    char line[256];
+    unsigned line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned a, b;
+        line_number++;
+
+        if (!Airtight_Rta_StripComment(line))
+        {
+            continue;
+        }
+
+        if (sscanf(line, " INTERFERES ( %u , %u )", &a, &b) != 2 || a >= SCHEDULE_MAX_NODES || b >= SCHEDULE_MAX_NODES)
+        {
+            fprintf(stderr, "%s:%u: expected INTERFERES(a, b)\n", path, line_number);
+            fclose(file);
+            return 1;
+        }
+
+        hears[a][b] = true;
+        hears[b][a] = true;
+        Schedule_SeeNode(a);
+        Schedule_SeeNode(b);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+/**
+ * Follow the routes of each flow, as Airtight_NextHop would on each node.
+ */
+static int Schedule_ExpandPaths(void)
+{
+    for (at_u16_t f = 0; f < flow_count; f++)
+    {
+        Schedule_Flow *flow = &flows[f];
+        at_u8_t node = flow->source;
+
+        flow->hops = 0;
+        flow->path[0] = node;
+
+        while (node != flow->destination)
+        {
+            const at_u16_t hop = next_hop[node][flow->destination];
+            const at_u8_t next = hop == SCHEDULE_NO_HOP ? flow->destination : (at_u8_t)hop;
+
+            if (flow->hops == SCHEDULE_MAX_HOPS)
+            {
+                fprintf(stderr, "flow %u: %u to %u has a routing loop or more than %u hops\n",
+                        f, flow->source, flow->destination, SCHEDULE_MAX_HOPS);
+                return 1;
+            }
+
+            sends_to[node][next] = true;
+            hears[node][next] = true;
+            hears[next][node] = true;
+            flow->path[++flow->hops] = next;
+            node = next;
+        }
+    }
+
+    return 0;
+}
+
+static at_bool_t Schedule_Interferes(at_u8_t sender, at_u8_t receiver)
+{
+    return sender == receiver || hears[sender][receiver];
+}
+
+/**
+ * Transmitters conflict if either's receiver is, or hears, the other.
+ */
+static void Schedule_BuildConflicts(void)
+{
+    transmitter_count = 0;
+    for (at_u16_t u = 0; u < node_count; u++)
+    {
+        for (at_u16_t r = 0; r < node_count; r++)
+        {
+            if (sends_to[u][r])
+            {
+                transmitters[transmitter_count++] = u;
+                break;
+            }
+        }
+    }
+
+    for (at_u16_t i = 0; i < transmitter_count; i++)
+    {
+        const at_u8_t u = transmitters[i];
+
+        for (at_u16_t j = i + 1; j < transmitter_count; j++)
+        {
+            const at_u8_t w = transmitters[j];
+            at_bool_t conflict = false;
+
+            for (at_u16_t r = 0; r < node_count && !conflict; r++)
+            {
+                conflict = (sends_to[u][r] && Schedule_Interferes(w, r)) ||
+                           (sends_to[w][r] && Schedule_Interferes(u, r));
+            }
+
+            conflicts[u][w] = conflict;
+            conflicts[w][u] = conflict;
+        }
+    }
+}
+
+/**
+ * Rows of a table with a number of colours, counting the sync slot.
+ */
+static at_u16_t Schedule_Rows(at_u16_t colours)
+{
+    return colours + 1;
+}
+
+/**
+ * Row of a colour, skipping the sync slot.
+ */
+static at_u8_t Schedule_Row(at_u8_t colour)
+{
+    return colour <= AT_CONF_SYNC_SLOT_INDEX ? colour - 1 : colour;
+}
+
+/**
+ * Slots from a row until a node's next transmit slot after it.
+ */
+static at_u16_t Schedule_Wait(const Schedule_Assignment *assignment, at_u8_t node, at_u16_t row)
+{
+    const at_u16_t rows = Schedule_Rows(assignment->colours);
+    at_u16_t wait = rows;
+
+    for (at_u8_t s = 0; s < shares[node]; s++)
+    {
+        const at_u16_t slot = Schedule_Row(assignment->slots[node][s]);
+        const at_u16_t gap = (slot + rows - row - 1) % rows + 1;
+
+        if (gap < wait)
+        {
+            wait = gap;
+        }
+    }
+
+    return wait;
+}
+
+/**
+ * Worst-case latency in slots of each flow, from release to the last hop's
+ * transmit slot.
+ */
+static void Schedule_Evaluate(Schedule_Assignment *assignment)
+{
+    double total = 0;
+    assignment->worst_latency = 0;
+
+    for (at_u16_t f = 0; f < flow_count; f++)
+    {
+        const Schedule_Flow *flow = &flows[f];
+        const at_u8_t first = flow->path[0];
+        at_u32_t latency = 0;
+
+        // Released just after the first hop's slot, wait for its largest gap.
+        for (at_u8_t s = 0; s < shares[first]; s++)
+        {
+            const at_u16_t gap = Schedule_Wait(assignment, first, Schedule_Row(assignment->slots[first][s]));
+            if (gap > latency)
+            {
+                latency = gap;
+            }
+        }
+
+        at_u16_t row = Schedule_Row(assignment->slots[first][0]);
+        for (at_u8_t h = 1; h < flow->hops; h++)
+        {
+            const at_u16_t wait = Schedule_Wait(assignment, flow->path[h], row);
+            latency += wait;
+            row = (row + wait) % Schedule_Rows(assignment->colours);
+        }
+
+        total += latency;
+        if (latency > assignment->worst_latency)
+        {
+            assignment->worst_latency = latency;
+        }
+    }
+
+    assignment->mean_latency = flow_count > 0 ? total / flow_count : 0;
+}
+
+/**
+ * Greedily colour transmitters in an order, preferring the colour after the
+ * upstream node's when following paths.
+ */
+static void Schedule_Colour(Schedule_Assignment *assignment, const at_u8_t *order, at_bool_t follow_paths)
+{
+    static at_bool_t assigned[SCHEDULE_MAX_NODES];
+    at_bool_t taken[SCHEDULE_MAX_ROWS + 2];
+
+    memset(assigned, 0, sizeof(assigned));
+    assignment->colours = 0;
+
+    for (at_u16_t i = 0; i < transmitter_count; i++)
+    {
+        const at_u8_t u = order[i];
+
+        memset(taken, 0, sizeof(taken));
+        for (at_u16_t j = 0; j < transmitter_count; j++)
+        {
+            const at_u8_t w = transmitters[j];
+            if (assigned[w] && conflicts[u][w])
+            {
+                for (at_u8_t s = 0; s < shares[w]; s++)
+                {
+                    taken[assignment->slots[w][s]] = true;
+                }
+            }
+        }
+
+        for (at_u8_t s = 0; s < shares[u]; s++)
+        {
+            at_u16_t preferred = 1;
+
+            if (s > 0)
+            {
+                const at_u16_t spacing = assignment->colours / shares[u];
+                preferred = assignment->slots[u][s - 1] + (spacing > 0 ? spacing : 1);
+            }
+            else if (follow_paths && upstream[u] != SCHEDULE_NO_HOP && assigned[upstream[u]])
+            {
+                preferred = assignment->slots[upstream[u]][0] + 1;
+            }
+
+            at_u16_t colour = 0;
+            for (at_u16_t k = 0; k < assignment->colours && colour == 0; k++)
+            {
+                const at_u16_t candidate = (preferred - 1 + k) % assignment->colours + 1;
+                if (!taken[candidate])
+                {
+                    colour = candidate;
+                }
+            }
+
+            if (colour == 0)
+            {
+                colour = ++assignment->colours;
+                if (colour > SCHEDULE_MAX_ROWS)
+                {
+                    return;
+                }
+            }
+
+            assignment->slots[u][s] = colour;
+            taken[colour] = true;
+        }
+
+        assigned[u] = true;
+    }
+
+    Schedule_Evaluate(assignment);
+}
+
+static const Schedule_Flow *sort_flows;
+
+static int Schedule_CompareFlows(const void *a, const void *b)
+{
+    const Schedule_Flow *x = &sort_flows[*(const at_u16_t *)a];
+    const Schedule_Flow *y = &sort_flows[*(const at_u16_t *)b];
+
+    if (x->high != y->high)
+    {
+        return x->high ? -1 : 1;
+    }
+
+    return (int)y->hops - (int)x->hops;
+}
+
+static int Schedule_CompareDegree(const void *a, const void *b)
+{
+    const at_u8_t u = *(const at_u8_t *)a;
+    const at_u8_t w = *(const at_u8_t *)b;
+    at_u32_t degree_u = 0;
+    at_u32_t degree_w = 0;
+
+    for (at_u16_t i = 0; i < transmitter_count; i++)
+    {
+        degree_u += conflicts[u][transmitters[i]] * shares[transmitters[i]];
+        degree_w += conflicts[w][transmitters[i]] * shares[transmitters[i]];
+    }
+
+    degree_u *= shares[u];
+    degree_w *= shares[w];
+
+    return degree_u == degree_w ? (int)u - (int)w : (degree_u > degree_w ? -1 : 1);
+}
+
+/**
+ * Colour in both orders and return the better table.
+ */
+static const Schedule_Assignment *Schedule_Assign(void)
+{
+    static at_u16_t flow_order[SCHEDULE_MAX_FLOWS];
+    at_u8_t order[SCHEDULE_MAX_NODES];
+    at_bool_t placed[SCHEDULE_MAX_NODES];
+    at_u16_t count = 0;
+
+    for (at_u16_t f = 0; f < flow_count; f++)
+    {
+        flow_order[f] = f;
+    }
+    sort_flows = flows;
+    qsort(flow_order, flow_count, sizeof(flow_order[0]), Schedule_CompareFlows);
+
+    memset(placed, 0, sizeof(placed));
+    for (at_u16_t i = 0; i < SCHEDULE_MAX_NODES; i++)
+    {
+        upstream[i] = SCHEDULE_NO_HOP;
+    }
+
+    for (at_u16_t f = 0; f < flow_count; f++)
+    {
+        const Schedule_Flow *flow = &flows[flow_order[f]];
+
+        for (at_u8_t h = 0; h < flow->hops; h++)
+        {
+            const at_u8_t node = flow->path[h];
+            if (!placed[node])
+            {
+                placed[node] = true;
+                upstream[node] = h > 0 ? flow->path[h - 1] : SCHEDULE_NO_HOP;
+                order[count++] = node;
+            }
+        }
+    }
+    Schedule_Colour(&candidates[0], order, true);
+
+    memcpy(order, transmitters, transmitter_count);
+    qsort(order, transmitter_count, sizeof(order[0]), Schedule_CompareDegree);
+    Schedule_Colour(&candidates[1], order, false);
+
+    if (candidates[1].colours < candidates[0].colours ||
+        (candidates[1].colours == candidates[0].colours && candidates[1].worst_latency < candidates[0].worst_latency))
+    {
+        return &candidates[1];
+    }
+
+    return &candidates[0];
+}
+
+/**
+ * Grow each node's transmit slots per cycle of a number of rows to carry
+ * the long-run rate of frames routed through it, return true if any grew.
+ */
+static at_bool_t Schedule_UpdateShares(at_u16_t rows, at_u32_t slot_ms, at_bool_t *met)
+{
+    double rate[SCHEDULE_MAX_NODES];
+    at_bool_t changed = false;
+
+    for (at_u16_t n = 0; n < SCHEDULE_MAX_NODES; n++)
+    {
+        rate[n] = 0;
+    }
+
+    for (at_u16_t f = 0; f < flow_count; f++)
+    {
+        const Schedule_Flow *flow = &flows[f];
+
+        for (at_u8_t h = 0; h < flow->hops; h++)
+        {
+            rate[flow->path[h]] += (double)flow->c_value / flow->period_ms;
+        }
+    }
+
+    *met = true;
+    for (at_u16_t i = 0; i < transmitter_count; i++)
+    {
+        const at_u8_t u = transmitters[i];
+        const double frames = rate[u] * rows * slot_ms;
+        at_u32_t demand = (at_u32_t)frames;
+        demand += demand < frames;
+
+        const at_u32_t wanted = demand < SCHEDULE_MAX_SHARES ? (demand > 0 ? demand : 1) : SCHEDULE_MAX_SHARES;
+
+        *met = *met && demand <= shares[u];
+        if (wanted > shares[u])
+        {
+            shares[u] = wanted;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+static void Schedule_BuildActions(const Schedule_Assignment *assignment, at_bool_t idle)
+{
+    const at_u16_t rows = Schedule_Rows(assignment->colours);
+
+    for (at_u16_t n = 0; n < node_count; n++)
+    {
+        for (at_u16_t row = 0; row < rows; row++)
+        {
+            actions[n][row] = idle || row == AT_CONF_SYNC_SLOT_INDEX ? ACTION_IDLE : ACTION_LISTEN;
+        }
+    }
+
+    for (at_u16_t i = 0; i < transmitter_count; i++)
+    {
+        const at_u8_t u = transmitters[i];
+
+        for (at_u8_t s = 0; s < shares[u]; s++)
+        {
+            const at_u8_t row = Schedule_Row(assignment->slots[u][s]);
+
+            actions[u][row] = ACTION_TRANSMIT;
+            for (at_u16_t r = 0; r < node_count; r++)
+            {
+                if (sends_to[u][r])
+                {
+                    actions[r][row] = ACTION_LISTEN;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Colour the transmitters and grow their shares until each carries the rate
+ * of frames routed through it, return the table or NULL if none fits.
+ */
+static const Schedule_Assignment *Schedule_Fit(at_u32_t slot_ms)
+{
+    const Schedule_Assignment *assignment = NULL;
+    at_bool_t met = false;
+
+    for (at_u8_t iteration = 0; iteration < SCHEDULE_ITERATIONS; iteration++)
+    {
+        assignment = Schedule_Assign();
+        if (assignment->colours > SCHEDULE_MAX_ROWS - 1)
+        {
+            return NULL;
+        }
+
+        if (!Schedule_UpdateShares(Schedule_Rows(assignment->colours), slot_ms, &met))
+        {
+            break;
+        }
+    }
+
+    return met ? assignment : NULL;
+}
+
+/**
+ * Build a table's actions and analyse it as airtight_analyse does, return
+ * true if every flow meets its deadline.
+ */
+static at_bool_t Schedule_Analyse(const Schedule_Assignment *assignment, at_bool_t idle)
+{
+    Schedule_BuildActions(assignment, idle);
+
+    network.rows = Schedule_Rows(assignment->colours);
+    network.columns = node_count;
+    for (at_u16_t n = 0; n < node_count; n++)
+    {
+        memcpy(network.actions[n], actions[n], network.rows * sizeof(Airtight_SlotAction));
+    }
+
+    return Airtight_Rta_Analyse(&network, results);
+}
+
+/**
+ * Whether a flow misses its deadline in a mode it runs in.
+ */
+static at_bool_t Schedule_Late(const Airtight_RtaResult *result, Airtight_Criticality mode)
+{
+    return result->analysed[mode] && (!result->bounded[mode] || result->slack_ms[mode] < 0);
+}
+
+/**
+ * Flows late in the last analysis.
+ */
+static at_u32_t Schedule_CountLate(void)
+{
+    at_u32_t late = 0;
+
+    for (at_u16_t f = 0; f < network.flow_count; f++)
+    {
+        late += Schedule_Late(&results[f], LOW_CRIT) || Schedule_Late(&results[f], HIGH_CRIT);
+    }
+
+    return late;
+}
+
+/**
+ * Give each node on the path of a late flow one more transmit slot, return
+ * true if any grew.
+ */
+static at_bool_t Schedule_GrowLate(void)
+{
+    at_bool_t grown[SCHEDULE_MAX_NODES];
+    at_bool_t grew = false;
+
+    memset(grown, 0, sizeof(grown));
+
+    for (at_u16_t f = 0; f < network.flow_count; f++)
+    {
+        const Airtight_RtaFlow *flow = &network.flows[f];
+
+        if (!Schedule_Late(&results[f], LOW_CRIT) && !Schedule_Late(&results[f], HIGH_CRIT))
+        {
+            continue;
+        }
+
+        for (at_u8_t h = 0; h < flow->hops; h++)
+        {
+            const at_u8_t node = flow->path[h];
+
+            if (!grown[node] && shares[node] < SCHEDULE_MAX_SHARES)
+            {
+                grown[node] = true;
+                shares[node]++;
+                grew = true;
+            }
+        }
+    }
+
+    return grew;
+}
+
+/**
+ * Print a mode's worst response, unbounded if any of its flows is.
+ */
+static void Schedule_PrintWorstResponse(Airtight_Criticality mode, at_bool_t unbounded, at_u32_t response_ms)
+{
+    const char *name = mode == HIGH_CRIT ? "HIGH" : "LOW";
+
+    if (unbounded)
+    {
+        fprintf(stderr, " %s=unbounded", name);
+    }
+    else
+    {
+        fprintf(stderr, " %s=%lums", name, (unsigned long)response_ms);
+    }
+}
+
+static void Schedule_WriteText(FILE *file, at_u16_t rows)
+{
+    static const char *const names[] = {"IDLE", "LISTEN", "TRANSMIT", "SECONDARY", "BEST_EFFORT"};
+
+    fprintf(file, "/* AT_CONF_SLOT_TABLE_ROWS %u, AT_CONF_SLOT_TABLE_COLUMNS %u */\n", rows, node_count);
+    fprintf(file, "SLOT_TABLE = {\n");
+    for (at_u16_t n = 0; n < node_count; n++)
+    {
+        fprintf(file, "    {{\n");
+        for (at_u16_t row = 0; row < rows; row++)
+        {
+            fprintf(file, "        %s,\n", names[actions[n][row]]);
+        }
+        fprintf(file, n + 1 < node_count ? "    }},\n" : "    }}\n");
+    }
+    fprintf(file, "};\n");
+}
+
+static int Schedule_WriteBinary(const char *path, at_u16_t rows)
+{
+    FILE *file = fopen(path, "wb");
+    if (NULL == file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    const at_u8_t header[] = {'A', 'T', 'S', 'T', SCHEDULE_VERSION, 0,
+                              rows & 0xFF, rows >> 8, node_count & 0xFF, node_count >> 8};
+    fwrite(header, sizeof(header), 1, file);
+
+    for (at_u16_t n = 0; n < node_count; n++)
+    {
+        for (at_u16_t row = 0; row < rows; row++)
+        {
+            fputc(actions[n][row], file);
+        }
+    }
+
+    return fclose(file) == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *paths[3] = {NULL, NULL, NULL};
+    const char *text_path = NULL;
+    const char *binary_path = NULL;
+    at_u32_t slot_ms = AT_CONF_SLOT_LENGTH_MS;
+    at_bool_t idle = false;
+    int path_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-i") == 0)
+        {
+            idle = true;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            slot_ms = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            text_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            binary_path = argv[++i];
+        }
+        else if (path_count < 3)
+        {
+            paths[path_count++] = argv[i];
+        }
+    }
+
+    if (path_count < 2 || slot_ms == 0)
+    {
+        fprintf(stderr, "Usage: %s [-i] [-s slot_ms] [-t table.txt] [-b table.bin] <routes.txt> <flows.txt> [interference.txt]\n", argv[0]);
+        return 2;
+    }
+
+    memset(next_hop, 0xFF, sizeof(next_hop));
+    if (Schedule_ReadRoutes(paths[0]) || Schedule_ReadFlows(paths[1]) ||
+        (NULL != paths[2] && Schedule_ReadInterference(paths[2])) || Schedule_ExpandPaths())
+    {
+        return 1;
+    }
+
+    Airtight_Rta_InitNetwork(&network);
+    network.slot_ms = slot_ms;
+    if (Airtight_Rta_ReadRoutes(&network, paths[0]) || Airtight_Rta_ReadFlows(&network, paths[1]) ||
+        (NULL != paths[2] && Airtight_Rta_ReadInterference(&network, paths[2])))
+    {
+        return 1;
+    }
+
+    Schedule_BuildConflicts();
+
+    for (at_u16_t i = 0; i < transmitter_count; i++)
+    {
+        shares[transmitters[i]] = 1;
+    }
+
+    const Schedule_Assignment *assignment = Schedule_Fit(slot_ms);
+    if (NULL == assignment)
+    {
+        fprintf(stderr, "SCHEDULE infeasible: no table of up to %u slots with up to %u transmit slots per node carries the flows\n",
+                SCHEDULE_MAX_ROWS, SCHEDULE_MAX_SHARES);
+        return 1;
+    }
+
+    at_bool_t schedulable = Schedule_Analyse(assignment, idle);
+    at_u32_t late = Schedule_CountLate();
+    for (at_u8_t round = 0; !schedulable && round < SCHEDULE_ANALYSIS_ROUNDS; round++)
+    {
+        at_u8_t saved_shares[SCHEDULE_MAX_NODES];
+        memcpy(saved_shares, shares, sizeof(shares));
+
+        if (!Schedule_GrowLate())
+        {
+            break;
+        }
+
+        const Schedule_Assignment *grown = Schedule_Fit(slot_ms);
+        const at_bool_t grown_schedulable = NULL != grown && Schedule_Analyse(grown, idle);
+        const at_u32_t grown_late = NULL != grown ? Schedule_CountLate() : late;
+
+        if (grown_late >= late)
+        {
+            // The extra slots lengthened the cycle as much as they added
+            // capacity, go back to the last table.
+            memcpy(shares, saved_shares, sizeof(shares));
+            assignment = Schedule_Fit(slot_ms);
+            schedulable = Schedule_Analyse(assignment, idle);
+            break;
+        }
+
+        assignment = grown;
+        schedulable = grown_schedulable;
+        late = grown_late;
+    }
+
+    const at_u16_t rows = Schedule_Rows(assignment->colours);
+    at_u32_t worst_response_ms[AT_RTA_MODES] = {0, 0};
+    at_bool_t unbounded[AT_RTA_MODES] = {false, false};
+    for (at_u16_t f = 0; f < network.flow_count; f++)
+    {
+        for (at_u8_t mode = 0; mode < AT_RTA_MODES; mode++)
+        {
+            unbounded[mode] = unbounded[mode] || (results[f].analysed[mode] && !results[f].bounded[mode]);
+            if (results[f].analysed[mode] && results[f].bounded[mode] && results[f].response_ms[mode] > worst_response_ms[mode])
+            {
+                worst_response_ms[mode] = results[f].response_ms[mode];
+            }
+        }
+    }
+
+    fprintf(stderr, "SCHEDULE nodes=%u flows=%u transmitters=%u rows=%u worst_latency=%u mean_latency=%.1f slots\n",
+            node_count, flow_count, transmitter_count, rows, assignment->worst_latency, assignment->mean_latency);
+    fprintf(stderr, "SCHEDULE analysis schedulable=%s late=%lu worst_response", schedulable ? "yes" : "no", (unsigned long)late);
+    Schedule_PrintWorstResponse(LOW_CRIT, unbounded[LOW_CRIT], worst_response_ms[LOW_CRIT]);
+    Schedule_PrintWorstResponse(HIGH_CRIT, unbounded[HIGH_CRIT], worst_response_ms[HIGH_CRIT]);
+    fputc('\n', stderr);
+
+    if (NULL != text_path)
+    {
+        FILE *file = fopen(text_path, "w");
+        if (NULL == file)
+        {
+            perror(text_path);
+            return 1;
+        }
+        Schedule_WriteText(file, rows);
+        if (fclose(file) != 0)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        Schedule_WriteText(stdout, rows);
+    }
+
+    if (NULL != binary_path && Schedule_WriteBinary(binary_path, rows))
+    {
+        return 1;
+    }
+
+    return schedulable ? 0 : 1;
+}